@@ -195,6 +195,17 @@ struct dso_data {
 	 */
 	int (*unregister_device)(const char *device, const char *uuid,
 				 int major, int minor, void **user);
+
+	/*
+	 * Adaptive polling (optional).
+	 *
+	 * Called after a timeout event has been processed.
+	 * The DSO returns the number of seconds until the next
+	 * status poll of the device, i.e. it may poll less often
+	 * an idle device and more often a nearly full one.
+	 * Returning 0 keeps the registered timeout.
+	 */
+	uint32_t (*next_timeout)(uint32_t timeout, void **user);
 };
 static DM_LIST_INIT(_dso_registry);
 
@@ -242,6 +253,7 @@ struct thread_status {
 	int events;		/* bitfield for event filter. */
 	int current_events;	/* bitfield for occured events. */
 	struct dm_task *wait_task;
+	struct dm_task *status_task;	/* Status prefetched by timeout sweep */
 	int pending;		/* Set when event filter change is pending */
 	time_t next_time;
 	uint32_t timeout;
@@ -258,6 +270,15 @@ static DM_LIST_INIT(_timeout_registry);
 static pthread_mutex_t _timeout_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t _timeout_cond = PTHREAD_COND_INITIALIZER;
 
+/* Counters of timeout status sweeps, protected by _timeout_mutex */
+static struct {
+	uint64_t sweeps;	/* Number of sweeps with at least one device */
+	uint64_t devices;	/* Number of status reads done by sweeps */
+	uint64_t last_usec;	/* Duration of the last sweep */
+	uint64_t max_usec;	/* Longest sweep */
+	uint64_t total_usec;	/* Sum of all sweep durations */
+} _sweep_stats;
+
 
 /**********
  *   DSO
@@ -333,6 +354,9 @@ static int _lookup_symbol(void *dl, void **symbol, const char *name)
 
 static int _lookup_symbols(void *dl, struct dso_data *data)
 {
+	/* Optional symbol */
+	data->next_timeout = dlsym(dl, "next_timeout");
+
 	return _lookup_symbol(dl, (void *) &data->process_event,
 			     "process_event") &&
 	    _lookup_symbol(dl, (void *) &data->register_device,
@@ -399,6 +423,8 @@ static void _free_thread_status(struct thread_status *thread)
 	_lib_put(thread->dso_data);
 	if (thread->wait_task)
 		dm_task_destroy(thread->wait_task);
+	if (thread->status_task)
+		dm_task_destroy(thread->status_task);
 	free(thread->device.uuid);
 	free(thread->device.name);
 	free(thread);
@@ -628,14 +654,14 @@ fail:
 	return ret;
 }
 
-static struct dm_task *_get_device_status(struct thread_status *ts)
+static struct dm_task *_get_device_status(const char *uuid)
 {
 	struct dm_task *dmt = dm_task_create(DM_DEVICE_STATUS);
 
 	if (!dmt)
 		return_NULL;
 
-	if (!dm_task_set_uuid(dmt, ts->device.uuid)) {
+	if (!dm_task_set_uuid(dmt, uuid)) {
 		dm_task_destroy(dmt);
 		return_NULL;
 	}
@@ -724,10 +750,20 @@ static int _get_parameters(struct message_data *message_data) {
 	int size;
 
 	free(msg->data);
-	if ((size = dm_asprintf(&msg->data, "%s pid=%d daemon=%s exec_method=%s",
-				message_data->id, getpid(),
-				_foreground ? "no" : "yes",
-				_systemd_activation ? "systemd" : "direct")) < 0) {
+	pthread_mutex_lock(&_timeout_mutex);
+	size = dm_asprintf(&msg->data, "%s pid=%d daemon=%s exec_method=%s"
+			   " sweeps=%" PRIu64 " sweep_devices=%" PRIu64
+			   " sweep_last_usec=%" PRIu64 " sweep_max_usec=%" PRIu64
+			   " sweep_total_usec=%" PRIu64,
+			   message_data->id, getpid(),
+			   _foreground ? "no" : "yes",
+			   _systemd_activation ? "systemd" : "direct",
+			   _sweep_stats.sweeps, _sweep_stats.devices,
+			   _sweep_stats.last_usec, _sweep_stats.max_usec,
+			   _sweep_stats.total_usec);
+	pthread_mutex_unlock(&_timeout_mutex);
+
+	if (size < 0) {
 		stack;
 		return -ENOMEM;
 	}
@@ -750,13 +786,168 @@ static void _exit_timeout(void *unused __attribute__((unused)))
 	pthread_mutex_unlock(&_timeout_mutex);
 }
 
+static uint64_t _get_usecs(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Device due for a timeout event, collected by a sweep */
+struct sweep_device {
+	struct thread_status *thread;
+	char *uuid;
+	struct dm_task *dmt;
+};
+
+/*
+ * Collect the devices due for a timeout event and not processing one.
+ *
+ * Mutex _timeout_mutex is held.
+ */
+static unsigned _sweep_collect(struct sweep_device *devs, unsigned size,
+			       time_t curr_time, time_t *next_time)
+{
+	struct thread_status *thread;
+	unsigned count = 0;
+	int processing;
+
+	dm_list_iterate_items_gen(thread, &_timeout_registry, timeout_list) {
+		if (thread->next_time <= curr_time) {
+			thread->next_time = curr_time + thread->timeout;
+
+			_lock_mutex();
+			processing = thread->processing;
+			_unlock_mutex();
+
+			if (processing)
+				/* Cannot signal processing monitoring thread */
+				log_debug("Skipping SIGALRM to processing Thr %x for timeout.",
+					  (int) thread->thread);
+			else if ((count < size) &&
+				 (devs[count].uuid = strdup(thread->device.uuid))) {
+				devs[count].thread = thread;
+				devs[count].dmt = NULL;
+				count++;
+			} else
+				log_debug("Skipping timeout of %s.", thread->device.name);
+		}
+
+		if (thread->next_time < *next_time || !*next_time)
+			*next_time = thread->next_time;
+	}
+
+	return count;
+}
+
+/*
+ * Hand the status read by the sweep to the monitoring thread
+ * and wake it up to process the timeout.
+ *
+ * Mutex _timeout_mutex is held, so a thread still registered
+ * for timeouts cannot go away.
+ */
+static void _sweep_deliver(struct sweep_device *dev)
+{
+	struct thread_status *thread;
+	int ret;
+
+	dm_list_iterate_items_gen(thread, &_timeout_registry, timeout_list)
+		if ((thread == dev->thread) && !strcmp(thread->device.uuid, dev->uuid))
+			break;
+
+	if (&thread->timeout_list == &_timeout_registry) {
+		DEBUGLOG("Skipping timeout of unregistered %s.", dev->uuid);
+		return;
+	}
+
+	_lock_mutex();
+	if (thread->processing)
+		log_debug("Skipping SIGALRM to processing Thr %x for timeout.",
+			  (int) thread->thread);
+	else {
+		if (thread->status_task)
+			dm_task_destroy(thread->status_task);
+		thread->status_task = dev->dmt;
+		dev->dmt = NULL;
+
+		DEBUGLOG("Sending SIGALRM to Thr %x for timeout.",
+			 (int) thread->thread);
+		ret = pthread_kill(thread->thread, SIGALRM);
+		if (ret && (ret != ESRCH))
+			log_error("Unable to wakeup Thr %x for timeout: %s.",
+				  (int) thread->thread, strerror(ret));
+	}
+	_unlock_mutex();
+}
+
+/*
+ * Read status of all devices due for a timeout event at the same time
+ * and wake up their monitoring threads, so they do not have to issue
+ * their own status ioctl.  The ioctls run without _timeout_mutex, so
+ * registration and rescheduling of timeouts are not held up by a slow
+ * device.
+ *
+ * Mutex _timeout_mutex is held on entry and exit.
+ * Returns number of devices swept, 0 when nothing is due yet.
+ */
+static unsigned _sweep_timeouts(time_t *next_time)
+{
+	struct sweep_device *devs;
+	uint64_t start, usecs;
+	unsigned i, size, count, devices = 0;
+
+	size = dm_list_size(&_timeout_registry);
+	if (!(devs = malloc(size * sizeof(*devs))))
+		size = 0;
+
+	if (!(count = _sweep_collect(devs, size, time(NULL), next_time))) {
+		free(devs);
+		return 0;
+	}
+
+	pthread_mutex_unlock(&_timeout_mutex);
+
+	start = _get_usecs();
+	for (i = 0; i < count; ++i)
+		if (!(devs[i].dmt = _get_device_status(devs[i].uuid)))
+			log_debug("Failed to read status of %s for timeout.",
+				  devs[i].uuid);
+		else
+			devices++;
+	usecs = _get_usecs() - start;
+
+	pthread_mutex_lock(&_timeout_mutex);
+
+	for (i = 0; i < count; ++i) {
+		_sweep_deliver(&devs[i]);
+		if (devs[i].dmt)
+			dm_task_destroy(devs[i].dmt);
+		free(devs[i].uuid);
+	}
+	free(devs);
+
+	if (devices) {
+		_sweep_stats.sweeps++;
+		_sweep_stats.devices += devices;
+		_sweep_stats.last_usec = usecs;
+		_sweep_stats.total_usec += usecs;
+		if (usecs > _sweep_stats.max_usec)
+			_sweep_stats.max_usec = usecs;
+		DEBUGLOG("Status sweep of %u devices took %" PRIu64 " us.",
+			 devices, usecs);
+	}
+
+	return count;
+}
+
 /* Wake up monitor threads every so often. */
 static void *_timeout_thread(void *unused __attribute__((unused)))
 {
-	struct thread_status *thread;
 	struct timespec timeout;
-	time_t curr_time;
-	int ret;
 
 	DEBUGLOG("Timeout thread starting.");
 	pthread_cleanup_push(_exit_timeout, NULL);
@@ -765,33 +956,11 @@ static void *_timeout_thread(void *unused __attribute__((unused)))
 	while (!dm_list_empty(&_timeout_registry)) {
 		timeout.tv_sec = 0;
 		timeout.tv_nsec = 0;
-		curr_time = time(NULL);
-
-		dm_list_iterate_items_gen(thread, &_timeout_registry, timeout_list) {
-			if (thread->next_time <= curr_time) {
-				thread->next_time = curr_time + thread->timeout;
-				_lock_mutex();
-				if (thread->processing) {
-					/* Cannot signal processing monitoring thread */
-					log_debug("Skipping SIGALRM to processing Thr %x for timeout.",
-						  (int) thread->thread);
-				} else {
-					DEBUGLOG("Sending SIGALRM to Thr %x for timeout.",
-						 (int) thread->thread);
-					ret = pthread_kill(thread->thread, SIGALRM);
-					if (ret && (ret != ESRCH))
-						log_error("Unable to wakeup Thr %x for timeout: %s.",
-							  (int) thread->thread, strerror(ret));
-				}
-				_unlock_mutex();
-			}
 
-			if (thread->next_time < timeout.tv_sec || !timeout.tv_sec)
-				timeout.tv_sec = thread->next_time;
-		}
-
-		pthread_cond_timedwait(&_timeout_cond, &_timeout_mutex,
-				       &timeout);
+		/* After a sweep the registry may have changed, recalculate */
+		if (!_sweep_timeouts(&timeout.tv_sec))
+			pthread_cond_timedwait(&_timeout_cond, &_timeout_mutex,
+					       &timeout);
 	}
 
 	DEBUGLOG("Timeout thread finished.");
@@ -822,6 +991,17 @@ static int _register_for_timeout(struct thread_status *thread)
 	return ret;
 }
 
+/* Reschedule next timeout event of a thread as requested by its DSO. */
+static void _set_next_timeout(struct thread_status *thread, uint32_t secs)
+{
+	pthread_mutex_lock(&_timeout_mutex);
+	if (!dm_list_empty(&thread->timeout_list)) {
+		thread->next_time = time(NULL) + secs;
+		pthread_cond_signal(&_timeout_cond);
+	}
+	pthread_mutex_unlock(&_timeout_mutex);
+}
+
 static void _unregister_for_timeout(struct thread_status *thread)
 {
 	pthread_mutex_lock(&_timeout_mutex);
@@ -935,11 +1115,16 @@ static int _do_unregister_device(struct thread_status *thread)
 /* Process an event in the DSO. */
 static void _do_process_event(struct thread_status *thread)
 {
-	struct dm_task *task;
+	struct dm_task *task = thread->wait_task;
+	uint32_t secs;
 
-	/* NOTE: timeout event gets status */
-	task = (thread->current_events & DM_EVENT_TIMEOUT)
-		? _get_device_status(thread) : thread->wait_task;
+	/* NOTE: timeout event gets status, preferably from timeout sweep */
+	if (thread->current_events & DM_EVENT_TIMEOUT) {
+		if ((task = thread->status_task))
+			thread->status_task = NULL;
+		else
+			task = _get_device_status(thread->device.uuid);
+	}
 
 	if (!task)
 		log_error("Lost event in Thr %x.", (int)thread->thread);
@@ -948,6 +1133,12 @@ static void _do_process_event(struct thread_status *thread)
 		if (task != thread->wait_task)
 			dm_task_destroy(task);
 	}
+
+	if ((thread->current_events & DM_EVENT_TIMEOUT) &&
+	    thread->dso_data->next_timeout &&
+	    (secs = thread->dso_data->next_timeout(thread->timeout, &(thread->dso_private))) &&
+	    (secs != thread->timeout))
+		_set_next_timeout(thread, secs);
 }
 
 static void _thread_unused(struct thread_status *thread)
@@ -1601,6 +1792,9 @@ static int _handle_request(struct dm_event_daemon_message *msg,
 	 * 	daemon - running as a daemon or not (foreground)?
 	 * 	exec_method - "direct" if executed directly or
 	 * 		      "systemd" if executed via systemd
+	 * followed by timeout status sweep counters
+	 * 'sweeps=<n> sweep_devices=<n> sweep_last_usec=<us>
+	 *  sweep_max_usec=<us> sweep_total_usec=<us>'
 	 */
 	case DM_EVENT_CMD_GET_PARAMETERS:
 		return _get_parameters(message_data);
@@ -131,5 +131,7 @@ void process_event(struct dm_task *dmt, enum dm_event_mask evmask, void **user);
 int register_device(const char *device_name, const char *uuid, int major, int minor, void **user);
 int unregister_device(const char *device_name, const char *uuid, int major,
 		      int minor, void **user);
+/* Optional: seconds until next timeout event, 0 keeps registered timeout */
+uint32_t next_timeout(uint32_t timeout, void **user);
 
 #endif
@@ -189,3 +189,35 @@ int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
 
 	return 1;
 }
+
+/* Polling twice as often above 95%. */
+#define POLL_FULL_THRESH	(DM_PERCENT_1 * 95)
+/* Usage change considered as activity. */
+#define POLL_ACTIVE_STEP	(DM_PERCENT_1 / 2)
+
+uint32_t dmeventd_lvm2_poll_interval(struct dmeventd_lvm2_poll *poll,
+				     int percent, int threshold, uint32_t timeout)
+{
+	int delta = percent - poll->last_percent;
+
+	poll->last_percent = percent;
+
+	if (!timeout)
+		return 0;
+
+	if (percent >= POLL_FULL_THRESH) {
+		poll->idle = 0;
+		return (timeout > 1) ? timeout / 2 : 1;
+	}
+
+	if ((percent > threshold) ||
+	    (delta >= POLL_ACTIVE_STEP) || (delta <= -POLL_ACTIVE_STEP)) {
+		poll->idle = 0;
+		return timeout;
+	}
+
+	if (poll->idle < (DMEVENTD_LVM2_POLL_IDLE_MAX - 1))
+		poll->idle++;
+
+	return timeout * (poll->idle + 1);
+}
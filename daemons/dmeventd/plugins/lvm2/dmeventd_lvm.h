@@ -39,6 +39,25 @@ struct dm_pool *dmeventd_lvm2_pool(void);
 int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
 			  const char *cmd, const char *device);
 
+/*
+ * Adaptive status polling of pool-like devices.
+ *
+ * Keeps the registered timeout while the device is above the threshold
+ * from which the plugin acts (its first policy check) or its usage is
+ * changing, polls twice as often once it is almost full and
+ * gradually backs off up to DMEVENTD_LVM2_POLL_IDLE_MAX times
+ * the registered timeout while usage stays the same.
+ */
+#define DMEVENTD_LVM2_POLL_IDLE_MAX	6
+
+struct dmeventd_lvm2_poll {
+	int last_percent;	/* dm_percent_t seen at the previous poll */
+	unsigned idle;		/* Number of polls without usage change */
+};
+
+uint32_t dmeventd_lvm2_poll_interval(struct dmeventd_lvm2_poll *poll,
+				     int percent, int threshold, uint32_t timeout);
+
 #define dmeventd_lvm2_run_with_lock(cmdline) \
 	({\
 		int rc;\
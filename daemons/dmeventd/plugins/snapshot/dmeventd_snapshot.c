@@ -33,7 +33,9 @@
 struct dso_state {
 	struct dm_pool *mem;
 	dm_percent_t percent_check;
+	dm_percent_t percent;
 	uint64_t known_size;
+	struct dmeventd_lvm2_poll poll;
 	char cmd_lvextend[512];
 };
 
@@ -171,7 +173,7 @@ void process_event(struct dm_task *dmt,
 	uint64_t start, length;
 	char *target_type = NULL;
 	char *params;
-	struct dm_status_snapshot *status = NULL;
+	struct dm_status_snapshot status;
 	const char *device = dm_task_get_name(dmt);
 	int percent;
 	struct dm_info info;
@@ -186,7 +188,7 @@ void process_event(struct dm_task *dmt,
 		return;
 	}
 
-	if (!dm_get_status_snapshot(state->mem, params, &status)) {
+	if (!dm_get_status_snapshot_into(params, &status)) {
 		log_error("Cannot parse snapshot %s state: %s.", device, params);
 		return;
 	}
@@ -195,7 +197,7 @@ void process_event(struct dm_task *dmt,
 	 * If the snapshot has been invalidated or we failed to parse
 	 * the status string. Report the full status string to syslog.
 	 */
-	if (status->invalid || status->overflow || !status->total_sectors) {
+	if (status.invalid || status.overflow || !status.total_sectors) {
 		log_warn("WARNING: Snapshot %s changed state to: %s and should be removed.",
 			 device, params);
 		state->percent_check = 0;
@@ -206,24 +208,24 @@ void process_event(struct dm_task *dmt,
 		_remove(dm_task_get_uuid(dmt));
 #endif
 		pthread_kill(pthread_self(), SIGALRM);
-		goto out;
+		return;
 	}
 
-	if (length <= (status->used_sectors - status->metadata_sectors)) {
+	if (length <= (status.used_sectors - status.metadata_sectors)) {
 		/* TODO eventually recognize earlier when room is enough */
 		log_info("Dropping monitoring of fully provisioned snapshot %s.",
 			 device);
 		pthread_kill(pthread_self(), SIGALRM);
-		goto out;
+		return;
 	}
 
 	/* Snapshot size had changed. Clear the threshold. */
-	if (state->known_size != status->total_sectors) {
+	if (state->known_size != status.total_sectors) {
 		state->percent_check = CHECK_MINIMUM;
-		state->known_size = status->total_sectors;
+		state->known_size = status.total_sectors;
 	}
 
-	percent = dm_make_percent(status->used_sectors, status->total_sectors);
+	percent = state->percent = dm_make_percent(status.used_sectors, status.total_sectors);
 	if (percent >= state->percent_check) {
 		/* Usage has raised more than CHECK_STEP since the last
 		   time. Run actions. */
@@ -237,8 +239,18 @@ void process_event(struct dm_task *dmt,
 		if (!_extend(state->cmd_lvextend))
 			log_error("Failed to extend snapshot %s.", device);
 	}
-out:
-	dm_pool_free(state->mem, status);
+}
+
+uint32_t next_timeout(uint32_t timeout, void **user)
+{
+	struct dso_state *state = *user;
+
+	/* No longer monitoring, waiting for remove */
+	if (!state->percent_check)
+		return timeout;
+
+	return dmeventd_lvm2_poll_interval(&state->poll, state->percent,
+					   CHECK_MINIMUM, timeout);
 }
 
 int register_device(const char *device,
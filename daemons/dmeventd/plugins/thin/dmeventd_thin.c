@@ -51,6 +51,7 @@ struct dso_state {
 	int data_percent;
 	uint64_t known_metadata_size;
 	uint64_t known_data_size;
+	struct dmeventd_lvm2_poll poll;
 	unsigned fails;
 	unsigned max_fails;
 	int restore_sigset;
@@ -160,7 +161,7 @@ void process_event(struct dm_task *dmt,
 {
 	const char *device = dm_task_get_name(dmt);
 	struct dso_state *state = *user;
-	struct dm_status_thin_pool *tps = NULL;
+	struct dm_status_thin_pool tps;
 	void *next = NULL;
 	uint64_t start, length;
 	char *target_type = NULL;
@@ -217,7 +218,7 @@ void process_event(struct dm_task *dmt,
 		goto out;
 	}
 
-	if (!dm_get_status_thin_pool(state->mem, params, &tps)) {
+	if (!dm_get_status_thin_pool_into(params, &tps)) {
 		log_error("Failed to parse status.");
 		goto out;
 	}
@@ -225,20 +226,20 @@ void process_event(struct dm_task *dmt,
 #if THIN_DEBUG
 	log_debug("Thin pool status " FMTu64 "/" FMTu64 "  "
 		  FMTu64 "/" FMTu64 ".",
-		  tps->used_metadata_blocks, tps->total_metadata_blocks,
-		  tps->used_data_blocks, tps->total_data_blocks);
+		  tps.used_metadata_blocks, tps.total_metadata_blocks,
+		  tps.used_data_blocks, tps.total_data_blocks);
 #endif
 
 	/* Thin pool size had changed. Clear the threshold. */
-	if (state->known_metadata_size != tps->total_metadata_blocks) {
+	if (state->known_metadata_size != tps.total_metadata_blocks) {
 		state->metadata_percent_check = CHECK_MINIMUM;
-		state->known_metadata_size = tps->total_metadata_blocks;
+		state->known_metadata_size = tps.total_metadata_blocks;
 		state->fails = 0;
 	}
 
-	if (state->known_data_size != tps->total_data_blocks) {
+	if (state->known_data_size != tps.total_data_blocks) {
 		state->data_percent_check = CHECK_MINIMUM;
-		state->known_data_size = tps->total_data_blocks;
+		state->known_data_size = tps.total_data_blocks;
 		state->fails = 0;
 	}
 
@@ -248,7 +249,7 @@ void process_event(struct dm_task *dmt,
 	 * Only 100% is exception as it cannot be surpased so policy
 	 * action is called for:  >50%, >55% ... >95%, 100%
 	 */
-	state->metadata_percent = dm_make_percent(tps->used_metadata_blocks, tps->total_metadata_blocks);
+	state->metadata_percent = dm_make_percent(tps.used_metadata_blocks, tps.total_metadata_blocks);
 	if ((state->metadata_percent > WARNING_THRESH) &&
 	    (state->metadata_percent > state->metadata_percent_check))
 		log_warn("WARNING: Thin pool %s metadata is now %.2f%% full.",
@@ -263,7 +264,7 @@ void process_event(struct dm_task *dmt,
 	} else
 		state->metadata_percent_check = CHECK_MINIMUM;
 
-	state->data_percent = dm_make_percent(tps->used_data_blocks, tps->total_data_blocks);
+	state->data_percent = dm_make_percent(tps.used_data_blocks, tps.total_data_blocks);
 	if ((state->data_percent > WARNING_THRESH) &&
 	    (state->data_percent > state->data_percent_check))
 		log_warn("WARNING: Thin pool %s data is now %.2f%% full.",
@@ -297,13 +298,24 @@ void process_event(struct dm_task *dmt,
 	if (needs_policy)
 		_use_policy(dmt, state);
 out:
-	if (tps)
-		dm_pool_free(state->mem, tps);
-
 	if (new_dmt)
 		dm_task_destroy(new_dmt);
 }
 
+uint32_t next_timeout(uint32_t timeout, void **user)
+{
+	struct dso_state *state = *user;
+
+	/* Keep checking often while policy is failing or command runs */
+	if (state->fails || (state->pid != -1))
+		return timeout;
+
+	return dmeventd_lvm2_poll_interval(&state->poll,
+					   (state->data_percent > state->metadata_percent) ?
+					   state->data_percent : state->metadata_percent,
+					   CHECK_MINIMUM, timeout);
+}
+
 /* Handle SIGCHLD for a thread */
 static void _sig_child(int signum __attribute__((unused)))
 {
@@ -36,6 +36,7 @@ struct dso_state {
 	int percent_check;
 	int percent;
 	uint64_t known_data_size;
+	struct dmeventd_lvm2_poll poll;
 	unsigned fails;
 	unsigned max_fails;
 	int restore_sigset;
@@ -264,6 +265,18 @@ out:
 		dm_task_destroy(new_dmt);
 }
 
+uint32_t next_timeout(uint32_t timeout, void **user)
+{
+	struct dso_state *state = *user;
+
+	/* Keep checking often while policy is failing or command runs */
+	if (state->fails || (state->pid != -1))
+		return timeout;
+
+	return dmeventd_lvm2_poll_interval(&state->poll, state->percent,
+					   CHECK_MINIMUM, timeout);
+}
+
 /* Handle SIGCHLD for a thread */
 static void _sig_child(int signum __attribute__((unused)))
 {
@@ -30,6 +30,13 @@ static inline daemon_handle lvmlockd_open(const char *sock)
 	return daemon_open(lvmlockd_info);
 }
 
+/*
+ * Maximum number of LVs named in one lock_lv request.  The first LV
+ * uses the plain lv_name/lv_uuid/lv_lock_args fields, the others use
+ * the same fields suffixed with _1, _2, ...
+ */
+#define LVMLOCKD_LV_BATCH_MAX 256
+
 static inline void lvmlockd_close(daemon_handle h)
 {
 	return daemon_close(h);
@@ -553,6 +553,17 @@ static void free_lock(struct lock *lk)
 	pthread_mutex_unlock(&unused_struct_mutex);
 }
 
+/*
+ * Remove a resource from ls->resources and from the index
+ * of lv resources if it is one.
+ */
+static void unlink_resource(struct lockspace *ls, struct resource *r)
+{
+	if (r->type == LD_RT_LV && ls->lv_resources)
+		dm_hash_remove(ls->lv_resources, r->name);
+	list_del(&r->list);
+}
+
 static int setup_structs(void)
 {
 	struct action *act;
@@ -866,18 +877,39 @@ static int lm_lock(struct lockspace *ls, struct resource *r, int mode, struct ac
 {
 	int rv;
 
+	/*
+	 * Use the result of a pipelined request from lm_lock_async when
+	 * it was for this mode.  Otherwise a lock acquired in another
+	 * mode is converted by the normal request.
+	 */
+	if (r->lm_async) {
+		r->lm_async = 0;
+		if (!adopt && (r->lm_async_mode == mode)) {
+			memset(vb_out, 0, sizeof(struct val_blk));
+			rv = r->lm_async_rv;
+			goto out;
+		}
+	}
+
 	if (ls->lm_type == LD_LM_DLM)
 		rv = lm_lock_dlm(ls, r, mode, vb_out, adopt);
 	else if (ls->lm_type == LD_LM_SANLOCK)
 		rv = lm_lock_sanlock(ls, r, mode, vb_out, retry, adopt);
 	else
 		return -1;
-
+out:
 	if (act)
 		act->lm_rv = rv;
 	return rv;
 }
 
+static int lm_lock_async(struct lockspace *ls, struct resource **rs, int count)
+{
+	if (ls->lm_type == LD_LM_DLM)
+		return lm_lock_async_dlm(ls, rs, count);
+	return 0;
+}
+
 static int lm_convert(struct lockspace *ls, struct resource *r,
 		      int mode, struct action *act, uint32_t r_version)
 {
@@ -956,6 +988,11 @@ static void add_client_result(struct action *act)
 	}
 
 	pthread_mutex_lock(&client_mutex);
+	if (act->batch && (++act->batch->done < act->batch->count)) {
+		/* The last action of the batch carries the reply for all. */
+		pthread_mutex_unlock(&client_mutex);
+		return;
+	}
 	if (act->flags & LD_AF_ADOPT)
 		list_add_tail(&act->list, &adopt_results);
 	else
@@ -1990,7 +2027,7 @@ r_free:
 	}
 	log_debug("S %s R %s res_process free", ls->name, r->name);
 	lm_rem_resource(ls, r);
-	list_del(&r->list);
+	unlink_resource(ls, r);
 	free_resource(r);
 }
 
@@ -2093,7 +2130,7 @@ static int clear_locks(struct lockspace *ls, int free_vg, int drop_vg)
  r_free:
 		log_debug("S %s R %s free", ls->name, r->name);
 		lm_rem_resource(ls, r);
-		list_del(&r->list);
+		unlink_resource(ls, r);
 		free_resource(r);
 	}
 
@@ -2104,7 +2141,11 @@ static int clear_locks(struct lockspace *ls, int free_vg, int drop_vg)
  * find and return the resource that is referenced by the action
  * - there is a single gl resource per lockspace
  * - there is a single vg resource per lockspace
- * - there can be many lv resources per lockspace, compare names
+ * - there can be many lv resources per lockspace, these are
+ *   found by lv uuid in ls->lv_resources
+ *
+ * gl and vg resources are kept at the head of ls->resources,
+ * so looking for them stops at the first lv resource.
  */
 
 static struct resource *find_resource_act(struct lockspace *ls,
@@ -2113,24 +2154,29 @@ static struct resource *find_resource_act(struct lockspace *ls,
 {
 	struct resource *r;
 
-	list_for_each_entry(r, &ls->resources, list) {
-		if (r->type != act->rt)
-			continue;
-
-		if (r->type == LD_RT_GL && act->rt == LD_RT_GL)
-			return r;
-
-		if (r->type == LD_RT_VG && act->rt == LD_RT_VG)
+	if (act->rt == LD_RT_LV) {
+		if (ls->lv_resources &&
+		    (r = dm_hash_lookup(ls->lv_resources, act->lv_uuid)))
 			return r;
+	} else {
+		list_for_each_entry(r, &ls->resources, list) {
+			if (r->type == LD_RT_LV)
+				break;
 
-		if (r->type == LD_RT_LV && act->rt == LD_RT_LV &&
-		    !strcmp(r->name, act->lv_uuid))
-			return r;
+			if (r->type == act->rt)
+				return r;
+		}
 	}
 
 	if (nocreate)
 		return NULL;
 
+	if (act->rt == LD_RT_LV && !ls->lv_resources &&
+	    !(ls->lv_resources = dm_hash_create(1024))) {
+		log_error("out of memory for lv resources index");
+		return NULL;
+	}
+
 	if (!(r = alloc_resource()))
 		return NULL;
 
@@ -2148,7 +2194,15 @@ static struct resource *find_resource_act(struct lockspace *ls,
 		r->use_vb = 0;
 	}
 
-	list_add_tail(&r->list, &ls->resources);
+	if (r->type == LD_RT_LV) {
+		if (!dm_hash_insert(ls->lv_resources, r->name, r)) {
+			log_error("out of memory for lv resources index");
+			free_resource(r);
+			return NULL;
+		}
+		list_add_tail(&r->list, &ls->resources);
+	} else
+		list_add(&r->list, &ls->resources);
 
 	return r;
 }
@@ -2159,9 +2213,14 @@ static void free_ls_resources(struct lockspace *ls)
 
 	list_for_each_entry_safe(r, r_safe, &ls->resources, list) {
 		lm_rem_resource(ls, r);
-		list_del(&r->list);
+		unlink_resource(ls, r);
 		free_resource(r);
 	}
+
+	if (ls->lv_resources) {
+		dm_hash_destroy(ls->lv_resources);
+		ls->lv_resources = NULL;
+	}
 }
 
 /*
@@ -2207,6 +2266,87 @@ static int process_op_during_kill(struct action *act)
 	return 1;
 }
 
+/*
+ * Pipelined lv lock requests.
+ *
+ * Lock requests made by res_lock are synchronous, so acquiring many
+ * lv locks costs one lock manager round trip after another.  Before
+ * processing the queued actions, find lv resources whose first queued
+ * action will be passed to the lock manager by res_lock, and let the
+ * lock manager have all of these requests in flight together.
+ * res_lock then takes the result through lm_lock in the usual order
+ * of actions on each resource.
+ *
+ * Returns the number of resources with requests made.
+ */
+
+#define MAX_ASYNC_LOCKS 128
+
+static int lock_lvs_async(struct lockspace *ls)
+{
+	struct resource *rs[MAX_ASYNC_LOCKS];
+	struct resource *r;
+	struct action *act;
+	int count = 0;
+
+	if (ls->lm_type != LD_LM_DLM)
+		return 0;
+
+	list_for_each_entry(r, &ls->resources, list) {
+		if (r->type != LD_RT_LV || list_empty(&r->actions))
+			continue;
+
+		if (r->mode != LD_LK_UN || !list_empty(&r->locks))
+			continue;
+
+		act = list_first_entry(&r->actions, struct action, list);
+
+		if (act->op != LD_OP_LOCK || (act->flags & LD_AF_ADOPT) ||
+		    (act->mode != LD_LK_SH && act->mode != LD_LK_EX))
+			continue;
+
+		r->lm_async = 0;
+		r->lm_async_mode = act->mode;
+		rs[count++] = r;
+
+		if (count == MAX_ASYNC_LOCKS)
+			break;
+	}
+
+	/* Nothing to gain from a single request. */
+	if (count < 2)
+		return 0;
+
+	if (lm_lock_async(ls, rs, count) < 0)
+		return 0;
+
+	return count;
+}
+
+/*
+ * A pipelined lock that was not used by res_lock, e.g. because the
+ * client went away and its action was canceled, is still held by the
+ * lock manager.  Convert it back to NL like an unlock would.
+ */
+
+static void unlock_lvs_async(struct lockspace *ls)
+{
+	struct resource *r;
+
+	list_for_each_entry(r, &ls->resources, list) {
+		if (!r->lm_async)
+			continue;
+
+		r->lm_async = 0;
+
+		if (r->lm_async_rv < 0 || r->mode != LD_LK_UN)
+			continue;
+
+		log_debug("S %s R %s unlock unused async lock", ls->name, r->name);
+		lm_unlock(ls, r, NULL, 0, 0);
+	}
+}
+
 /*
  * Process actions queued for this lockspace by
  * client_recv_action / add_lock_action.
@@ -2232,6 +2372,7 @@ static void *lockspace_thread_main(void *arg_in)
 	int error = 0;
 	int adopt_flag = 0;
 	int wait_flag = 0;
+	int async_count;
 	int retry;
 	int rv;
 
@@ -2476,8 +2617,20 @@ static void *lockspace_thread_main(void *arg_in)
 
 		retry = 0;
 
-		list_for_each_entry_safe(r, r2, &ls->resources, list)
+		async_count = lock_lvs_async(ls);
+
+		/*
+		 * A resource without queued actions only needs processing
+		 * when some client has closed its connection.
+		 */
+		list_for_each_entry_safe(r, r2, &ls->resources, list) {
+			if (list_empty(&r->actions) && list_empty(&act_close))
+				continue;
 			res_process(ls, r, &act_close, &retry);
+		}
+
+		if (async_count)
+			unlock_lvs_async(ls);
 
 		list_for_each_entry_safe(act, safe, &act_close, list) {
 			list_del(&act->list);
@@ -2518,6 +2671,11 @@ out_rem:
 
 	rv = clear_locks(ls, free_vg, drop_vg);
 
+	if (ls->lv_resources) {
+		dm_hash_destroy(ls->lv_resources);
+		ls->lv_resources = NULL;
+	}
+
 	/*
 	 * Tell any other hosts in the lockspace to leave it
 	 * before we remove it (for vgremove).  We do this
@@ -3692,6 +3850,41 @@ static int client_send_result(struct client *cl, struct action *act)
 					  "result = " FMTd64, (int64_t) act->result,
 					  "dump_len = " FMTd64, (int64_t) dump_len,
 					  NULL);
+	} else if (act->batch) {
+		/*
+		 * A lock_lv request for several LVs gets the result of
+		 * each one, in the order they were named in the request.
+		 */
+		struct action *act_lv;
+		char line[64];
+		int i;
+
+		log_debug("send %s[%d] cl %u %s %s batch of %d",
+			  cl->name[0] ? cl->name : "client", cl->pid, cl->id,
+			  op_str(act->op), rt_str(act->rt), act->batch->count);
+
+		res = daemon_reply_simple("OK",
+					  "op = " FMTd64, (int64_t) act->op,
+					  "lock_type = %s", lm_str(act->lm_type),
+					  "op_result = " FMTd64, (int64_t) 0,
+					  "lv_count = " FMTd64, (int64_t) act->batch->count,
+					  "result_flags = %s", result_flags[0] ? result_flags : "none",
+					  NULL);
+
+		for (i = 0; i < act->batch->count; i++) {
+			act_lv = act->batch->acts[i];
+
+			if (act_lv->result == -EUNATCH)
+				act_lv->result = -ENOLS;
+
+			log_debug("send cl %u batch %d lv %s rv %d",
+				  cl->id, i, act_lv->lv_name, act_lv->result);
+
+			snprintf(line, sizeof(line), "op_result_%d = %d\nlm_result_%d = %d\n",
+				 i, act_lv->result, i, act_lv->lm_rv);
+			if (!buffer_append(&res.buffer, line))
+				res.error = ENOMEM;
+		}
 	} else {
 		/*
 		 * A normal reply.
@@ -3870,7 +4063,23 @@ static int add_lock_action(struct action *act)
 		return -ESTARTING;
 	}
 
-	list_add_tail(&act->list, &ls->actions);
+	if (act->batch) {
+		/*
+		 * All LVs of a batch are in the same VG.  Queue them
+		 * together so that the lockspace thread finds them in
+		 * one pass and can pipeline the lock manager requests.
+		 */
+		struct action *act_lv;
+		int i;
+
+		for (i = 0; i < act->batch->count; i++) {
+			act_lv = act->batch->acts[i];
+			act_lv->lm_type = act->lm_type;
+			list_add_tail(&act_lv->list, &ls->actions);
+		}
+	} else {
+		list_add_tail(&act->list, &ls->actions);
+	}
 	ls->thread_work = 1;
 	pthread_cond_signal(&ls->cond);
 	pthread_mutex_unlock(&ls->mutex);
@@ -4363,6 +4572,74 @@ out:
 }
 
 /* called from client_thread, cl->mutex is held */
+/*
+ * A lock_lv request with lv_count > 1 names more LVs after the first
+ * one (which is in act already).  Each additional LV gets a copy of
+ * act with its own lv fields, and all are tied together in a batch.
+ */
+static int recv_lv_batch(request req, struct action *act, int count)
+{
+	struct lock_batch *batch;
+	struct action *act_lv;
+	const char *name, *uuid, *args;
+	char key[32];
+	int i, rv = -EINVAL;
+
+	if (count > LVMLOCKD_LV_BATCH_MAX) {
+		log_error("client recv lock_lv lv_count %d too large", count);
+		return -EINVAL;
+	}
+
+	if (!(batch = malloc(sizeof(struct lock_batch) + count * sizeof(struct action *))))
+		return -ENOMEM;
+
+	batch->count = 1;
+	batch->done = 0;
+	batch->acts[0] = act;
+
+	for (i = 1; i < count; i++) {
+		snprintf(key, sizeof(key), "lv_name_%d", i);
+		name = daemon_request_str(req, key, NULL);
+		snprintf(key, sizeof(key), "lv_uuid_%d", i);
+		uuid = daemon_request_str(req, key, NULL);
+		snprintf(key, sizeof(key), "lv_lock_args_%d", i);
+		args = daemon_request_str(req, key, NULL);
+
+		if (!name || !uuid || !strcmp(name, "none") || !strcmp(uuid, "none")) {
+			log_error("client recv lock_lv batch missing lv %d", i);
+			goto fail;
+		}
+
+		if (!(act_lv = alloc_action())) {
+			rv = -ENOMEM;
+			goto fail;
+		}
+
+		memcpy(act_lv, act, sizeof(struct action));
+		memset(act_lv->lv_name, 0, sizeof(act_lv->lv_name));
+		memset(act_lv->lv_uuid, 0, sizeof(act_lv->lv_uuid));
+		memset(act_lv->lv_args, 0, sizeof(act_lv->lv_args));
+
+		strncpy(act_lv->lv_name, name, MAX_NAME);
+		strncpy(act_lv->lv_uuid, uuid, MAX_NAME);
+		if (args && strcmp(args, "none"))
+			strncpy(act_lv->lv_args, args, MAX_ARGS);
+
+		batch->acts[batch->count++] = act_lv;
+	}
+
+	for (i = 0; i < batch->count; i++)
+		batch->acts[i]->batch = batch;
+
+	return 0;
+
+fail:
+	for (i = 1; i < batch->count; i++)
+		free_action(batch->acts[i]);
+	free(batch);
+	return rv;
+}
+
 static void client_recv_action(struct client *cl)
 {
 	request req;
@@ -4378,7 +4655,9 @@ static void client_recv_action(struct client *cl)
 	int result = 0;
 	int cl_pid;
 	int op, rt, lm, mode;
-	int rv;
+	int lv_count;
+	int batch_rv = 0;
+	int i, rv;
 
 	buffer_init(&req.buffer);
 
@@ -4526,6 +4805,12 @@ static void client_recv_action(struct client *cl)
 
 	act->max_retries = daemon_request_int(req, "max_retries", DEFAULT_MAX_RETRIES);
 
+	lv_count = 0;
+	if (op == LD_OP_LOCK && rt == LD_RT_LV)
+		lv_count = daemon_request_int(req, "lv_count", 0);
+	if (lv_count > 1)
+		batch_rv = recv_lv_batch(req, act, lv_count);
+
 	dm_config_destroy(req.cft);
 	buffer_destroy(&req.buffer);
 
@@ -4545,9 +4830,34 @@ static void client_recv_action(struct client *cl)
 		goto out;
 	}
 
+	if (batch_rv < 0) {
+		rv = batch_rv;
+		goto out;
+	}
+
 	if (act->op == LD_OP_LOCK && act->mode != LD_LK_UN)
 		cl->lock_ops = 1;
 
+	if (act->batch) {
+		struct lock_batch *batch = act->batch;
+
+		/*
+		 * add_lock_action queues the whole batch.  If it fails,
+		 * every LV gets the error and add_client_result sends
+		 * the reply once the last one is added.
+		 */
+		log_debug("recv cl %u lock_lv batch of %d", cl->id, batch->count);
+
+		rv = add_lock_action(act);
+		if (rv < 0) {
+			for (i = 0; i < batch->count; i++) {
+				batch->acts[i]->result = rv;
+				add_client_result(batch->acts[i]);
+			}
+		}
+		return;
+	}
+
 	switch (act->op) {
 	case LD_OP_START:
 		rv = add_lockspace(act);
@@ -4597,7 +4907,8 @@ static void *client_thread_main(void *arg_in)
 	struct client *cl;
 	struct action *act;
 	struct action *act_un;
-	int rv;
+	struct lock_batch *batch;
+	int i, rv;
 
 	while (1) {
 		pthread_mutex_lock(&client_mutex);
@@ -4634,18 +4945,28 @@ static void *client_thread_main(void *arg_in)
 			 * So the lv will not be active and we should release
 			 * the lv lock it requested.
 			 */
-			if ((rv < 0) && (act->flags & LD_AF_LV_LOCK)) {
-				log_debug("auto unlock lv for failed client %u", act->client_id);
-				if ((act_un = alloc_action())) {
-					memcpy(act_un, act, sizeof(struct action));
-					act_un->mode = LD_LK_UN;
-					act_un->flags |= LD_AF_LV_UNLOCK;
-					act_un->flags &= ~LD_AF_LV_LOCK;
-					add_lock_action(act_un);
+			batch = act->batch;
+
+			for (i = 0; i < (batch ? batch->count : 1); i++) {
+				if (batch)
+					act = batch->acts[i];
+
+				if ((rv < 0) && (act->flags & LD_AF_LV_LOCK)) {
+					log_debug("auto unlock lv for failed client %u", act->client_id);
+					if ((act_un = alloc_action())) {
+						memcpy(act_un, act, sizeof(struct action));
+						act_un->mode = LD_LK_UN;
+						act_un->flags |= LD_AF_LV_UNLOCK;
+						act_un->flags &= ~LD_AF_LV_LOCK;
+						act_un->batch = NULL;
+						add_lock_action(act_un);
+					}
 				}
+
+				free_action(act);
 			}
 
-			free_action(act);
+			free(batch);
 			continue;
 		}
 
@@ -41,6 +41,7 @@ struct lm_dlm {
 struct rd_dlm {
 	struct dlm_lksb lksb;
 	struct val_blk *vb;
+	int async_done;		/* ast received for lm_lock_async_dlm */
 };
 
 int lm_data_size_dlm(void)
@@ -536,6 +537,184 @@ out:
 	return 0;
 }
 
+static void lock_async_ast_dlm(void *arg)
+{
+	struct rd_dlm *rdd = arg;
+
+	rdd->async_done = 1;
+}
+
+static int lock_async_pending_dlm(struct resource **rs, int count)
+{
+	struct rd_dlm *rdd;
+	int pending = 0, i;
+
+	for (i = 0; i < count; i++) {
+		rdd = (struct rd_dlm *)rs[i]->lm_data;
+		if (rs[i]->lm_async && !rdd->async_done)
+			pending++;
+	}
+
+	return pending;
+}
+
+static int lock_async_wait_dlm(struct lockspace *ls, int fd,
+			       struct resource **rs, int count)
+{
+	int retries = 0, rv;
+
+	while (lock_async_pending_dlm(rs, count)) {
+		rv = dlm_dispatch(fd);
+		if (rv < 0) {
+			if ((errno == EINTR || errno == EAGAIN) && (retries++ < 10))
+				continue;
+			log_error("S %s lock_async_dlm dispatch error %d errno %d",
+				  ls->name, rv, errno);
+			return rv;
+		}
+		retries = 0;
+	}
+
+	return 0;
+}
+
+static void lock_async_cancel_dlm(struct lockspace *ls, struct resource **rs, int count)
+{
+	struct lm_dlm *lmd = (struct lm_dlm *)ls->lm_data;
+	struct resource *r;
+	struct rd_dlm *rdd;
+	int i, rv;
+
+	for (i = 0; i < count; i++) {
+		r = rs[i];
+		rdd = (struct rd_dlm *)r->lm_data;
+
+		if (!r->lm_async || rdd->async_done)
+			continue;
+
+		/* Completes with -ECANCEL, or as usual if granted meanwhile. */
+		rv = dlm_ls_unlock(lmd->dh, rdd->lksb.sb_lkid, LKF_CANCEL,
+				   &rdd->lksb, rdd);
+		if (rv < 0)
+			log_debug("S %s R %s lock_async_dlm cancel error %d errno %d",
+				  ls->name, r->name, rv, errno);
+	}
+}
+
+/*
+ * Request locks for several lv resources without waiting for each
+ * one, then collect the results as the asts arrive.  The requested
+ * mode is r->lm_async_mode, the result is saved in r->lm_async_rv
+ * with r->lm_async set, for lm_lock to use in place of a synchronous
+ * lm_lock_dlm.  A resource without an existing NL lock requests the
+ * mode directly instead of first creating the NL lock, since lv locks
+ * have no lvb to read.
+ *
+ * Resources whose request could not be made are left without
+ * r->lm_async and go through lm_lock_dlm as usual.  If the asts
+ * cannot be read, the pending requests are canceled, and those
+ * actually canceled also go through lm_lock_dlm.
+ */
+
+int lm_lock_async_dlm(struct lockspace *ls, struct resource **rs, int count)
+{
+	struct lm_dlm *lmd = (struct lm_dlm *)ls->lm_data;
+	struct resource *r;
+	struct rd_dlm *rdd;
+	uint32_t flags;
+	int pending = 0;
+	int fd, mode, i, rv;
+
+	if (daemon_test)
+		return 0;
+
+	fd = dlm_ls_get_fd(lmd->dh);
+	if (fd < 0) {
+		log_error("S %s lock_async_dlm no fd %d", ls->name, fd);
+		return fd;
+	}
+
+	for (i = 0; i < count; i++) {
+		r = rs[i];
+		rdd = (struct rd_dlm *)r->lm_data;
+
+		if (rdd->vb || ((mode = to_dlm_mode(r->lm_async_mode)) < 0))
+			continue;
+
+		flags = LKF_NOQUEUE | LKF_PERSISTENT;
+		if (r->lm_init)
+			flags |= LKF_CONVERT;
+
+		rdd->async_done = 0;
+
+		rv = dlm_ls_lock(lmd->dh, mode, &rdd->lksb, flags,
+				 r->name, strlen(r->name),
+				 0, lock_async_ast_dlm, rdd, NULL, NULL);
+		if (rv < 0) {
+			log_debug("S %s R %s lock_async_dlm request error %d errno %d",
+				  ls->name, r->name, rv, errno);
+			continue;
+		}
+
+		r->lm_async = 1;
+		pending++;
+	}
+
+	log_debug("S %s lock_async_dlm %d of %d requests", ls->name, pending, count);
+
+	if (lock_async_wait_dlm(ls, fd, rs, count) < 0) {
+		lock_async_cancel_dlm(ls, rs, count);
+		if (lock_async_wait_dlm(ls, fd, rs, count) < 0)
+			log_error("S %s lock_async_dlm %d requests in unknown state",
+				  ls->name, lock_async_pending_dlm(rs, count));
+	}
+
+	for (i = 0; i < count; i++) {
+		r = rs[i];
+		rdd = (struct rd_dlm *)r->lm_data;
+
+		if (!r->lm_async)
+			continue;
+
+		if (!rdd->async_done) {
+			/* neither the ast nor the cancel could be read */
+			r->lm_async_rv = -ELMERR;
+			continue;
+		}
+
+		if (rdd->lksb.sb_status == -ECANCEL) {
+			log_debug("S %s R %s lock_async_dlm canceled, locking synchronously",
+				  ls->name, r->name);
+			r->lm_async = 0;
+			if (!r->lm_init)
+				rdd->lksb.sb_lkid = 0;
+			continue;
+		}
+
+		if (!rdd->lksb.sb_status) {
+			r->lm_init = 1;
+			r->lm_async_rv = 0;
+			continue;
+		}
+
+		if (rdd->lksb.sb_status == -EAGAIN) {
+			log_debug("S %s R %s lock_async_dlm mode %d rv EAGAIN",
+				  ls->name, r->name, r->lm_async_mode);
+			r->lm_async_rv = -EAGAIN;
+		} else {
+			log_error("S %s R %s lock_async_dlm acquire error %d",
+				  ls->name, r->name, rdd->lksb.sb_status);
+			r->lm_async_rv = -ELMERR;
+		}
+
+		/* A failed new request leaves no lock behind. */
+		if (!r->lm_init)
+			rdd->lksb.sb_lkid = 0;
+	}
+
+	return 0;
+}
+
 int lm_convert_dlm(struct lockspace *ls, struct resource *r,
 		   int ld_mode, uint32_t r_version)
 {
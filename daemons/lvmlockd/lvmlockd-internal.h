@@ -113,6 +113,8 @@ struct client {
  */
 #define DEFAULT_MAX_RETRIES 4
 
+struct lock_batch;
+
 struct action {
 	struct list_head list;
 	uint32_t client_id;
@@ -134,6 +136,18 @@ struct action {
 	char vg_args[MAX_ARGS+1];
 	char lv_args[MAX_ARGS+1];
 	char vg_sysid[MAX_NAME+1];
+	struct lock_batch *batch;	/* lock_lv request with lv_count > 1 */
+};
+
+/*
+ * A lock_lv request naming several LVs is split into one action
+ * per LV.  Completed actions are collected here, and one reply is
+ * sent to the client when the last of them is done.
+ */
+struct lock_batch {
+	int count;
+	int done;			/* protected by client_mutex */
+	struct action *acts[0];
 };
 
 struct resource {
@@ -148,6 +162,9 @@ struct resource {
 	unsigned int adopt : 1;		/* temp flag in remove_inactive_lvs */
 	unsigned int version_zero_valid : 1;
 	unsigned int use_vb : 1;
+	unsigned int lm_async : 1;	/* lm_async_rv is result of a pipelined lock */
+	int8_t lm_async_mode;		/* mode requested by the pipelined lock */
+	int lm_async_rv;
 	struct list_head locks;
 	struct list_head actions;
 	char lv_args[MAX_ARGS+1];
@@ -193,6 +210,7 @@ struct lockspace {
 
 	struct list_head actions;	/* new client actions */
 	struct list_head resources;	/* resource/lock state for gl/vg/lv */
+	struct dm_hash_table *lv_resources; /* lv resources indexed by lv uuid */
 };
 
 /* val_blk version */
@@ -383,6 +401,7 @@ int lm_convert_dlm(struct lockspace *ls, struct resource *r,
 int lm_unlock_dlm(struct lockspace *ls, struct resource *r,
 		  uint32_t r_version, uint32_t lmu_flags);
 int lm_rem_resource_dlm(struct lockspace *ls, struct resource *r);
+int lm_lock_async_dlm(struct lockspace *ls, struct resource **rs, int count);
 int lm_get_lockspaces_dlm(struct list_head *ls_rejoin);
 int lm_data_size_dlm(void);
 int lm_is_running_dlm(void);
@@ -438,6 +457,11 @@ static inline int lm_rem_resource_dlm(struct lockspace *ls, struct resource *r)
 	return -1;
 }
 
+static inline int lm_lock_async_dlm(struct lockspace *ls, struct resource **rs, int count)
+{
+	return 0;
+}
+
 static inline int lm_get_lockspaces_dlm(struct list_head *ls_rejoin)
 {
 	return -1;
@@ -13,6 +13,7 @@
  */
 
 #include "lvmpolld-common.h"
+#include "lvmpolld-dm-utils.h"
 
 #include "lvm-version.h"
 #include "daemon-server.h"
@@ -46,6 +47,14 @@ struct lvmpolld_state {
 
 	struct lvmpolld_store *id_to_pdlv_abort;
 	struct lvmpolld_store *id_to_pdlv_poll;
+
+	/* dm status monitoring thread */
+	pthread_t monitor_tid;
+	struct dm_pool *monitor_mem;
+	pthread_mutex_t monitor_lock;
+	pthread_cond_t monitor_cond;
+	unsigned monitor_running:1;
+	unsigned monitor_stop:1;
 };
 
 static pthread_key_t key;
@@ -78,6 +87,9 @@ static void _usage(const char *prog, FILE *file)
 		"   -t|--timeout     Time to wait in seconds before shutdown on idle (missing or 0 = inifinite)\n\n", prog, prog);
 }
 
+static int _start_monitor_thread(struct lvmpolld_state *ls);
+static void _stop_monitor_thread(struct lvmpolld_state *ls);
+
 static int _init(struct daemon_state *s)
 {
 	struct lvmpolld_state *ls = s->private;
@@ -115,6 +127,9 @@ static int _init(struct daemon_state *s)
 	if (ls->idle)
 		ls->idle->is_idle = 1;
 
+	if (!_start_monitor_thread(ls))
+		WARN(ls, "%s: %s", PD_LOG_PREFIX, "Failed to start dm status monitoring thread, lvpoll will be started at once");
+
 	return 1;
 }
 
@@ -154,6 +169,10 @@ static int _fini(struct daemon_state *s)
 
 	DEBUGLOG(s, "fini");
 
+	DEBUGLOG(s, "stopping dm status monitoring");
+
+	_stop_monitor_thread(ls);
+
 	DEBUGLOG(s, "sending cancel requests");
 
 	_lvmpolld_global_lock(ls);
@@ -609,6 +628,199 @@ static int spawn_detached_thread(struct lvmpolld_lv *pdlv)
 	return !r;
 }
 
+static int64_t _get_monotonic_secs(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return ts.tv_sec;
+}
+
+static void _pdlv_locked_fail(struct lvmpolld_lv *pdlv)
+{
+	pdlv_set_error(pdlv, 1);
+	pdlv_set_polling_finished(pdlv, 1);
+	pdst_locked_dec(pdlv->pdst);
+}
+
+/*
+ * Check the dm status of every LV being monitored in the store whose
+ * interval has passed.  When the kernel has finished (or the status
+ * cannot tell), hand the LV over to an lvpoll command which completes
+ * the operation in the metadata.  With stop set, give up on all LVs.
+ *
+ * The status ioctls run without the store lock so poll_init and
+ * progress_info requests are not blocked by the kernel.  A pdlv with
+ * dm_monitor set is never removed from the store (it is not finished)
+ * and only this thread clears dm_monitor, so the pointers collected
+ * under the lock stay valid.
+ *
+ * Returns the number of LVs that finished polling here.
+ */
+static unsigned _monitor_store(struct lvmpolld_state *ls, struct lvmpolld_store *pdst,
+			       struct dm_pool *mem, int stop)
+{
+	struct dm_hash_node *n;
+	struct lvmpolld_lv *pdlv, **due = NULL;
+	enum pdlv_dm_progress *progress = NULL;
+	int64_t now = _get_monotonic_secs();
+	unsigned i, count = 0, finished = 0;
+
+	pdst_lock(pdst);
+
+	dm_hash_iterate(n, pdst->store) {
+		pdlv = dm_hash_get_data(pdst->store, n);
+
+		if (!pdlv->dm_monitor)
+			continue;
+
+		if (stop) {
+			pdlv->dm_monitor = 0;
+			_pdlv_locked_fail(pdlv);
+			finished++;
+			continue;
+		}
+
+		if (now >= pdlv->dm_next_check)
+			count++;
+	}
+
+	if (stop || !count) {
+		pdst_unlock(pdst);
+		return finished;
+	}
+
+	if (!(due = malloc(count * sizeof(*due))) ||
+	    !(progress = malloc(count * sizeof(*progress)))) {
+		pdst_unlock(pdst);
+		ERROR(ls, "%s: %s", PD_LOG_PREFIX, "failed to allocate dm status list");
+		free(due);
+		return 0;
+	}
+
+	i = 0;
+	dm_hash_iterate(n, pdst->store) {
+		pdlv = dm_hash_get_data(pdst->store, n);
+
+		if (pdlv->dm_monitor && now >= pdlv->dm_next_check && i < count)
+			due[i++] = pdlv;
+	}
+	count = i;
+
+	pdst_unlock(pdst);
+
+	/* lvid and type are constant, no lock is needed to read them */
+	for (i = 0; i < count; i++)
+		progress[i] = pdlv_dm_progress(due[i], mem);
+
+	pdst_lock(pdst);
+
+	for (i = 0; i < count; i++) {
+		pdlv = due[i];
+
+		if (progress[i] == PDLV_DM_IN_PROGRESS) {
+			DEBUGLOG(ls, "%s: %s %s", PD_LOG_PREFIX, "dm status in progress for LV", pdlv->lvname);
+			pdlv->dm_next_check = now + pdlv->dm_interval;
+			continue;
+		}
+
+		INFO(ls, "%s: %s %s %s", PD_LOG_PREFIX, "dm status", progress[i] == PDLV_DM_FINISHED ?
+		     "finished" : "unknown", pdlv->lvname);
+
+		pdlv->dm_monitor = 0;
+
+		if (!spawn_detached_thread(pdlv)) {
+			ERROR(ls, "%s: %s", PD_LOG_PREFIX, "failed to spawn detached monitoring thread");
+			_pdlv_locked_fail(pdlv);
+			finished++;
+		}
+	}
+
+	pdst_unlock(pdst);
+
+	free(progress);
+	free(due);
+
+	return finished;
+}
+
+/*
+ * One thread reads the dm status of all polled LVs instead of
+ * running one lvpoll command per LV for the whole operation.
+ */
+static void *monitor_thread(void *args)
+{
+	struct lvmpolld_state *ls = args;
+	struct timespec ts;
+	int stop = 0;
+
+	while (!stop) {
+		pthread_mutex_lock(&ls->monitor_lock);
+		if (!ls->monitor_stop) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec++;
+			pthread_cond_timedwait(&ls->monitor_cond, &ls->monitor_lock, &ts);
+		}
+		stop = ls->monitor_stop;
+		pthread_mutex_unlock(&ls->monitor_lock);
+
+		if (_monitor_store(ls, ls->id_to_pdlv_poll, ls->monitor_mem, stop))
+			update_idle_state(ls);
+	}
+
+	return NULL;
+}
+
+static int _start_monitor_thread(struct lvmpolld_state *ls)
+{
+	if (!(ls->monitor_mem = dm_pool_create("lvmpolld_monitor", 1024)))
+		return 0;
+
+	if (pthread_mutex_init(&ls->monitor_lock, NULL))
+		goto bad_mutex;
+
+	if (pthread_cond_init(&ls->monitor_cond, NULL))
+		goto bad_cond;
+
+	if (pthread_create(&ls->monitor_tid, NULL, monitor_thread, ls))
+		goto bad_thread;
+
+	ls->monitor_running = 1;
+
+	return 1;
+
+bad_thread:
+	pthread_cond_destroy(&ls->monitor_cond);
+bad_cond:
+	pthread_mutex_destroy(&ls->monitor_lock);
+bad_mutex:
+	dm_pool_destroy(ls->monitor_mem);
+	ls->monitor_mem = NULL;
+
+	return 0;
+}
+
+static void _stop_monitor_thread(struct lvmpolld_state *ls)
+{
+	if (!ls->monitor_running)
+		return;
+
+	pthread_mutex_lock(&ls->monitor_lock);
+	ls->monitor_stop = 1;
+	pthread_cond_signal(&ls->monitor_cond);
+	pthread_mutex_unlock(&ls->monitor_lock);
+
+	pthread_join(ls->monitor_tid, NULL);
+
+	pthread_cond_destroy(&ls->monitor_cond);
+	pthread_mutex_destroy(&ls->monitor_lock);
+	dm_pool_destroy(ls->monitor_mem);
+
+	ls->monitor_running = 0;
+}
+
 static response poll_init(client_handle h, struct lvmpolld_state *ls, request req, enum poll_type type)
 {
 	char *id;
@@ -693,7 +905,11 @@ static response poll_init(client_handle h, struct lvmpolld_state *ls, request re
 			free(id);
 			return reply(LVMPD_RESP_FAILED, REASON_ENOMEM);
 		}
-		if (!spawn_detached_thread(pdlv)) {
+		if (ls->monitor_running && !abort_polling && pdlv_type_has_dm_progress(type)) {
+			/* monitor_thread starts lvpoll once the kernel is done */
+			pdlv->dm_monitor = 1;
+			pdlv->dm_interval = uinterval ?: 1;
+		} else if (!spawn_detached_thread(pdlv)) {
 			ERROR(ls, "%s: %s", PD_LOG_PREFIX, "failed to spawn detached monitoring thread");
 			pdst_locked_remove(pdst, id);
 			pdlv_destroy(pdlv);
@@ -61,6 +61,15 @@ struct lvmpolld_lv {
 	pid_t cmd_pid;
 	pthread_t tid;
 
+	/*
+	 * lvmpolld watches the dm status itself until the kernel
+	 * is done and only then starts lvpoll (no tid until then).
+	 * Protected by struct lvmpolld_store lock.
+	 */
+	unsigned dm_monitor;
+	unsigned dm_interval; /* in seconds */
+	time_t dm_next_check;
+
 	pthread_mutex_t lock;
 
 	/* block of shared variables protected by lock */
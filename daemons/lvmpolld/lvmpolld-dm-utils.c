@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lvmpolld-common.h"
+
+#include "lvmpolld-dm-utils.h"
+#include "lib/misc/lvm-string.h"
+
+/*
+ * pvmove, mirror conversion and snapshot merge progress is visible
+ * in the status of the LV's top level dm device.  Thin snapshot
+ * merge happens on activation and has nothing to watch.
+ */
+int pdlv_type_has_dm_progress(enum poll_type type)
+{
+	return (type == PVMOVE) || (type == CONVERT) || (type == MERGE);
+}
+
+static enum pdlv_dm_progress _mirror_progress(struct dm_pool *mem, const char *params)
+{
+	struct dm_status_mirror *ms;
+	uint32_t i;
+
+	if (!dm_get_status_mirror(mem, params, &ms))
+		return PDLV_DM_UNKNOWN;
+
+	/* Failed legs or logs need lvpoll to repair the mirror. */
+	for (i = 0; i < ms->dev_count; i++)
+		if (ms->devs[i].health != DM_STATUS_MIRROR_ALIVE)
+			return PDLV_DM_UNKNOWN;
+
+	for (i = 0; i < ms->log_count; i++)
+		if (ms->logs[i].health != DM_STATUS_MIRROR_ALIVE)
+			return PDLV_DM_UNKNOWN;
+
+	return (ms->insync_regions < ms->total_regions) ? PDLV_DM_IN_PROGRESS : PDLV_DM_FINISHED;
+}
+
+static enum pdlv_dm_progress _merge_progress(const char *params)
+{
+	struct dm_status_snapshot ss;
+
+	if (!dm_get_status_snapshot_into(params, &ss))
+		return PDLV_DM_UNKNOWN;
+
+	if (ss.invalid || ss.merge_failed || ss.overflow || !ss.has_metadata_sectors)
+		return PDLV_DM_UNKNOWN;
+
+	return (ss.used_sectors != ss.metadata_sectors) ? PDLV_DM_IN_PROGRESS : PDLV_DM_FINISHED;
+}
+
+/*
+ * Read the kernel status of the LV being polled.  Only the lvid
+ * is needed, so this works without reading any VG metadata.
+ *
+ * A pvmove LV has one mirror target for the segment being moved,
+ * a converting LV has a mirror target, and a merging origin has a
+ * snapshot-merge target.  Anything else is left to lvpoll.
+ *
+ * A suspended device (e.g. another command is reloading it) cannot
+ * report a reliable status, so it is treated as still in progress
+ * and read again at the next interval.
+ */
+enum pdlv_dm_progress pdlv_dm_progress(const struct lvmpolld_lv *pdlv, struct dm_pool *mem)
+{
+	char uuid[128];
+	struct dm_task *dmt;
+	struct dm_info info;
+	uint64_t start, length;
+	char *target_type = NULL;
+	char *params;
+	void *next = NULL;
+	enum pdlv_dm_progress r = PDLV_DM_UNKNOWN, t;
+	const char *wanted = (pdlv->type == MERGE) ? "snapshot-merge" : "mirror";
+
+	if (!pdlv_type_has_dm_progress(pdlv->type))
+		return PDLV_DM_UNKNOWN;
+
+	if (dm_snprintf(uuid, sizeof(uuid), UUID_PREFIX "%s", pdlv->lvid) < 0)
+		return PDLV_DM_UNKNOWN;
+
+	if (!(dmt = dm_task_create(DM_DEVICE_STATUS)))
+		return PDLV_DM_UNKNOWN;
+
+	if (!dm_task_set_uuid(dmt, uuid) ||
+	    !dm_task_no_open_count(dmt) ||
+	    !dm_task_run(dmt) ||
+	    !dm_task_get_info(dmt, &info) ||
+	    !info.exists)
+		goto out;
+
+	if (info.suspended) {
+		r = PDLV_DM_IN_PROGRESS;
+		goto out;
+	}
+
+	do {
+		next = dm_get_next_target(dmt, next, &start, &length, &target_type, &params);
+
+		if (!target_type || strcmp(target_type, wanted))
+			continue;
+
+		t = (pdlv->type == MERGE) ? _merge_progress(params) : _mirror_progress(mem, params);
+
+		if (t != PDLV_DM_FINISHED) {
+			r = t;
+			break;
+		}
+
+		r = PDLV_DM_FINISHED;
+	} while (next);
+out:
+	dm_task_destroy(dmt);
+	dm_pool_empty(mem);
+
+	return r;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_LVMPOLLD_DM_UTILS_H
+#define _LVM_LVMPOLLD_DM_UTILS_H
+
+#include "lvmpolld-data-utils.h"
+
+struct dm_pool;
+
+enum pdlv_dm_progress {
+	PDLV_DM_UNKNOWN = 0,	/* status does not tell, lvpoll has to decide */
+	PDLV_DM_IN_PROGRESS,	/* kernel is still copying or merging */
+	PDLV_DM_FINISHED	/* kernel is done, lvpoll can complete the operation */
+};
+
+int pdlv_type_has_dm_progress(enum poll_type type);
+enum pdlv_dm_progress pdlv_dm_progress(const struct lvmpolld_lv *pdlv, struct dm_pool *mem);
+
+#endif /* _LVM_LVMPOLLD_DM_UTILS_H */
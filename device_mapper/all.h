@@ -398,6 +398,15 @@ struct dm_status_snapshot {
 int dm_get_status_snapshot(struct dm_pool *mem, const char *params,
 			   struct dm_status_snapshot **status);
 
+/*
+ * The _into forms parse into a structure supplied by the caller, without
+ * allocating, for callers polling status repeatedly.  Raid, cache and
+ * mirror status refer to strings and arrays of variable length, so they
+ * are only returned allocated from a pool.
+ */
+int dm_get_status_snapshot_into(const char *params,
+				struct dm_status_snapshot *status);
+
 /* Parse params from STATUS call for thin_pool target */
 typedef enum {
 	DM_THIN_DISCARDS_IGNORE,
@@ -424,6 +433,8 @@ struct dm_status_thin_pool {
 
 int dm_get_status_thin_pool(struct dm_pool *mem, const char *params,
 			    struct dm_status_thin_pool **status);
+int dm_get_status_thin_pool_into(const char *params,
+				 struct dm_status_thin_pool *status);
 
 /* Parse params from STATUS call for thin target */
 struct dm_status_thin {
@@ -435,6 +446,7 @@ struct dm_status_thin {
 
 int dm_get_status_thin(struct dm_pool *mem, const char *params,
 		       struct dm_status_thin **status);
+int dm_get_status_thin_into(const char *params, struct dm_status_thin *status);
 
 /*
  * Call this to actually run the ioctl.
@@ -1032,6 +1044,7 @@ int dm_tree_node_set_thin_external_origin(struct dm_tree_node *node,
 					  const char *external_uuid);
 
 void dm_tree_node_set_udev_flags(struct dm_tree_node *node, uint16_t udev_flags);
+uint16_t dm_tree_node_get_udev_flags(const struct dm_tree_node *node);
 
 void dm_tree_node_set_presuspend_node(struct dm_tree_node *node,
 				      struct dm_tree_node *presuspend_node);
@@ -1124,6 +1137,18 @@ void *dm_pool_alloc_aligned(struct dm_pool *p, size_t s, unsigned alignment)
 void dm_pool_empty(struct dm_pool *p);
 void dm_pool_free(struct dm_pool *p, void *ptr);
 
+/*
+ * Take new chunks for all pools from a caller provided allocator.
+ * When chunk_alloc is NULL or returns NULL, malloc is used.
+ * chunk_free is called for every chunk released and returns 1
+ * when the chunk came from chunk_alloc, otherwise it is freed.
+ * The allocator is process wide and not protected by any lock.
+ */
+typedef void *(*dm_pool_chunk_alloc_fn) (size_t s);
+typedef int (*dm_pool_chunk_free_fn) (void *ptr);
+void dm_pool_set_chunk_allocator(dm_pool_chunk_alloc_fn chunk_alloc,
+				 dm_pool_chunk_free_fn chunk_free);
+
 /*
  * To aid debugging, a pool can be locked. Any modifications made
  * to the content of the pool while it is locked can be detected.
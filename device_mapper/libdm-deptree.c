@@ -638,6 +638,11 @@ void dm_tree_node_set_udev_flags(struct dm_tree_node *dnode, uint16_t udev_flags
 	dnode->udev_flags = udev_flags;
 }
 
+uint16_t dm_tree_node_get_udev_flags(const struct dm_tree_node *dnode)
+{
+	return dnode->udev_flags;
+}
+
 void dm_tree_node_set_read_ahead(struct dm_tree_node *dnode,
 				 uint32_t read_ahead,
 				 uint32_t read_ahead_flags)
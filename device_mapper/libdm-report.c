@@ -4613,7 +4613,10 @@ static int _output_as_columns(struct dm_report *rh)
 		_report_headings(rh);
 
 	/* Print and clear buffer */
+	/* No JSON separator after the last row that is displayed */
 	last_row = dm_list_last(&rh->rows);
+	while (last_row && !_should_display_row(dm_list_item(last_row, struct row)))
+		last_row = dm_list_prev(&rh->rows, last_row);
 	dm_list_iterate_safe(rowh, rtmp, &rh->rows) {
 		row = dm_list_item(rowh, struct row);
 
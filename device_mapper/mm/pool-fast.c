@@ -46,6 +46,16 @@ static void _free_chunk(struct chunk *c);
 /* by default things come out aligned for doubles */
 #define DEFAULT_ALIGNMENT __alignof__ (double)
 
+static dm_pool_chunk_alloc_fn _chunk_alloc = NULL;
+static dm_pool_chunk_free_fn _chunk_free = NULL;
+
+void dm_pool_set_chunk_allocator(dm_pool_chunk_alloc_fn chunk_alloc,
+				 dm_pool_chunk_free_fn chunk_free)
+{
+	_chunk_alloc = chunk_alloc;
+	_chunk_free = chunk_free;
+}
+
 struct dm_pool *dm_pool_create(const char *name, size_t chunk_hint)
 {
 	size_t new_size = 1024;
@@ -282,7 +292,8 @@ static struct chunk *_new_chunk(struct dm_pool *p, size_t s)
 #  define aligned_malloc(s)	(posix_memalign((void**)&c, _pagesize, \
 						ALIGN_ON_PAGE(s)) == 0)
 #else
-#  define aligned_malloc(s)	(c = malloc(s))
+#  define aligned_malloc(s)	((_chunk_alloc && (c = _chunk_alloc(s))) || \
+				 (c = malloc(s)))
 #endif /* DEBUG_ENFORCE_POOL_LOCKING */
 		if (!aligned_malloc(s)) {
 #undef aligned_malloc
@@ -316,7 +327,8 @@ static void _free_chunk(struct chunk *c)
 	/* since DEBUG_MEM is using own memory list */
 	free(c); /* for posix_memalign() */
 #else
-	free(c);
+	if (!c || !_chunk_free || !_chunk_free(c))
+		free(c);
 #endif
 }
 
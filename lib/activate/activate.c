@@ -285,6 +285,18 @@ int lv_raid_message(const struct logical_volume *lv, const char *msg)
 {
 	return 0;
 }
+int lv_extent_heat_start(const struct logical_volume *lv)
+{
+	return 0;
+}
+int lv_extent_heat_stop(const struct logical_volume *lv)
+{
+	return 0;
+}
+int lv_extent_heat(const struct logical_volume *lv, uint64_t *ios)
+{
+	return 0;
+}
 int lv_thin_pool_percent(const struct logical_volume *lv, int metadata,
 			 dm_percent_t *percent)
 {
@@ -300,6 +312,15 @@ int lv_thin_pool_transaction_id(const struct logical_volume *lv,
 {
 	return 0;
 }
+int lv_thin_pool_status(const struct logical_volume *lv, int flush,
+			struct dm_status_thin_pool *status)
+{
+	return 0;
+}
+int lv_thin_pool_metadata_snap(const struct logical_volume *lv, int reserve)
+{
+	return 0;
+}
 int lv_thin_device_id(const struct logical_volume *lv, uint32_t *device_id)
 {
 	return 0;
@@ -387,6 +408,9 @@ int monitor_dev_for_events(struct cmd_context *cmd, const struct logical_volume
 void fs_unlock(void)
 {
 }
+void fs_unlock_deferred(void)
+{
+}
 /* dev_manager.c */
 #include "lib/activate/targets.h"
 int add_areas_line(struct dev_manager *dm, struct lv_segment *seg,
@@ -1101,6 +1125,73 @@ int lv_raid_sync_action(const struct logical_volume *lv, char **sync_action)
 	return 1;
 }
 
+int lv_extent_heat_start(const struct logical_volume *lv)
+{
+	int r;
+	struct dev_manager *dm;
+
+	if (!lv_info(lv->vg->cmd, lv, 0, NULL, 0, 0))
+		return 0;
+
+	log_debug_activation("Starting extent heat tracking for LV %s.",
+			     display_lvname(lv));
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	if (!(r = dev_manager_extent_heat_start(dm, lv)))
+		stack;
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
+int lv_extent_heat_stop(const struct logical_volume *lv)
+{
+	int r;
+	struct dev_manager *dm;
+
+	if (!lv_info(lv->vg->cmd, lv, 0, NULL, 0, 0))
+		return 1;
+
+	log_debug_activation("Stopping extent heat tracking for LV %s.",
+			     display_lvname(lv));
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	if (!(r = dev_manager_extent_heat_stop(dm, lv)))
+		stack;
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
+int lv_extent_heat(const struct logical_volume *lv, uint64_t *ios)
+{
+	int r;
+	struct dev_manager *dm;
+
+	memset(ios, 0, sizeof(*ios) * lv->le_count);
+
+	if (!lv_info(lv->vg->cmd, lv, 0, NULL, 0, 0))
+		return 0;
+
+	log_debug_activation("Checking extent heat for LV %s.",
+			     display_lvname(lv));
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	r = dev_manager_extent_heat(dm, lv, ios);
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
 int lv_raid_message(const struct logical_volume *lv, const char *msg)
 {
 	int r = 0;
@@ -1306,6 +1397,59 @@ int lv_thin_pool_transaction_id(const struct logical_volume *lv,
 	return r;
 }
 
+int lv_thin_pool_status(const struct logical_volume *lv, int flush,
+			struct dm_status_thin_pool *status)
+{
+	int r;
+	struct dev_manager *dm;
+	struct dm_status_thin_pool *s;
+
+	if (!lv_info(lv->vg->cmd, lv, 1, NULL, 0, 0))
+		return 0;
+
+	log_debug_activation("Checking thin-pool status for LV %s.",
+			     display_lvname(lv));
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	if (!(r = dev_manager_thin_pool_status(dm, lv, &s, flush)))
+		stack;
+	else
+		*status = *s;
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
+/*
+ * Reserve or release the pool metadata snapshot, a read-only copy of
+ * the pool metadata userspace can walk while the pool stays in use.
+ */
+int lv_thin_pool_metadata_snap(const struct logical_volume *lv, int reserve)
+{
+	int r;
+	struct dev_manager *dm;
+
+	if (!lv_info(lv->vg->cmd, lv, 1, NULL, 0, 0))
+		return 0;
+
+	log_debug_activation("%s metadata snapshot of thin-pool %s.",
+			     reserve ? "Reserving" : "Releasing", display_lvname(lv));
+
+	if (!(dm = dev_manager_create(lv->vg->cmd, lv->vg->name, 1)))
+		return_0;
+
+	if (!(r = dev_manager_thin_pool_message(dm, lv, reserve ? "reserve_metadata_snap" :
+						"release_metadata_snap")))
+		stack;
+
+	dev_manager_destroy(dm);
+
+	return r;
+}
+
 int lv_thin_device_id(const struct logical_volume *lv, uint32_t *device_id)
 {
 	int r;
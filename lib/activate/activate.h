@@ -186,12 +186,28 @@ int lv_raid_sync_action(const struct logical_volume *lv, char **sync_action);
 int lv_raid_message(const struct logical_volume *lv, const char *msg);
 int lv_cache_status(const struct logical_volume *cache_lv,
 		    struct lv_status_cache **status);
+
+/*
+ * Extent heat: a dm-statistics region on an active LV, started and
+ * stopped with lvchange --extentheat and identified by its program_id.
+ * Each area covers one or more whole extents, so the number of areas
+ * stays within activation/extent_heat_max_areas.  lv_extent_heat()
+ * fills ios with the I/O count of each LE since the region was created,
+ * LEs of the same area sharing its count.
+ */
+#define LV_EXTENT_HEAT_PROGRAM_ID "lvm2_heat"
+int lv_extent_heat_start(const struct logical_volume *lv);
+int lv_extent_heat_stop(const struct logical_volume *lv);
+int lv_extent_heat(const struct logical_volume *lv, uint64_t *ios);
 int lv_thin_pool_percent(const struct logical_volume *lv, int metadata,
 			 dm_percent_t *percent);
 int lv_thin_percent(const struct logical_volume *lv, int mapped,
 		    dm_percent_t *percent);
 int lv_thin_pool_transaction_id(const struct logical_volume *lv,
 				uint64_t *transaction_id);
+int lv_thin_pool_status(const struct logical_volume *lv, int flush,
+			struct dm_status_thin_pool *status);
+int lv_thin_pool_metadata_snap(const struct logical_volume *lv, int reserve);
 int lv_thin_device_id(const struct logical_volume *lv, uint32_t *device_id);
 int lv_vdo_pool_status(const struct logical_volume *lv, int flush,
 		       struct lv_status_vdo **status);
@@ -253,6 +269,7 @@ int device_is_usable(struct device *dev, struct dev_usable_check_params check);
  * Declaration moved here from fs.h to keep header fs.h hidden
  */
 void fs_unlock(void);
+void fs_unlock_deferred(void);
 
 #define TARGET_NAME_CACHE "cache"
 #define TARGET_NAME_ERROR "error"
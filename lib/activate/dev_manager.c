@@ -489,8 +489,7 @@ out:
 static int _ignore_unusable_thins(struct device *dev)
 {
 	/* TODO make function for thin testing */
-	struct dm_pool *mem;
-	struct dm_status_thin_pool *status;
+	struct dm_status_thin_pool status;
 	struct dm_task *dmt = NULL;
 	void *next = NULL;
 	uint64_t start, length;
@@ -499,9 +498,6 @@ static int _ignore_unusable_thins(struct device *dev)
 	int minor, major;
 	int r = 0;
 
-	if (!(mem = dm_pool_create("unusable_thins", 128)))
-		return_0;
-
 	if (!(dmt = _setup_task_run(DM_DEVICE_TABLE, NULL, NULL, NULL, NULL,
 				    MAJOR(dev->dev), MINOR(dev->dev), 0, 1, 0)))
 		goto_out;
@@ -519,10 +515,10 @@ static int _ignore_unusable_thins(struct device *dev)
 		goto_out;
 
 	dm_get_next_target(dmt, next, &start, &length, &target_type, &params);
-	if (!dm_get_status_thin_pool(mem, params, &status))
+	if (!dm_get_status_thin_pool_into(params, &status))
 		goto_out;
 
-	if (status->read_only || status->out_of_data_space) {
+	if (status.read_only || status.out_of_data_space) {
 		log_warn("WARNING: %s: Thin's thin-pool needs inspection.",
 			 dev_name(dev));
 		goto out;
@@ -533,28 +529,17 @@ out:
 	if (dmt)
 		dm_task_destroy(dmt);
 
-	dm_pool_destroy(mem);
-
         return r;
 }
 
 static int _ignore_invalid_snapshot(const char *params)
 {
-	struct dm_status_snapshot *s;
-	struct dm_pool *mem;
-	int r = 0;
+	struct dm_status_snapshot s;
 
-	if (!(mem = dm_pool_create("invalid snapshots", 128)))
+	if (!dm_get_status_snapshot_into(params, &s))
 		return_0;
 
-	if (!dm_get_status_snapshot(mem, params, &s))
-		stack;
-        else
-		r = s->invalid;
-
-	dm_pool_destroy(mem);
-
-	return r;
+	return s.invalid;
 }
 
 static int _ignore_frozen_raid(struct device *dev, const char *params)
@@ -1450,6 +1435,151 @@ out:
 	return r;
 }
 
+/*
+ * Send a dm-statistics message to the top-level device of the LV and
+ * return a copy of the kernel's response.
+ */
+static int _stats_message(struct dev_manager *dm, const struct logical_volume *lv,
+			  const char *msg, char **response)
+{
+	int r = 0;
+	const char *dlid, *resp;
+	struct dm_task *dmt;
+
+	if (!(dlid = build_dm_uuid(dm->mem, lv, NULL)))
+		return_0;
+
+	if (!(dmt = _setup_task_run(DM_DEVICE_TARGET_MSG, NULL, NULL, dlid, 0, 0, 0, 0, 1, 0)))
+		return_0;
+
+	if (!dm_task_set_message(dmt, msg))
+		goto_out;
+
+	if (!dm_task_run(dmt))
+		goto_out;
+
+	resp = dm_task_get_message_response(dmt);
+	if (!(*response = dm_pool_strdup(dm->mem, resp ? : "")))
+		goto_out;
+
+	r = 1;
+out:
+	dm_task_destroy(dmt);
+
+	return r;
+}
+
+/*
+ * Get the extent heat region from an @stats_list response filtered
+ * by its program_id. Returns 0 if there is none.
+ */
+static int _extent_heat_region(const char *list, uint64_t *region_id)
+{
+	return (sscanf(list, FMTu64 ":", region_id) == 1);
+}
+
+int dev_manager_extent_heat_start(struct dev_manager *dm,
+				  const struct logical_volume *lv)
+{
+	char msg[64];
+	char *response;
+	uint64_t region_id;
+	uint32_t max_areas, extents;
+
+	if (!_stats_message(dm, lv, "@stats_list " LV_EXTENT_HEAT_PROGRAM_ID, &response))
+		return_0;
+
+	if (_extent_heat_region(response, &region_id)) {
+		log_debug_activation("Extent heat region " FMTu64 " already exists on %s.",
+				     region_id, display_lvname(lv));
+		return 1;
+	}
+
+	/* Areas of whole extents over the whole device, at most max_areas. */
+	if (!(max_areas = find_config_tree_int(dm->cmd, activation_extent_heat_max_areas_CFG, NULL)))
+		max_areas = 1;
+	extents = ((lv->le_count + max_areas - 1) / max_areas) ? : 1;
+
+	if (dm_snprintf(msg, sizeof(msg), "@stats_create - " FMTu64 " " LV_EXTENT_HEAT_PROGRAM_ID " -",
+			(uint64_t) extents * lv->vg->extent_size) < 0)
+		return_0;
+
+	if (!_stats_message(dm, lv, msg, &response))
+		return_0;
+
+	log_debug_activation("Created extent heat region %s with %u extents per area on %s.",
+			     response, extents, display_lvname(lv));
+
+	return 1;
+}
+
+int dev_manager_extent_heat_stop(struct dev_manager *dm,
+				 const struct logical_volume *lv)
+{
+	char msg[64];
+	char *response;
+	uint64_t region_id;
+
+	if (!_stats_message(dm, lv, "@stats_list " LV_EXTENT_HEAT_PROGRAM_ID, &response))
+		return_0;
+
+	if (!_extent_heat_region(response, &region_id))
+		return 1;
+
+	if (dm_snprintf(msg, sizeof(msg), "@stats_delete " FMTu64, region_id) < 0)
+		return_0;
+
+	if (!_stats_message(dm, lv, msg, &response))
+		return_0;
+
+	log_debug_activation("Deleted extent heat region " FMTu64 " on %s.",
+			     region_id, display_lvname(lv));
+
+	return 1;
+}
+
+int dev_manager_extent_heat(struct dev_manager *dm,
+			    const struct logical_volume *lv, uint64_t *ios)
+{
+	char msg[64];
+	char *response, *line, *next;
+	uint64_t region_id, start, len, reads, writes, le, end;
+
+	if (!_stats_message(dm, lv, "@stats_list " LV_EXTENT_HEAT_PROGRAM_ID, &response))
+		return_0;
+
+	if (!_extent_heat_region(response, &region_id)) {
+		log_debug_activation("No extent heat region on %s.", display_lvname(lv));
+		return 0;
+	}
+
+	if (dm_snprintf(msg, sizeof(msg), "@stats_print " FMTu64, region_id) < 0)
+		return_0;
+
+	if (!_stats_message(dm, lv, msg, &response))
+		return_0;
+
+	/* <start>+<len> <reads> <merged> <sectors> <ms> <writes> ... */
+	for (line = response; line && *line; line = next) {
+		if ((next = strchr(line, '\n')))
+			*next++ = '\0';
+
+		if (sscanf(line, FMTu64 "+" FMTu64 " " FMTu64 " %*u %*u %*u " FMTu64,
+			   &start, &len, &reads, &writes) != 4) {
+			log_error("Failed to parse extent heat of %s: %s.",
+				  display_lvname(lv), line);
+			return 0;
+		}
+
+		/* An area may cover several extents */
+		end = (start + len) / lv->vg->extent_size;
+		for (le = start / lv->vg->extent_size; (le < end) && (le < lv->le_count); le++)
+			ios[le] = reads + writes;
+	}
+
+	return 1;
+}
+
 int dev_manager_cache_status(struct dev_manager *dm,
 			     const struct logical_volume *lv,
 			     struct lv_status_cache **status)
@@ -1550,6 +1680,41 @@ out:
 	return r;
 }
 
+int dev_manager_thin_pool_message(struct dev_manager *dm,
+				  const struct logical_volume *lv,
+				  const char *msg)
+{
+	int r = 0;
+	const char *dlid;
+	struct dm_task *dmt;
+
+	/* Only the metadata snapshot messages are sent outside of the deptree */
+	if (strcmp(msg, "reserve_metadata_snap") &&
+	    strcmp(msg, "release_metadata_snap")) {
+		log_error(INTERNAL_ERROR "Unsupported thin pool message: %s.", msg);
+		return 0;
+	}
+
+	/* Build dlid for the thin pool layer */
+	if (!(dlid = build_dm_uuid(dm->mem, lv, lv_layer(lv))))
+		return_0;
+
+	if (!(dmt = _setup_task_run(DM_DEVICE_TARGET_MSG, NULL, NULL, dlid, 0, 0, 0, 0, 1, 0)))
+		return_0;
+
+	if (!dm_task_set_message(dmt, msg))
+		goto_out;
+
+	if (!dm_task_run(dmt))
+		goto_out;
+
+	r = 1;
+out:
+	dm_task_destroy(dmt);
+
+	return r;
+}
+
 int dev_manager_thin_pool_percent(struct dev_manager *dm,
 				  const struct logical_volume *lv,
 				  int metadata, dm_percent_t *percent)
@@ -3147,6 +3312,55 @@ static int _add_new_lv_to_dtree(struct dev_manager *dm, struct dm_tree *dtree,
 	return 1;
 }
 
+/*
+ * Fast activation creates the /dev/mapper nodes itself, while udev rules
+ * only ever create symlinks there.  Such devices are unknown to udev, so
+ * their nodes and symlinks are removed and renamed by LVM as well, also
+ * by commands that otherwise rely on udev rules.
+ */
+static int _dm_node_made_by_lvm(const char *name)
+{
+	char path[PATH_MAX];
+	struct stat info;
+
+	if (!name || !*name ||
+	    (dm_snprintf(path, sizeof(path), "%s/%s", dm_dir(), name) < 0))
+		return 0;
+
+	return !lstat(path, &info) && S_ISBLK(info.st_mode);
+}
+
+static void _set_lvm_node_udev_flags(struct dm_tree_node *parent)
+{
+	void *handle = NULL;
+	struct dm_tree_node *child;
+	uint16_t udev_flags;
+
+	while ((child = dm_tree_next_child(&handle, parent, 0))) {
+		udev_flags = dm_tree_node_get_udev_flags(child);
+		if (!(udev_flags & DM_UDEV_DISABLE_DM_RULES_FLAG) &&
+		    _dm_node_made_by_lvm(dm_tree_node_get_name(child)))
+			dm_tree_node_set_udev_flags(child, (udev_flags & ~DM_UDEV_DISABLE_LIBRARY_FALLBACK) |
+						    DM_UDEV_DISABLE_DM_RULES_FLAG |
+						    DM_UDEV_DISABLE_SUBSYSTEM_RULES_FLAG);
+		_set_lvm_node_udev_flags(child);
+	}
+}
+
+static void _check_lvm_made_nodes(struct dev_manager *dm, struct dm_tree_node *root)
+{
+	/* With udev fallback, nodes are managed directly anyway */
+	if (!dm->cmd->current_settings.udev_rules || _check_udev_fallback(dm->cmd))
+		return;
+
+	_set_lvm_node_udev_flags(root);
+}
+
+static int _lvm_made_nodes(const struct dm_tree_node *node)
+{
+	return (dm_tree_node_get_udev_flags(node) & DM_UDEV_DISABLE_DM_RULES_FLAG) ? 1 : 0;
+}
+
 /* FIXME: symlinks should be created/destroyed at the same time
  * as the kernel devices but we can't do that from within libdevmapper
  * at present so we must walk the tree twice instead. */
@@ -3163,28 +3377,38 @@ static int _create_lv_symlinks(struct dev_manager *dm, struct dm_tree_node *root
 	char *new_vgname, *new_lvname, *new_layer;
 	const char *name;
 	int r = 1;
+	int fallback = _check_udev_fallback(dm->cmd);
+	int udev_rules = dm->cmd->current_settings.udev_rules;
 
-	/* Nothing to do if udev fallback is disabled. */
-	if (!_check_udev_fallback(dm->cmd)) {
+	/*
+	 * Nothing to do if udev fallback is disabled,
+	 * except for devices whose nodes LVM made itself.
+	 */
+	if (!fallback) {
 		fs_set_create();
-		return 1;
+		dm->cmd->current_settings.udev_rules = 0;
 	}
 
 	while ((child = dm_tree_next_child(&handle, root, 0))) {
 		if (!(lvlayer = dm_tree_node_get_context(child)))
 			continue;
 
+		if (!fallback && !_lvm_made_nodes(child))
+			continue;
+
 		/* Detect rename */
 		name = dm_tree_node_get_name(child);
 
 		if (name && lvlayer->old_name && *lvlayer->old_name && strcmp(name, lvlayer->old_name)) {
 			if (!dm_split_lvm_name(dm->mem, lvlayer->old_name, &old_vgname, &old_lvname, &old_layer)) {
 				log_error("_create_lv_symlinks: Couldn't split up old device name %s.", lvlayer->old_name);
-				return 0;
+				r = 0;
+				break;
 			}
 			if (!dm_split_lvm_name(dm->mem, name, &new_vgname, &new_lvname, &new_layer)) {
 				log_error("_create_lv_symlinks: Couldn't split up new device name %s.", name);
-				return 0;
+				r = 0;
+				break;
 			}
 			if (!fs_rename_lv(lvlayer->lv, name, old_vgname, old_lvname))
 				r = 0;
@@ -3199,6 +3423,8 @@ static int _create_lv_symlinks(struct dev_manager *dm, struct dm_tree_node *root
 			r = 0;
 	}
 
+	dm->cmd->current_settings.udev_rules = udev_rules;
+
 	return r;
 }
 
@@ -3211,12 +3437,13 @@ static int _remove_lv_symlinks(struct dev_manager *dm, struct dm_tree_node *root
 	struct dm_tree_node *child;
 	char *vgname, *lvname, *layer;
 	int r = 1;
-
-	/* Nothing to do if udev fallback is disabled. */
-	if (!_check_udev_fallback(dm->cmd))
-		return 1;
+	int fallback = _check_udev_fallback(dm->cmd);
 
 	while ((child = dm_tree_next_child(&handle, root, 0))) {
+		/* Udev removes the symlinks it made */
+		if (!fallback && !_lvm_made_nodes(child))
+			continue;
+
 		if (!dm_split_lvm_name(dm->mem, dm_tree_node_get_name(child), &vgname, &lvname, &layer)) {
 			r = 0;
 			continue;
@@ -3230,7 +3457,7 @@ static int _remove_lv_symlinks(struct dev_manager *dm, struct dm_tree_node *root
 			continue;
 
 		fs_del_lv_byname(dm->cmd->dev_dir, vgname, lvname,
-				 dm->cmd->current_settings.udev_rules);
+				 fallback ? dm->cmd->current_settings.udev_rules : 0);
 	}
 
 	return r;
@@ -3319,6 +3546,8 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 	/* Restore fs cookie */
 	dm_tree_set_cookie(root, fs_get_cookie());
 
+	_check_lvm_made_nodes(dm, root);
+
 	if (!(dlid = build_dm_uuid(dm->mem, lv, laopts->origin_only ? lv_layer(lv) : NULL)))
 		goto_out;
 
@@ -3358,6 +3587,9 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 					  (lv_is_thin_pool(lv) && laopts->origin_only) ? "tpool" : NULL))
 			goto_out;
 
+		/* New udev flags were set for devices already present */
+		_check_lvm_made_nodes(dm, root);
+
 		/* Preload any devices required before any suspensions */
 		if (!dm_tree_preload_children(root, dlid, DLID_SIZE))
 			goto_out;
@@ -63,6 +63,12 @@ int dev_manager_raid_status(struct dev_manager *dm,
 int dev_manager_raid_message(struct dev_manager *dm,
 			     const struct logical_volume *lv,
 			     const char *msg);
+int dev_manager_extent_heat_start(struct dev_manager *dm,
+				  const struct logical_volume *lv);
+int dev_manager_extent_heat_stop(struct dev_manager *dm,
+				 const struct logical_volume *lv);
+int dev_manager_extent_heat(struct dev_manager *dm,
+			    const struct logical_volume *lv, uint64_t *ios);
 int dev_manager_cache_status(struct dev_manager *dm,
 			     const struct logical_volume *lv,
 			     struct lv_status_cache **status);
@@ -70,6 +76,9 @@ int dev_manager_thin_pool_status(struct dev_manager *dm,
 				 const struct logical_volume *lv,
 				 struct dm_status_thin_pool **status,
 				 int flush);
+int dev_manager_thin_pool_message(struct dev_manager *dm,
+				  const struct logical_volume *lv,
+				  const char *msg);
 int dev_manager_thin_pool_percent(struct dev_manager *dm,
 				  const struct logical_volume *lv,
 				  int metadata, dm_percent_t *percent);
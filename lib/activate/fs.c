@@ -34,6 +34,14 @@
 static uint32_t _fs_cookie = DM_COOKIE_AUTO_CREATE;
 static int _fs_create = 0;
 
+/*
+ * Cookies of earlier transactions udev may still be processing.
+ * They are waited for together with the current one by fs_unlock().
+ */
+#define FS_PENDING_COOKIES_MAX 64
+static uint32_t _fs_pending_cookies[FS_PENDING_COOKIES_MAX];
+static unsigned _fs_pending_count = 0;
+
 static int _mk_dir(const char *dev_dir, const char *vg_name)
 {
 	static char vg_path[PATH_MAX];
@@ -485,11 +493,38 @@ int fs_rename_lv(const struct logical_volume *lv, const char *dev,
 		      dev, old_lvname, lv->vg->cmd->current_settings.udev_rules);
 }
 
+/* Drop pending cookies udev has already finished with. */
+static void _reap_pending_cookies(void)
+{
+	unsigned i = 0;
+	int ready;
+
+	while (i < _fs_pending_count) {
+		if (!dm_udev_wait_immediate(_fs_pending_cookies[i], &ready)) {
+			stack;
+			ready = 1; /* Semaphore is gone, nothing to wait for */
+		}
+
+		if (ready)
+			_fs_pending_cookies[i] = _fs_pending_cookies[--_fs_pending_count];
+		else
+			i++;
+	}
+}
+
+static void _wait_pending_cookies(void)
+{
+	while (_fs_pending_count)
+		if (!dm_udev_wait(_fs_pending_cookies[--_fs_pending_count]))
+			stack;
+}
+
 void fs_unlock(void)
 {
 	if (!prioritized_section()) {
 		log_debug_activation("Syncing device names");
 		/* Wait for all processed udev devices */
+		_wait_pending_cookies();
 		if (!dm_udev_wait(_fs_cookie))
 			stack;
 		_fs_cookie = DM_COOKIE_AUTO_CREATE; /* Reset cookie */
@@ -498,6 +533,32 @@ void fs_unlock(void)
 	}
 }
 
+/*
+ * Start a new udev transaction without waiting for the current one.
+ * Udev works on the devices of the finished transaction while the next
+ * ones are set up; fs_unlock() waits for all of them.
+ */
+void fs_unlock_deferred(void)
+{
+	if (prioritized_section())
+		return;
+
+	if (_fs_cookie == DM_COOKIE_AUTO_CREATE)
+		return;
+
+	_reap_pending_cookies();
+
+	if (_fs_pending_count == FS_PENDING_COOKIES_MAX) {
+		fs_unlock();
+		return;
+	}
+
+	log_debug_activation("Deferring sync of device names for udev cookie 0x%" PRIx32 ".",
+			     _fs_cookie);
+	_fs_pending_cookies[_fs_pending_count++] = _fs_cookie;
+	_fs_cookie = DM_COOKIE_AUTO_CREATE;
+}
+
 uint32_t fs_get_cookie(void)
 {
 	return _fs_cookie;
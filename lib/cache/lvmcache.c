@@ -58,6 +58,7 @@ struct lvmcache_vginfo {
 	size_t mda_size;
 	int seqno;
 	int scan_summary_mismatch; /* vgsummary from devs had mismatching seqno or checksum */
+	int rescanned;		/* devs rescanned while the VG lock is held */
 };
 
 static struct dm_hash_table *_pvid_hash = NULL;
@@ -103,6 +104,13 @@ void lvmcache_lock_vgname(const char *vgname, int read_only __attribute__((unuse
 
 void lvmcache_unlock_vgname(const char *vgname)
 {
+	struct lvmcache_vginfo *vginfo;
+
+	/* A rescan is only current while the VG lock is held */
+	if (_vgname_hash)
+		for (vginfo = dm_hash_lookup(_vgname_hash, vgname); vginfo; vginfo = vginfo->next)
+			vginfo->rescanned = 0;
+
 	/* FIXME Do this per-VG */
 	if (strcmp(vgname, VG_GLOBAL) && !--_vgs_locked) {
 		dev_size_seqno_inc(); /* invalidate all cached dev sizes */
@@ -767,14 +775,18 @@ next:
  * to that VG after a scan.
  */
 
-int lvmcache_label_rescan_vg(struct cmd_context *cmd, const char *vgname, const char *vgid)
+/*
+ * Move the devices of the VG from lvmcache to the devs list, so they
+ * can be scanned again.  Deleting the last info also deletes vginfo.
+ */
+static int _drop_vg_devs(const char *vgname, const char *vgid, struct dm_list *devs)
 {
-	struct dm_list devs;
-	struct device_list *devl, *devl2;
+	struct dm_list vg_devs;
+	struct device_list *devl;
 	struct lvmcache_vginfo *vginfo;
 	struct lvmcache_info *info;
 
-	dm_list_init(&devs);
+	dm_list_init(&vg_devs);
 
 	if (!(vginfo = lvmcache_vginfo_from_vgname(vgname, vgid)))
 		return_0;
@@ -782,29 +794,54 @@ int lvmcache_label_rescan_vg(struct cmd_context *cmd, const char *vgname, const
 	dm_list_iterate_items(info, &vginfo->infos) {
 		if (!(devl = malloc(sizeof(*devl)))) {
 			log_error("device_list element allocation failed");
+			dm_list_splice(devs, &vg_devs);
 			return 0;
 		}
 		devl->dev = info->dev;
-		dm_list_add(&devs, &devl->list);
+		dm_list_add(&vg_devs, &devl->list);
 	}
 
 	/* Delete info for each dev, deleting the last info will delete vginfo. */
-	dm_list_iterate_items(devl, &devs)
+	dm_list_iterate_items(devl, &vg_devs)
 		lvmcache_del_dev(devl->dev);
 
 	/* Dropping the last info struct is supposed to drop vginfo. */
 	if ((vginfo = lvmcache_vginfo_from_vgname(vgname, vgid)))
 		log_warn("VG info not dropped before rescan of %s", vgname);
 
-	/* FIXME: should we also rescan unused_duplicate_devs for devs
-	   being rescanned here and then repeat resolving the duplicates? */
+	dm_list_splice(devs, &vg_devs);
 
-	label_scan_devs(cmd, cmd->filter, &devs);
+	return 1;
+}
+
+static void _free_devs(struct dm_list *devs)
+{
+	struct device_list *devl, *devl2;
 
-	dm_list_iterate_items_safe(devl, devl2, &devs) {
+	dm_list_iterate_items_safe(devl, devl2, devs) {
 		dm_list_del(&devl->list);
 		free(devl);
 	}
+}
+
+int lvmcache_label_rescan_vg(struct cmd_context *cmd, const char *vgname, const char *vgid)
+{
+	struct dm_list devs;
+	struct lvmcache_vginfo *vginfo;
+
+	dm_list_init(&devs);
+
+	if (!_drop_vg_devs(vgname, vgid, &devs)) {
+		_free_devs(&devs);
+		return_0;
+	}
+
+	/* FIXME: should we also rescan unused_duplicate_devs for devs
+	   being rescanned here and then repeat resolving the duplicates? */
+
+	label_scan_devs(cmd, cmd->filter, &devs);
+
+	_free_devs(&devs);
 
 	if (!(vginfo = lvmcache_vginfo_from_vgname(vgname, vgid))) {
 		log_warn("VG info not found after rescan of %s", vgname);
@@ -814,6 +851,53 @@ int lvmcache_label_rescan_vg(struct cmd_context *cmd, const char *vgname, const
 	return 1;
 }
 
+/*
+ * Rescan the devices of several VGs together, so the reads for all of
+ * them are issued at once.  The caller holds the lock of each VG in the
+ * list, and each VG is marked so that vg_read() does not rescan its
+ * devices again until the VG lock is released.
+ */
+int lvmcache_label_rescan_vgs(struct cmd_context *cmd, struct dm_list *vgnameids)
+{
+	struct dm_list devs;
+	struct vgnameid_list *vgnl;
+	struct lvmcache_vginfo *vginfo;
+	int r = 1;
+
+	dm_list_init(&devs);
+
+	dm_list_iterate_items(vgnl, vgnameids)
+		if (!_drop_vg_devs(vgnl->vg_name, vgnl->vgid, &devs))
+			r = 0;
+
+	log_debug_cache("Rescanning devices for %u VGs.", dm_list_size(vgnameids));
+
+	label_scan_devs(cmd, cmd->filter, &devs);
+
+	_free_devs(&devs);
+
+	dm_list_iterate_items(vgnl, vgnameids) {
+		if (!(vginfo = lvmcache_vginfo_from_vgname(vgnl->vg_name, vgnl->vgid))) {
+			log_warn("VG info not found after rescan of %s", vgnl->vg_name);
+			r = 0;
+			continue;
+		}
+		vginfo->rescanned = 1;
+	}
+
+	return r;
+}
+
+int lvmcache_vg_is_rescanned(const char *vgname, const char *vgid)
+{
+	struct lvmcache_vginfo *vginfo;
+
+	if (!(vginfo = lvmcache_vginfo_from_vgname(vgname, vgid)))
+		return 0;
+
+	return vginfo->rescanned;
+}
+
 /*
  * Uses label_scan to populate lvmcache with 'vginfo' struct for each VG
  * and associated 'info' structs for those VGs.  Only VG summary information
@@ -1174,6 +1174,9 @@ int init_filters(struct cmd_context *cmd, unsigned load_persistent_cache)
 		return 0;
 	}
 
+	if (!cmd->initialized.devices && !init_devices(cmd))
+		return_0;
+
 	cmd->lvmetad_filter = _init_lvmetad_filter_chain(cmd);
 	if (!cmd->lvmetad_filter)
 		goto_bad;
@@ -1450,7 +1453,7 @@ static int _init_backup(struct cmd_context *cmd)
 
 	if (!cmd->system_dir[0]) {
 		log_warn("WARNING: Metadata changes will NOT be backed up");
-		backup_init(cmd, "", 0);
+		backup_init(cmd, "", 0, 0);
 		archive_init(cmd, "", 0, 0, 0);
 		return 1;
 	}
@@ -1478,7 +1481,8 @@ static int _init_backup(struct cmd_context *cmd)
 	if (!(dir = find_config_tree_str(cmd, backup_backup_dir_CFG, NULL)))
 		return_0;
 
-	if (!backup_init(cmd, dir, cmd->default_settings.backup)) {
+	if (!backup_init(cmd, dir, cmd->default_settings.backup,
+			 find_config_tree_bool(cmd, backup_deferred_CFG, NULL))) {
 		log_debug("backup_init failed.");
 		return 0;
 	}
@@ -1531,6 +1535,122 @@ bad:
 	return 0;
 }
 
+/* A failed timestamp allocation only loses the startup report. */
+static void _startup_begin(struct cmd_context *cmd)
+{
+	struct cmd_startup *st = &cmd->startup;
+
+	if (!(st->start = dm_timestamp_alloc()) ||
+	    !(st->last = dm_timestamp_alloc()))
+		return;
+
+	(void) dm_timestamp_get(st->start);
+	dm_timestamp_copy(st->last, st->start);
+}
+
+/* Record the time since the previous step, until the report is logged. */
+void startup_step_done(struct cmd_context *cmd, const char *name)
+{
+	struct cmd_startup *st = &cmd->startup;
+	struct dm_timestamp *now;
+
+	if (!st->start || !st->last || (st->count == STARTUP_STEPS_MAX) ||
+	    !(now = dm_timestamp_alloc()))
+		return;
+
+	(void) dm_timestamp_get(now);
+	st->step[st->count].name = name;
+	st->step[st->count].usecs = dm_timestamp_delta(now, st->last) / 1000;
+	st->count++;
+	dm_timestamp_copy(st->last, now);
+	dm_timestamp_destroy(now);
+}
+
+static void _destroy_startup(struct cmd_context *cmd)
+{
+	if (cmd->startup.start)
+		dm_timestamp_destroy(cmd->startup.start);
+	if (cmd->startup.last)
+		dm_timestamp_destroy(cmd->startup.last);
+	memset(&cmd->startup, 0, sizeof(cmd->startup));
+}
+
+/* Log the recorded steps once, when debug messages are enabled. */
+void startup_log(struct cmd_context *cmd)
+{
+	struct cmd_startup *st = &cmd->startup;
+	unsigned i;
+
+	if (!st->start || !st->last)
+		return;
+
+	for (i = 0; i < st->count; i++)
+		log_debug("Startup %-16s " FMTu64 " us.", st->step[i].name, st->step[i].usecs);
+
+	log_debug("Startup %-16s " FMTu64 " us.", "total",
+		  dm_timestamp_delta(st->last, st->start) / 1000);
+
+	_destroy_startup(cmd);
+}
+
+/*
+ * Device types and the device cache, needed by the filters.
+ */
+int init_devices(struct cmd_context *cmd)
+{
+	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
+						find_config_tree_array(cmd, devices_types_CFG, NULL))))
+		goto_bad;
+
+	startup_step_done(cmd, "device types");
+
+	if (!_init_dev_cache(cmd))
+		goto_bad;
+
+	startup_step_done(cmd, "device cache");
+
+	cmd->initialized.devices = 1;
+	return 1;
+bad:
+	cmd->initialized.devices = 0;
+	return 0;
+}
+
+/*
+ * Metadata formats, lvmcache, segment types and the archive and
+ * backup settings, needed by commands that process metadata.
+ */
+int init_formats(struct cmd_context *cmd)
+{
+	if (!_init_formats(cmd))
+		goto_bad;
+
+	if (!lvmcache_init(cmd))
+		goto_bad;
+
+	/* FIXME: move into lvmcache_init */
+	if (!init_lvmcache_orphans(cmd))
+		goto_bad;
+
+	startup_step_done(cmd, "formats");
+
+	if (!_init_segtypes(cmd))
+		goto_bad;
+
+	startup_step_done(cmd, "segment types");
+
+	if (!_init_backup(cmd))
+		goto_bad;
+
+	startup_step_done(cmd, "backup");
+
+	cmd->initialized.formats = 1;
+	return 1;
+bad:
+	cmd->initialized.formats = 0;
+	return 0;
+}
+
 int init_run_by_dmeventd(struct cmd_context *cmd)
 {
 	init_dmeventd_monitor(DMEVENTD_MONITOR_IGNORE);
@@ -1633,6 +1753,7 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 		log_error("Failed to allocate command context");
 		return NULL;
 	}
+	_startup_begin(cmd);
 	cmd->is_long_lived = is_clvmd;
 	cmd->is_clvmd = is_clvmd;
 	cmd->threaded = threaded ? 1 : 0;
@@ -1640,6 +1761,7 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 	cmd->handles_unknown_segments = 0;
 	cmd->hosttags = 0;
 	dm_list_init(&cmd->arg_value_groups);
+	dm_list_init(&cmd->thin_usage_cache);
 	dm_list_init(&cmd->formats);
 	dm_list_init(&cmd->segtypes);
 	dm_list_init(&cmd->tags);
@@ -1725,6 +1847,8 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 	if (!_init_lvm_conf(cmd))
 		goto_out;
 
+	startup_step_done(cmd, "lvm.conf");
+
 	_init_logging(cmd);
 
 	if (!_init_hostname(cmd))
@@ -1733,6 +1857,8 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 	if (!_init_tags(cmd, cmd->cft))
 		goto_out;
 
+	startup_step_done(cmd, "hostname/tags");
+
 	/* Load lvmlocal.conf */
 	if (*cmd->system_dir && !_load_config_file(cmd, "", 1))
 		goto_out;
@@ -1746,40 +1872,26 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 	if (!_process_config(cmd))
 		goto_out;
 
-	if (!_init_profiles(cmd))
-		goto_out;
+	startup_step_done(cmd, "config merge");
 
-	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
-						find_config_tree_array(cmd, devices_types_CFG, NULL))))
+	if (!_init_profiles(cmd))
 		goto_out;
 
-	if (!_init_dev_cache(cmd))
-		goto_out;
+	startup_step_done(cmd, "profiles");
 
 	memlock_init(cmd);
 
-	if (!_init_formats(cmd))
-		goto_out;
-
-	if (!lvmcache_init(cmd))
-		goto_out;
-
-	/* FIXME: move into lvmcache_init */
-	if (!init_lvmcache_orphans(cmd))
-		goto_out;
-
 	dm_list_init(&cmd->unused_duplicate_devs);
 
-	if (!_init_segtypes(cmd))
-		goto_out;
-
-	if (!_init_backup(cmd))
-		goto_out;
-
 	_init_rand(cmd);
 
 	_init_globals(cmd);
 
+	/*
+	 * Devices, formats and segment types are set up on first use,
+	 * so commands that do not process metadata never pay for them.
+	 */
+
 	if (set_connections && !init_connections(cmd))
 		goto_out;
 
@@ -1881,6 +1993,8 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	struct dm_config_tree *cft_cmdline, *cft_tmp;
 	const char *profile_command_name, *profile_metadata_name;
 	struct profile *profile;
+	unsigned devices = cmd->initialized.devices;
+	unsigned formats = cmd->initialized.formats;
 
 	log_verbose("Reloading config files");
 
@@ -1901,6 +2015,9 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	_destroy_dev_types(cmd);
 	_destroy_tags(cmd);
 
+	cmd->initialized.devices = 0;
+	cmd->initialized.formats = 0;
+
 	/* save config string passed on the command line */
 	cft_cmdline = remove_config_tree_by_source(cmd, CONFIG_STRING);
 
@@ -1968,26 +2085,11 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	if (!_init_profiles(cmd))
 		return_0;
 
-	if (!(cmd->dev_types = create_dev_types(cmd->proc_dir,
-						find_config_tree_array(cmd, devices_types_CFG, NULL))))
+	/* Only the parts already in use are set up again */
+	if (devices && !init_devices(cmd))
 		return_0;
 
-	if (!_init_dev_cache(cmd))
-		return_0;
-
-	if (!_init_formats(cmd))
-		return_0;
-
-	if (!lvmcache_init(cmd))
-		return_0;
-
-	if (!init_lvmcache_orphans(cmd))
-		return_0;
-
-	if (!_init_segtypes(cmd))
-		return_0;
-
-	if (!_init_backup(cmd))
+	if (formats && !init_formats(cmd))
 		return_0;
 
 	cmd->initialized.config = 1;
@@ -2055,6 +2157,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 		free(cmd->linebuffer);
 	}
 #endif
+	_destroy_startup(cmd);
 	free(cmd);
 
 	lvmpolld_disconnect();
@@ -65,6 +65,26 @@ struct cmd_context_initialized_parts {
 	unsigned config:1; /* used to reinitialize config if previous init was not successful */
 	unsigned filters:1;
 	unsigned connections:1;
+	unsigned devices:1;	/* device types and device cache */
+	unsigned formats:1;	/* formats, lvmcache, segment types, archives and backups */
+};
+
+/*
+ * Time taken by each step of the tool context initialisation.
+ * Logged with the debug messages of the first command.
+ */
+#define STARTUP_STEPS_MAX 24
+
+struct cmd_startup_step {
+	const char *name;
+	uint64_t usecs;
+};
+
+struct cmd_startup {
+	struct dm_timestamp *start;	/* context creation */
+	struct dm_timestamp *last;	/* end of the last timed step */
+	unsigned count;
+	struct cmd_startup_step step[STARTUP_STEPS_MAX];
 };
 
 struct cmd_report {
@@ -128,6 +148,7 @@ struct cmd_context {
 	 * Initialization state.
 	 */
 	struct cmd_context_initialized_parts initialized;
+	struct cmd_startup startup;
 
 	/*
 	 * Switches.
@@ -140,6 +161,7 @@ struct cmd_context {
 	unsigned use_linear_target:1;
 	unsigned partial_activation:1;
 	unsigned degraded_activation:1;
+	unsigned fast_activation:1;
 	unsigned auto_set_activation_skip:1;
 	unsigned si_unit_consistency:1;
 	unsigned report_binary_values_as_numeric:1;
@@ -149,6 +171,8 @@ struct cmd_context {
 	unsigned unknown_system_id:1;
 	unsigned include_historical_lvs:1;	/* also process/report/display historical LVs */
 	unsigned record_historical_lvs:1;	/* record historical LVs */
+	unsigned defer_thin_pool_updates:1;	/* send queued thin pool messages once per VG */
+	unsigned report_thin_usage:1;		/* thin_exclusive/shared_size named in report */
 	unsigned include_foreign_vgs:1;		/* report/display cmds can reveal foreign VGs */
 	unsigned include_shared_vgs:1;		/* report/display cmds can reveal lockd VGs */
 	unsigned include_active_foreign_vgs:1;	/* cmd should process foreign VGs with active LVs */
@@ -172,6 +196,7 @@ struct cmd_context {
 	unsigned is_clvmd:1;
 	unsigned use_full_md_check:1;
 	unsigned is_activating:1;
+	unsigned defer_dev_sync:1;		/* VG unlocks wait for udev together */
 
 	/*
 	 * Filtering.
@@ -230,6 +255,7 @@ struct cmd_context {
 	const char *time_format;
 	unsigned rand_seed;
 	struct dm_list unused_duplicate_devs; /* save preferences between lvmcache instances */
+	struct dm_list thin_usage_cache;	/* thin pool metadata snapshot scans */
 };
 
 /*
@@ -250,7 +276,11 @@ int config_files_changed(struct cmd_context *cmd);
 int init_lvmcache_orphans(struct cmd_context *cmd);
 int init_filters(struct cmd_context *cmd, unsigned load_persistent_cache);
 int init_connections(struct cmd_context *cmd);
+int init_devices(struct cmd_context *cmd);
+int init_formats(struct cmd_context *cmd);
 int init_run_by_dmeventd(struct cmd_context *cmd);
+void startup_step_done(struct cmd_context *cmd, const char *name);
+void startup_log(struct cmd_context *cmd);
 
 /*
  * A config context is a very light weight cmd struct that
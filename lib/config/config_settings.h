@@ -831,6 +831,16 @@ cfg(backup_retain_min_CFG, "retain_min", backup_CFG_SECTION, 0, CFG_TYPE_INT, DE
 cfg(backup_retain_days_CFG, "retain_days", backup_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_ARCHIVE_DAYS, vsn(1, 0, 0), NULL, 0, NULL,
 	"Minimum number of days to keep archive files.\n")
 
+cfg(backup_deferred_CFG, "deferred", backup_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_BACKUP_DEFERRED, vsn(2, 3, 1), NULL, 0, NULL,
+	"Write backups after the VG lock is released.\n"
+	"The metadata is exported in memory while the VG is locked, and\n"
+	"the backup file is written once the command unlocks the VG, so\n"
+	"other commands are not kept waiting for it. Archives are still\n"
+	"written before the metadata is changed. A marker\n"
+	"file in the backup directory records the metadata version whose\n"
+	"backup is pending, so a backup left out of date by an interrupted\n"
+	"command is replaced by the next command reading the VG.\n")
+
 cfg(shell_history_size_CFG, "history_size", shell_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_MAX_HISTORY, vsn(1, 0, 0), NULL, 0, NULL,
 	"Number of lines of history to store in ~/.lvm_history.\n")
 
@@ -1187,6 +1197,21 @@ cfg(activation_verify_udev_operations_CFG, "verify_udev_operations", activation_
 	"in the device directory after udev has completed processing its\n"
 	"events. Useful for diagnosing problems with LVM/udev interactions.\n")
 
+cfg(activation_fast_activation_CFG, "fast_activation", activation_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_FAST_ACTIVATION, vsn(2, 3, 1), NULL, 0, NULL,
+	"Do not let LV activation wait for udev.\n"
+	"LVM creates the device nodes in the device-mapper directory and the\n"
+	"symlinks in the VG directory itself, together when the command syncs\n"
+	"device names, and marks the uevents so udev skips that part of its\n"
+	"rules. Commands do not wait for udev, which processes the remaining\n"
+	"rules (/dev/disk links, udev database) in the background. This\n"
+	"applies only to commands activating LVs with -ay or -aay, like\n"
+	"vgchange, lvchange and pvscan. For them it overrides udev_rules and\n"
+	"udev_sync, with a warning when those are set in the configuration,\n"
+	"so the same caveat applies when it is changed while LVs are active.\n"
+	"Useful when activating very many LVs at boot, when udev throughput\n"
+	"would otherwise limit activation. Other commands still use udev\n"
+	"as configured.\n")
+
 cfg(activation_retry_deactivation_CFG, "retry_deactivation", activation_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_RETRY_DEACTIVATION, vsn(2, 2, 89), NULL, 0, NULL,
 	"Retry failed LV deactivation.\n"
 	"If LV deactivation fails, LVM will retry for a few seconds before\n"
@@ -1216,6 +1241,14 @@ cfg(activation_reserved_memory_CFG, "reserved_memory", activation_CFG_SECTION, 0
 	"Memory size in KiB to reserve for use while devices are suspended.\n"
 	"Insufficent reserve risks I/O deadlock during device suspension.\n")
 
+cfg(activation_reserved_pool_memory_CFG, "reserved_pool_memory", activation_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_RESERVED_POOL_MEMORY, vsn(2, 3, 1), NULL, 0, NULL,
+	"Memory size in KiB preallocated for memory pools while devices are suspended.\n"
+	"New memory pool chunks are taken from this locked area instead of\n"
+	"from malloc while devices are suspended. When it runs out, malloc\n"
+	"and reserved_memory are used and a warning is printed when memory\n"
+	"is unlocked. The amount used is logged with debug logging.\n"
+	"Set to 0 to disable.\n")
+
 cfg(activation_process_priority_CFG, "process_priority", activation_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_PROCESS_PRIORITY, vsn(1, 0, 0), NULL, 0, NULL,
 	"Nice value used while devices are suspended.\n"
 	"Use a high priority so that LVs are suspended\n"
@@ -1493,6 +1526,31 @@ cfg_array(activation_mlock_filter_CFG, "mlock_filter", activation_CFG_SECTION, C
 	"mlock_filter = [ \"locale/locale-archive\", \"gconv/gconv-modules.cache\" ]\n"
 	"#\n")
 
+cfg(activation_mlock_targeted_CFG, "mlock_targeted", activation_CFG_SECTION, CFG_ADVANCED, CFG_TYPE_BOOL, DEFAULT_MLOCK_TARGETED, vsn(2, 3, 1), NULL, 0, NULL,
+	"Pin only the memory areas used while devices are suspended.\n"
+	"Instead of pinning every area in /proc/self/maps not matched by\n"
+	"mlock_filter, LVM pins its anonymous memory (heap, stack and\n"
+	"allocator arenas), its own executable and the libraries matched by\n"
+	"mlock_select. When mlock_select is not set, every library loaded\n"
+	"in the process is pinned and only other mapped files are left out,\n"
+	"so about as much is pinned as without this setting. Listing just\n"
+	"the libraries used while devices are suspended in mlock_select is\n"
+	"what makes entering and leaving the critical section cheaper.\n"
+	"Areas matching mlock_filter are still not pinned.\n"
+	"This setting has no effect when use_mlockall is enabled.\n")
+
+cfg_array(activation_mlock_select_CFG, "mlock_select", activation_CFG_SECTION, CFG_DEFAULT_UNDEFINED | CFG_ADVANCED, CFG_TYPE_STRING, NULL, vsn(2, 3, 1), NULL, 0, NULL,
+	"Libraries to mlock with mlock_targeted.\n"
+	"Each string listed in this setting is compared against each line in\n"
+	"/proc/self/maps that maps a file other than the LVM executable, and\n"
+	"only the pages of matching lines are pinned. When not set, every\n"
+	"library loaded in the process, including dmeventd plugins and\n"
+	"liblvm2cmd, is pinned unless matched by mlock_filter.\n"
+	"#\n"
+	"Example\n"
+	"mlock_select = [ \"/libc.so.\", \"/libdevmapper.so.\" ]\n"
+	"#\n")
+
 cfg(activation_use_mlockall_CFG, "use_mlockall", activation_CFG_SECTION, 0, CFG_TYPE_BOOL, DEFAULT_USE_MLOCKALL, vsn(2, 2, 62), NULL, 0, NULL,
 	"Use the old behavior of mlockall to pin all memory.\n"
 	"Prior to version 2.02.62, LVM used mlockall() to pin the whole\n"
@@ -1511,6 +1569,26 @@ cfg(activation_polling_interval_CFG, "polling_interval", activation_CFG_SECTION,
 	"is only one thing to wait for, there are no progress reports, but\n"
 	"the process is awoken immediately once the operation is complete.\n")
 
+cfg(activation_pvmove_parallel_segments_CFG, "pvmove_parallel_segments", activation_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_PVMOVE_PARALLEL_SEGMENTS, vsn(2, 3, 1), NULL, 0, NULL,
+	"The number of pvmove segments copied at the same time.\n"
+	"Each segment of a pvmove is copied by its own kernel mirror.\n"
+	"Up to this number of segments are copied concurrently, and the\n"
+	"next group is started once all of them are in sync, so segments\n"
+	"going to different destination PVs use their combined bandwidth.\n"
+	"The setting is read each time the pvmove LV is reloaded, including\n"
+	"by background polling, so set it here rather than with --config.\n")
+
+cfg(activation_extent_heat_max_areas_CFG, "extent_heat_max_areas", activation_CFG_SECTION, 0, CFG_TYPE_INT, DEFAULT_EXTENT_HEAT_MAX_AREAS, vsn(2, 3, 1), NULL, 0, NULL,
+	"Maximum number of areas used to count I/O to the extents of an LV.\n"
+	"lvchange --extentheat y creates a device-mapper statistics region\n"
+	"on an active LV, with program_id lvm2_heat. Each area of the region\n"
+	"covers as many whole extents as needed to stay within this number,\n"
+	"and the extents of an area share its I/O count. The lv_hot_extents\n"
+	"and lv_cold_extents report fields list the PV extents with the most\n"
+	"and least I/O, which may be given to pvmove to move them between\n"
+	"fast and slow PVs. The region covers the LV as it was when created\n"
+	"and is removed when the LV is deactivated.\n")
+
 cfg(activation_auto_set_activation_skip_CFG, "auto_set_activation_skip", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_AUTO_SET_ACTIVATION_SKIP, vsn(2,2,99), NULL, 0, NULL,
 	"Set the activation skip flag on new thin snapshot LVs.\n"
 	"The --setactivationskip option overrides this setting.\n"
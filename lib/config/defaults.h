@@ -23,6 +23,7 @@
 
 #define DEFAULT_ARCHIVE_ENABLED 1
 #define DEFAULT_BACKUP_ENABLED 1
+#define DEFAULT_BACKUP_DEFERRED 0
 
 #define DEFAULT_CACHE_FILE_PREFIX ""
 
@@ -57,6 +58,7 @@
 #define DEFAULT_LVMETAD_UPDATE_WAIT_TIME 10
 #define DEFAULT_PRIORITISE_WRITE_LOCKS 1
 #define DEFAULT_USE_MLOCKALL 0
+#define DEFAULT_MLOCK_TARGETED 0
 #define DEFAULT_METADATA_READ_ONLY 0
 #define DEFAULT_LVDISPLAY_SHOWS_FULL_DEVICE_PATH 0
 #define DEFAULT_UNKNOWN_DEVICE_NAME "[unknown]"
@@ -188,6 +190,7 @@
 #define DEFAULT_UDEV_SYNC 1
 #define DEFAULT_NOTIFY_DBUS 1
 #define DEFAULT_VERIFY_UDEV_OPERATIONS 0
+#define DEFAULT_FAST_ACTIVATION 0
 #define DEFAULT_RETRY_DEACTIVATION 1
 #define DEFAULT_ACTIVATION_CHECKS 0
 #define DEFAULT_EXTENT_SIZE 4096	/* In KB */
@@ -228,6 +231,7 @@
 #endif
 
 #define DEFAULT_RESERVED_MEMORY 8192
+#define DEFAULT_RESERVED_POOL_MEMORY 1024
 #define DEFAULT_RESERVED_STACK 64 /* KB */
 #define DEFAULT_PROCESS_PRIORITY -18
 
@@ -237,6 +241,8 @@
 #define DEFAULT_STRIPE_FILLER "error"
 #define DEFAULT_RAID_REGION_SIZE   2048	/* KB */
 #define DEFAULT_INTERVAL 15
+#define DEFAULT_PVMOVE_PARALLEL_SEGMENTS 1
+#define DEFAULT_EXTENT_HEAT_MAX_AREAS 1024
 
 #define DEFAULT_MAX_HISTORY 100
 
@@ -49,6 +49,7 @@ static struct {
 	const char *dev_dir;
 
 	int has_scanned;
+	int current;		/* No devices changed since dev_cache_scan */
 	struct dm_list dirs;
 	struct dm_list files;
 
@@ -1185,6 +1186,16 @@ int dev_cache_has_scanned(void)
 	return _cache.has_scanned;
 }
 
+void dev_cache_set_current(int current)
+{
+	_cache.current = current;
+}
+
+int dev_cache_is_current(void)
+{
+	return _cache.has_scanned && _cache.current;
+}
+
 static int _init_preferred_names(struct cmd_context *cmd)
 {
 	const struct dm_config_node *cn;
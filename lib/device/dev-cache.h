@@ -50,6 +50,14 @@ int dev_cache_check_for_open_devices(void);
 void dev_cache_scan(void);
 int dev_cache_has_scanned(void);
 
+/*
+ * A long-lived process that watches for block device changes itself
+ * marks the list of system devices as current, so label_scan() does
+ * not search /dev again.
+ */
+void dev_cache_set_current(int current);
+int dev_cache_is_current(void);
+
 int dev_cache_add_dir(const char *path);
 struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct dev_filter *f);
 const char *dev_cache_filtered_reason(const char *name);
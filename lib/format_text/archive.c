@@ -40,8 +40,23 @@
  * the volume group name.
  *
  * Backup files that have expired will be removed.
+ *
+ * Each volume group also has an index file '$1.index' holding a line
+ * '<index> <time> <file> [<description>]' for each of its archives,
+ * oldest first.  It is appended to as archives are written, so the
+ * directory need not be scanned and the archives need not be read to
+ * find the next index, expire archives or list them.  Entries whose
+ * archive was removed by hand are dropped when the index is read, and
+ * the index is rebuilt from a directory scan if it is missing or none
+ * of its archives is left.
+ *
+ * An archive with the same metadata as the newest one is not kept:
+ * its index line names the existing file instead.  A file is removed
+ * when the last line naming it expires.
  */
 
+#define ARCHIVE_INDEX_SUFFIX ".index"
+
 /*
  * A list of these is built up for our volume group.  Ordered
  * with the least recent at the head.
@@ -51,6 +66,8 @@ struct archive_file {
 
 	const char *path;
 	uint32_t index;
+	time_t when;
+	const char *desc;	/* NULL if not in index */
 };
 
 /*
@@ -161,7 +178,7 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 		/*
 		 * Create a new archive_file.
 		 */
-		if (!(af = dm_pool_alloc(mem, sizeof(*af)))) {
+		if (!(af = dm_pool_zalloc(mem, sizeof(*af)))) {
 			log_error("Couldn't create new archive file.");
 			results = NULL;
 			goto out;
@@ -184,51 +201,361 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 	return results;
 }
 
-static void _remove_expired(struct dm_list *archives, uint32_t archives_size,
-			    uint32_t retain_days, uint32_t min_archive)
+static char *_index_path(struct dm_pool *mem, const char *dir, const char *vgname)
 {
-	struct archive_file *bf;
+	char name[NAME_LEN + sizeof(ARCHIVE_INDEX_SUFFIX)];
+
+	if (dm_snprintf(name, sizeof(name), "%s" ARCHIVE_INDEX_SUFFIX, vgname) < 0) {
+		log_error("Archive index name too long.");
+		return NULL;
+	}
+
+	return _join_file_to_dir(mem, dir, name);
+}
+
+/*
+ * Read the list of archive_files from the index, newest first.
+ * Sets *stale if entries of missing archives were left out.
+ * Returns 0 if the index is missing or unreadable.
+ */
+static int _read_index(struct dm_pool *mem, const char *index_path,
+		       const char *dir, struct dm_list *results, int *stale)
+{
+	struct archive_file *af;
+	FILE *fp;
+	char *line = NULL, *file, *desc, *nl;
+	size_t line_size = 0;
+	unsigned long long when;
+	uint32_t ix;
+	int pos, r = 0;
+
+	if (!(fp = fopen(index_path, "r"))) {
+		if (errno != ENOENT)
+			log_sys_debug("fopen", index_path);
+		return 0;
+	}
+
+	while (getline(&line, &line_size, fp) > 0) {
+		if ((nl = strchr(line, '\n')))
+			*nl = '\0';
+
+		if (sscanf(line, "%u %llu %n", &ix, &when, &pos) != 2) {
+			log_debug_metadata("Ignoring archive index %s with invalid line %s.",
+					   index_path, line);
+			goto out;
+		}
+
+		file = line + pos;
+		if ((desc = strchr(file, ' ')))
+			*desc++ = '\0';
+
+		if (!(af = dm_pool_zalloc(mem, sizeof(*af))) ||
+		    !(af->path = _join_file_to_dir(mem, dir, file)) ||
+		    (desc && !(af->desc = dm_pool_strdup(mem, desc)))) {
+			log_error("Couldn't create new archive file.");
+			goto out;
+		}
+
+		if (!path_exists(af->path)) {
+			log_debug_metadata("Archive index %s names missing archive %s.",
+					   index_path, af->path);
+			*stale = 1;
+			continue;
+		}
+
+		af->index = ix;
+		af->when = (time_t) when;
+		dm_list_add_h(results, &af->list);
+	}
+
+	r = 1;
+out:
+	free(line);
+
+	if (fclose(fp))
+		log_sys_debug("fclose", index_path);
+
+	return r;
+}
+
+/*
+ * Returns a list of archive_files, newest first, from the index or
+ * else from a scan of the directory.  Sets *indexed if the index is
+ * complete and up to date, so new entries can be appended to it.
+ */
+static struct dm_list *_get_archives(struct dm_pool *mem, const char *vgname,
+				     const char *dir, const char *index_path,
+				     int *indexed)
+{
+	struct dm_list *results;
+	struct archive_file *af;
 	struct stat sb;
+	void *mark;
+	int stale = 0;
+
+	if (!(mark = results = dm_pool_alloc(mem, sizeof(*results))))
+		return_NULL;
+
+	dm_list_init(results);
+
+	if (_read_index(mem, index_path, dir, results, &stale) &&
+	    !dm_list_empty(results)) {
+		/* An index with entries left out gets rewritten */
+		*indexed = !stale;
+		return results;
+	}
+
+	*indexed = 0;
+
+	dm_pool_free(mem, mark);
+
+	if (!(results = _scan_archive(mem, vgname, dir)))
+		return_NULL;
+
+	/* Without the index, use the mtime of the archive files */
+	dm_list_iterate_items(af, results)
+		af->when = stat(af->path, &sb) ? 0 : sb.st_mtime;
+
+	return results;
+}
+
+static int _write_index_line(FILE *fp, const struct archive_file *af)
+{
+	const char *file = strrchr(af->path, '/');
+	const char *c;
+
+	if (fprintf(fp, "%u %llu %s", af->index, (unsigned long long) af->when,
+		    file ? file + 1 : af->path) < 0)
+		return 0;
+
+	if (af->desc) {
+		if (fputc(' ', fp) == EOF)
+			return 0;
+		/* Keep each entry on a single line */
+		for (c = af->desc; *c; c++)
+			if (fputc((*c == '\n') ? ' ' : *c, fp) == EOF)
+				return 0;
+	}
+
+	return (fputc('\n', fp) != EOF);
+}
+
+/*
+ * Append the new archive to the index, or rewrite the whole index if
+ * it was not up to date or archives were expired.
+ */
+static int _write_index(struct volume_group *vg, const char *dir,
+			const char *index_path, struct dm_list *archives,
+			int append)
+{
+	struct archive_file *af;
+	char temp_file[PATH_MAX];
+	FILE *fp;
+	int fd;
+
+	if (append) {
+		if (!(fp = fopen(index_path, "a"))) {
+			log_sys_error("fopen", index_path);
+			return 0;
+		}
+
+		af = dm_list_item(dm_list_first(archives), struct archive_file);
+		if (!_write_index_line(fp, af)) {
+			log_error("Failed to write archive index %s.", index_path);
+			(void) fclose(fp);
+			return 0;
+		}
+
+		return !lvm_fclose(fp, index_path);
+	}
+
+	if (!create_temp_name(dir, temp_file, sizeof(temp_file), &fd,
+			      &vg->cmd->rand_seed)) {
+		log_error("Couldn't create temporary archive index name.");
+		return 0;
+	}
+
+	if (!(fp = fdopen(fd, "w"))) {
+		log_error("Couldn't create FILE object for archive index.");
+		if (close(fd))
+			log_sys_error("close", temp_file);
+		goto bad;
+	}
+
+	dm_list_iterate_back_items(af, archives)
+		if (!_write_index_line(fp, af)) {
+			log_error("Failed to write archive index %s.", temp_file);
+			(void) fclose(fp);
+			goto bad;
+		}
+
+	if (lvm_fclose(fp, temp_file))
+		goto bad;
+
+	if (rename(temp_file, index_path)) {
+		log_sys_error("rename", index_path);
+		goto bad;
+	}
+
+	return 1;
+bad:
+	if (unlink(temp_file))
+		log_sys_debug("unlink", temp_file);
+
+	return 0;
+}
+
+/* Is the archive file named by another entry of the list? */
+static int _archive_shared(struct dm_list *archives, struct archive_file *af)
+{
+	struct archive_file *bf;
+
+	dm_list_iterate_items(bf, archives)
+		if ((bf != af) && !strcmp(bf->path, af->path))
+			return 1;
+
+	return 0;
+}
+
+/* Entries naming the same file are adjacent, count each file once. */
+static uint32_t _count_archive_files(struct dm_list *archives)
+{
+	struct archive_file *bf, *prev = NULL;
+	uint32_t count = 0;
+
+	dm_list_iterate_items(bf, archives) {
+		if (!prev || strcmp(bf->path, prev->path))
+			count++;
+		prev = bf;
+	}
+
+	return count;
+}
+
+/* Returns the number of index entries expired. */
+static unsigned _remove_expired(struct dm_list *archives,
+				uint32_t retain_days, uint32_t min_archive)
+{
+	struct archive_file *bf;
 	time_t retain_time;
+	uint32_t archives_size = _count_archive_files(archives);
+	unsigned expired = 0;
 
 	/* Make sure there are enough archives to even bother looking for
 	 * expired ones... */
 	if (archives_size <= min_archive)
-		return;
+		return 0;
 
 	/* Convert retain_days into the time after which we must retain */
 	retain_time = time(NULL) - (time_t) retain_days *SECS_PER_DAY;
 
 	/* Assume list is ordered newest first (by index) */
-	dm_list_iterate_back_items(bf, archives) {
-		/* Get the mtime of the file and unlink if too old */
-		if (stat(bf->path, &sb)) {
-			log_sys_error("stat", bf->path);
-			continue;
-		}
+	while (!dm_list_empty(archives)) {
+		bf = dm_list_item(dm_list_last(archives), struct archive_file);
+		if (bf->when > retain_time)
+			break;
 
-		if (sb.st_mtime > retain_time)
-			return;
+		dm_list_del(&bf->list);
+		expired++;
+
+		/* The file is still needed by a newer entry */
+		if (_archive_shared(archives, bf))
+			continue;
 
 		log_very_verbose("Expiring archive %s", bf->path);
-		if (unlink(bf->path))
+		if (unlink(bf->path) && (errno != ENOENT))
 			log_sys_error("unlink", bf->path);
 
 		/* Don't delete any more if we've reached the minimum */
 		if (--archives_size <= min_archive)
-			return;
+			break;
 	}
+
+	return expired;
+}
+
+/*
+ * Read a whole archive file.  Returns the metadata following the header,
+ * i.e. without the description and time, which differ between copies.
+ */
+static char *_read_archive_body(const char *path, char **buf, size_t *len)
+{
+	struct stat info;
+	char *body;
+	int fd;
+
+	*buf = NULL;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		log_sys_debug("open", path);
+		return NULL;
+	}
+
+	if (fstat(fd, &info)) {
+		log_sys_debug("fstat", path);
+		goto out;
+	}
+
+	if (!(*buf = malloc(info.st_size + 1))) {
+		log_error("Failed to allocate archive buffer.");
+		goto out;
+	}
+
+	if (read(fd, *buf, info.st_size) != info.st_size) {
+		log_sys_debug("read", path);
+		goto bad;
+	}
+
+	(*buf)[info.st_size] = '\0';
+
+	if (!(body = strstr(*buf, "\ncreation_time = ")) ||
+	    !(body = strchr(body + 1, '\n')))
+		goto bad;
+
+	*len = info.st_size - (body - *buf);
+
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	return body;
+bad:
+	free(*buf);
+	*buf = NULL;
+out:
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	return NULL;
+}
+
+/* Do the two archives hold the same metadata? */
+static int _same_archive(const char *path1, const char *path2)
+{
+	char *buf1, *buf2, *body1, *body2;
+	size_t len1, len2;
+	int r = 0;
+
+	if ((body1 = _read_archive_body(path1, &buf1, &len1)) &&
+	    (body2 = _read_archive_body(path2, &buf2, &len2))) {
+		r = (len1 == len2) && !memcmp(body1, body2, len1);
+		free(buf2);
+	}
+
+	free(buf1);
+
+	return r;
 }
 
 int archive_vg(struct volume_group *vg,
 	       const char *dir, const char *desc,
 	       uint32_t retain_days, uint32_t min_archive)
 {
-	int i, fd, rnum, renamed = 0;
+	int i, fd, rnum, renamed = 0, indexed;
 	uint32_t ix = 0;
-	struct archive_file *last;
+	struct archive_file *last, *af;
 	FILE *fp = NULL;
 	char temp_file[PATH_MAX], archive_name[PATH_MAX];
+	const char *index_path;
 	struct dm_list *archives;
 
 	/*
@@ -259,7 +586,8 @@ int archive_vg(struct volume_group *vg,
 	/*
 	 * Now we want to rename this file to <vg>_index.vg.
 	 */
-	if (!(archives = _scan_archive(vg->cmd->mem, vg->name, dir)))
+	if (!(index_path = _index_path(vg->cmd->mem, dir, vg->name)) ||
+	    !(archives = _get_archives(vg->cmd->mem, vg->name, dir, index_path, &indexed)))
 		return_0;
 
 	if (dm_list_empty(archives))
@@ -267,6 +595,17 @@ int archive_vg(struct volume_group *vg,
 	else {
 		last = dm_list_item(dm_list_first(archives), struct archive_file);
 		ix = last->index + 1;
+
+		/* Unchanged since the newest archive, only add an index entry */
+		if (_same_archive(temp_file, last->path)) {
+			log_debug_metadata("Archive %s is unchanged, not keeping a new copy.",
+					   last->path);
+			if (unlink(temp_file))
+				log_sys_debug("unlink", temp_file);
+			(void) dm_strncpy(archive_name, last->path, sizeof(archive_name));
+			ix = last->index;
+			goto add_entry;
+		}
 	}
 
 	rnum = rand_r(&vg->cmd->rand_seed);
@@ -285,16 +624,35 @@ int archive_vg(struct volume_group *vg,
 		ix++;
 	}
 
-	if (!renamed)
+	if (!renamed) {
 		log_error("Archive rename failed for %s", temp_file);
+		return 1;
+	}
 
-	_remove_expired(archives, dm_list_size(archives) + renamed, retain_days,
-			min_archive);
+add_entry:
+	if (!(af = dm_pool_zalloc(vg->cmd->mem, sizeof(*af))) ||
+	    !(af->path = dm_pool_strdup(vg->cmd->mem, archive_name)) ||
+	    !(af->desc = dm_pool_strdup(vg->cmd->mem, desc ? : ""))) {
+		log_error("Couldn't create new archive file.");
+		return 1;
+	}
+
+	af->index = ix;
+	af->when = time(NULL);
+	dm_list_add_h(archives, &af->list);
+
+	if (_remove_expired(archives, retain_days, min_archive))
+		indexed = 0;
+
+	/* Index is only an optimisation: without it, the directory is scanned */
+	if (!_write_index(vg, dir, index_path, archives, indexed))
+		log_warn("WARNING: Failed to update archive index %s.", index_path);
 
 	return 1;
 }
 
-static void _display_archive(struct cmd_context *cmd, struct archive_file *af)
+static void _display_archive(struct cmd_context *cmd, const char *vgname,
+			     struct archive_file *af)
 {
 	struct volume_group *vg = NULL;
 	struct format_instance *tf;
@@ -308,6 +666,14 @@ static void _display_archive(struct cmd_context *cmd, struct archive_file *af)
 	log_print(" ");
 	log_print("File:\t\t%s", af->path);
 
+	/* The index already has what is displayed */
+	if (vgname && af->desc) {
+		log_print("VG name:    \t%s", vgname);
+		log_print("Description:\t%s", *af->desc ? af->desc : "<No description>");
+		log_print("Backup Time:\t%s", ctime(&af->when));
+		return;
+	}
+
 	fic.type = FMT_INSTANCE_PRIVATE_MDAS;
 	fic.context.private = &tc;
 	if (!(tf = cmd->fmt_backup->ops->create_instance(cmd->fmt_backup, &fic))) {
@@ -337,46 +703,49 @@ int archive_list(struct cmd_context *cmd, const char *dir, const char *vgname)
 {
 	struct dm_list *archives;
 	struct archive_file *af;
+	const char *index_path;
+	int indexed;
 
-	if (!(archives = _scan_archive(cmd->mem, vgname, dir)))
+	if (!(index_path = _index_path(cmd->mem, dir, vgname)))
+		return_0;
+
+	if (!(archives = _get_archives(cmd->mem, vgname, dir, index_path, &indexed)))
 		return_0;
 
 	if (dm_list_empty(archives))
 		log_print("No archives found in %s.", dir);
 
 	dm_list_iterate_back_items(af, archives)
-		_display_archive(cmd, af);
+		_display_archive(cmd, vgname, af);
 
-	dm_pool_free(cmd->mem, archives);
+	dm_pool_free(cmd->mem, (void *) index_path);
 
 	return 1;
 }
 
 int archive_list_file(struct cmd_context *cmd, const char *file)
 {
-	struct archive_file af;
-
-	af.path = file;
+	struct archive_file af = { .path = file };
 
 	if (!path_exists(af.path)) {
 		log_error("Archive file %s not found.", af.path);
 		return 0;
 	}
 
-	_display_archive(cmd, &af);
+	_display_archive(cmd, NULL, &af);
 
 	return 1;
 }
 
 int backup_list(struct cmd_context *cmd, const char *dir, const char *vgname)
 {
-	struct archive_file af;
+	struct archive_file af = { 0 };
 
 	if (!(af.path = _join_file_to_dir(cmd->mem, dir, vgname)))
 		return_0;
 
 	if (path_exists(af.path))
-		_display_archive(cmd, &af);
+		_display_archive(cmd, NULL, &af);
 
 	return 1;
 }
@@ -16,6 +16,8 @@
 #include "lib/misc/lib.h"
 #include "lib/format_text/archiver.h"
 #include "lib/format_text/format-text.h"
+#include "lib/format_text/import-export.h"
+#include "lib/misc/lvm-file.h"
 #include "lib/misc/lvm-string.h"
 #include "lib/cache/lvmcache.h"
 #include "lib/mm/memlock.h"
@@ -23,6 +25,8 @@
 #include "lib/locking/locking.h"
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
 
 struct archive_params {
 	int enabled;
@@ -35,6 +39,32 @@ struct backup_params {
 	int enabled;
 	char *dir;
 	int suppress;
+	int deferred;
+	struct dm_list pending;		/* struct pending_backup */
+};
+
+/*
+ * With backup/deferred set, backup() only exports the metadata text
+ * while the VG is locked.  backup_flush() writes the file once the VG
+ * lock is released.  Archives are always written before the metadata
+ * is committed, as vgcfgrestore depends on them.
+ *
+ * While a backup is pending, the file <backup_dir>/<vg>#pending holds
+ * the seqno of the metadata to be backed up.  It is locked with flock
+ * while it is updated and while the backup is moved into place, so a
+ * command finishing late does not replace the backup written by a
+ * newer command.  A marker left behind by an interrupted command makes
+ * check_current_backup() replace the backup.
+ */
+#define PENDING_BACKUP_SUFFIX "#pending"
+
+struct pending_backup {
+	struct dm_list list;
+	char *vgname;
+	char *desc;
+	char *text;
+	size_t size;
+	uint32_t seqno;
 };
 
 int archive_init(struct cmd_context *cmd, const char *dir,
@@ -70,6 +100,7 @@ void archive_exit(struct cmd_context *cmd)
 {
 	if (!cmd->archive_params)
 		return;
+	backup_flush(cmd, NULL);
 	free(cmd->archive_params->dir);
 	memset(cmd->archive_params, 0, sizeof(*cmd->archive_params));
 }
@@ -98,6 +129,166 @@ static char *_build_desc(struct dm_pool *mem, const char *line, int before)
 	return buffer;
 }
 
+static int _deferring(struct cmd_context *cmd)
+{
+	return cmd->backup_params->deferred && cmd->backup_params->enabled &&
+		cmd->backup_params->dir;
+}
+
+static int _pending_path(struct cmd_context *cmd, const char *vg_name,
+			 char *path, size_t size)
+{
+	if (dm_snprintf(path, size, "%s/%s" PENDING_BACKUP_SUFFIX,
+			cmd->backup_params->dir, vg_name) < 0) {
+		log_error("Failed to generate pending backup marker name.");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Returns a descriptor holding the lock on the pending backup marker,
+ * or -1.  Without 'create' a marker that does not exist or is removed
+ * while waiting for the lock is not recreated.
+ */
+static int _lock_pending(const char *path, int create)
+{
+	struct stat buf1, buf2;
+	int fd;
+
+	for (;;) {
+		if ((fd = open(path, O_RDWR | (create ? O_CREAT : 0), 0600)) < 0) {
+			if (create || (errno != ENOENT))
+				log_sys_debug("open", path);
+			return -1;
+		}
+
+		if (flock(fd, LOCK_EX)) {
+			log_sys_debug("flock", path);
+			break;
+		}
+
+		if (!stat(path, &buf1) && !fstat(fd, &buf2) &&
+		    is_same_inode(buf1, buf2))
+			return fd;
+
+		/* Removed by a concurrent backup_flush() */
+		if (!create)
+			break;
+
+		if (close(fd))
+			log_sys_debug("close", path);
+	}
+
+	if (close(fd))
+		log_sys_debug("close", path);
+
+	return -1;
+}
+
+static void _unlock_pending(int fd, const char *path)
+{
+	if (close(fd))
+		log_sys_debug("close", path);
+}
+
+static int _read_pending(int fd, uint32_t *seqno)
+{
+	char buf[16];
+	ssize_t n;
+
+	if ((n = pread(fd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return 0;
+
+	buf[n] = '\0';
+
+	return sscanf(buf, "%u", seqno) == 1;
+}
+
+static int _mark_pending(struct cmd_context *cmd, const char *vg_name,
+			 uint32_t seqno)
+{
+	char path[PATH_MAX], buf[16];
+	int fd, len, r = 0;
+
+	if (!_pending_path(cmd, vg_name, path, sizeof(path)) ||
+	    ((fd = _lock_pending(path, 1)) < 0))
+		return_0;
+
+	if (((len = dm_snprintf(buf, sizeof(buf), "%u\n", seqno)) < 0) ||
+	    ftruncate(fd, 0) || (pwrite(fd, buf, len, 0) != len))
+		log_sys_error("write", path);
+	else
+		r = 1;
+
+	_unlock_pending(fd, path);
+
+	return r;
+}
+
+static void _free_pending(struct pending_backup *pb)
+{
+	dm_list_del(&pb->list);
+	free(pb->vgname);
+	free(pb->desc);
+	free(pb->text);
+	free(pb);
+}
+
+/*
+ * Export the metadata exactly as backup_to_file() would write it,
+ * mark the backup pending and queue it for backup_flush().
+ */
+static int _defer(struct volume_group *vg, const char *desc)
+{
+	struct pending_backup *pb;
+	FILE *fp;
+
+	if (!(pb = zalloc(sizeof(*pb))) ||
+	    !(pb->vgname = strdup(vg->name)) ||
+	    !(pb->desc = strdup(desc))) {
+		log_error("Failed to allocate deferred backup.");
+		goto bad;
+	}
+
+	pb->seqno = vg->seqno;
+
+	if (!(fp = open_memstream(&pb->text, &pb->size))) {
+		log_sys_error("open_memstream", vg->name);
+		goto bad;
+	}
+
+	if (!text_vg_export_file(vg, desc, fp)) {
+		(void) fclose(fp);
+		goto_bad;
+	}
+
+	if (fclose(fp)) {
+		log_sys_error("fclose", vg->name);
+		goto bad;
+	}
+
+	if (!_mark_pending(vg->cmd, vg->name, vg->seqno))
+		goto_bad;
+
+	dm_list_add(&vg->cmd->backup_params->pending, &pb->list);
+
+	log_debug_metadata("Deferred backup of volume group %s metadata (seqno %u).",
+			   vg->name, vg->seqno);
+
+	return 1;
+bad:
+	if (pb) {
+		free(pb->vgname);
+		free(pb->desc);
+		free(pb->text);
+		free(pb);
+	}
+
+	return 0;
+}
+
 static int _archive(struct volume_group *vg, int compulsory)
 {
 	char *desc;
@@ -178,7 +369,7 @@ int archive_display_file(struct cmd_context *cmd, const char *file)
 }
 
 int backup_init(struct cmd_context *cmd, const char *dir,
-		int enabled)
+		int enabled, int deferred)
 {
 	backup_exit(cmd);
 
@@ -189,6 +380,7 @@ int backup_init(struct cmd_context *cmd, const char *dir,
 	}
 
 	cmd->backup_params->dir = NULL;
+	dm_list_init(&cmd->backup_params->pending);
 	if (!*dir)
 		return 1;
 
@@ -197,6 +389,7 @@ int backup_init(struct cmd_context *cmd, const char *dir,
 		return 0;
 	}
 	backup_enable(cmd, enabled);
+	cmd->backup_params->deferred = deferred;
 
 	return 1;
 }
@@ -205,6 +398,7 @@ void backup_exit(struct cmd_context *cmd)
 {
 	if (!cmd->backup_params)
 		return;
+	backup_flush(cmd, NULL);
 	free(cmd->backup_params->dir);
 	memset(cmd->backup_params, 0, sizeof(*cmd->backup_params));
 }
@@ -216,12 +410,16 @@ void backup_enable(struct cmd_context *cmd, int flag)
 
 static int _backup(struct volume_group *vg)
 {
-	char name[PATH_MAX];
+	char name[PATH_MAX], pending[PATH_MAX];
 	char *desc;
+	int fd, r;
 
 	if (!(desc = _build_desc(vg->cmd->mem, vg->cmd->cmd_line, 0)))
 		return_0;
 
+	if (_deferring(vg->cmd) && _defer(vg, desc))
+		return 1;
+
 	if (dm_snprintf(name, sizeof(name), "%s/%s",
 			 vg->cmd->backup_params->dir, vg->name) < 0) {
 		log_error("Failed to generate volume group metadata backup "
@@ -229,7 +427,156 @@ static int _backup(struct volume_group *vg)
 		return 0;
 	}
 
-	return backup_to_file(name, desc, vg);
+	/* Keep a deferred backup of older metadata from replacing this one */
+	if (!_pending_path(vg->cmd, vg->name, pending, sizeof(pending)))
+		return_0;
+
+	fd = _lock_pending(pending, 0);
+
+	if ((r = backup_to_file(name, desc, vg)) && (fd >= 0) && unlink(pending))
+		log_sys_debug("unlink", pending);
+
+	if (fd >= 0)
+		_unlock_pending(fd, pending);
+
+	return r;
+}
+
+static int _write_backup_temp(struct cmd_context *cmd,
+			      const struct pending_backup *pb,
+			      char *temp_file, size_t len)
+{
+	size_t done = 0;
+	ssize_t n;
+	int fd;
+
+	if (!create_temp_name(cmd->backup_params->dir, temp_file, len, &fd,
+			      &cmd->rand_seed)) {
+		log_error("Couldn't create temporary backup name.");
+		return 0;
+	}
+
+	while (done < pb->size) {
+		if ((n = write(fd, pb->text + done, pb->size - done)) < 0) {
+			if (errno == EINTR)
+				continue;
+			log_sys_error("write", temp_file);
+			goto bad;
+		}
+		done += n;
+	}
+
+	if (fsync(fd) && (errno != EROFS) && (errno != EINVAL)) {
+		log_sys_error("fsync", temp_file);
+		goto bad;
+	}
+
+	if (close(fd)) {
+		log_sys_error("close", temp_file);
+		fd = -1;
+		goto bad;
+	}
+
+	return 1;
+bad:
+	if ((fd >= 0) && close(fd))
+		log_sys_debug("close", temp_file);
+	if (unlink(temp_file))
+		log_sys_debug("unlink", temp_file);
+
+	return 0;
+}
+
+/*
+ * Write out the newest backup deferred for one VG, unless a newer one
+ * is pending from another command.
+ */
+static void _flush_vg(struct cmd_context *cmd, struct dm_list *pending)
+{
+	struct pending_backup *latest;
+	const char *vgname = dm_list_item(dm_list_first(pending), struct pending_backup)->vgname;
+	char path[PATH_MAX], marker[PATH_MAX], temp_file[PATH_MAX];
+	int fd, have_temp = 0, written = 0, marked;
+	uint32_t seqno;
+
+	latest = dm_list_item(dm_list_last(pending), struct pending_backup);
+
+	if (!_pending_path(cmd, vgname, marker, sizeof(marker)) ||
+	    (dm_snprintf(path, sizeof(path), "%s/%s",
+			 cmd->backup_params->dir, vgname) < 0)) {
+		log_warn("WARNING: Failed to write deferred backups of volume group %s.",
+			 vgname);
+		return;
+	}
+
+	/* The expensive part is done before taking the marker lock */
+	have_temp = _write_backup_temp(cmd, latest, temp_file, sizeof(temp_file));
+
+	if ((fd = _lock_pending(marker, 1)) < 0)
+		log_warn("WARNING: Failed to lock pending backup marker %s.", marker);
+
+	if (fd < 0) {
+		if (have_temp && unlink(temp_file))
+			log_sys_debug("unlink", temp_file);
+		return;
+	}
+
+	marked = _read_pending(fd, &seqno);
+
+	if (have_temp) {
+		if (marked && (seqno == latest->seqno)) {
+			log_verbose("Creating volume group backup \"%s\" (seqno %u).",
+				    path, latest->seqno);
+			if (rename(temp_file, path))
+				log_sys_error("rename", path);
+			else
+				written = 1;
+		} else
+			log_debug_metadata("Skipping backup of volume group %s seqno %u "
+					   "superseded by another command.",
+					   vgname, latest->seqno);
+		if (!written && unlink(temp_file))
+			log_sys_debug("unlink", temp_file);
+	} else
+		log_warn("WARNING: Backup of volume group %s metadata failed.", vgname);
+
+	/* Keep the marker while a backup is still missing */
+	if ((!marked || written) && unlink(marker))
+		log_sys_debug("unlink", marker);
+
+	_unlock_pending(fd, marker);
+}
+
+void backup_flush(struct cmd_context *cmd, const char *vg_name)
+{
+	struct pending_backup *pb, *tpb;
+	struct dm_list vg_pending;
+	const char *vgname;
+
+	if (!cmd->backup_params || dm_list_empty(&cmd->backup_params->pending))
+		return;
+
+	while (!dm_list_empty(&cmd->backup_params->pending)) {
+		vgname = NULL;
+		dm_list_iterate_items(pb, &cmd->backup_params->pending)
+			if (!vg_name || !strcmp(pb->vgname, vg_name)) {
+				vgname = pb->vgname;
+				break;
+			}
+		if (!vgname)
+			break;
+
+		dm_list_init(&vg_pending);
+		dm_list_iterate_items_safe(pb, tpb, &cmd->backup_params->pending)
+			if (!strcmp(pb->vgname, vgname))
+				dm_list_move(&vg_pending, &pb->list);
+
+		if (cmd->backup_params->dir)
+			_flush_vg(cmd, &vg_pending);
+
+		dm_list_iterate_items_safe(pb, tpb, &vg_pending)
+			_free_pending(pb);
+	}
 }
 
 int backup_locally(struct volume_group *vg)
@@ -279,7 +626,9 @@ int backup(struct volume_group *vg)
 
 int backup_remove(struct cmd_context *cmd, const char *vg_name)
 {
-	char path[PATH_MAX];
+	struct pending_backup *pb, *tpb;
+	char path[PATH_MAX], pending[PATH_MAX];
+	int fd;
 
 	if (dm_snprintf(path, sizeof(path), "%s/%s",
 			 cmd->backup_params->dir, vg_name) < 0) {
@@ -287,12 +636,27 @@ int backup_remove(struct cmd_context *cmd, const char *vg_name)
 		return 0;
 	}
 
+	dm_list_iterate_items_safe(pb, tpb, &cmd->backup_params->pending)
+		if (!strcmp(pb->vgname, vg_name))
+			_free_pending(pb);
+
+	if (!_pending_path(cmd, vg_name, pending, sizeof(pending)))
+		return_0;
+
+	fd = _lock_pending(pending, 0);
+
 	/*
 	 * Let this fail silently.
 	 */
 	if (unlink(path))
 		log_sys_debug("unlink", path);
 
+	if (fd >= 0) {
+		if (unlink(pending))
+			log_sys_debug("unlink", pending);
+		_unlock_pending(fd, pending);
+	}
+
 	return 1;
 }
 
@@ -599,6 +963,30 @@ int backup_to_file(const char *file, const char *desc, struct volume_group *vg)
 	return r;
 }
 
+/*
+ * Remove a marker left behind by an interrupted command once the backup
+ * is known to be current.
+ */
+static void _clear_pending(struct volume_group *vg)
+{
+	char pending[PATH_MAX];
+	uint32_t seqno;
+	int fd;
+
+	if (!_pending_path(vg->cmd, vg->name, pending, sizeof(pending)) ||
+	    ((fd = _lock_pending(pending, 0)) < 0))
+		return;
+
+	if (_read_pending(fd, &seqno) && (seqno <= vg->seqno)) {
+		log_debug_metadata("Removing pending backup marker %s (seqno %u).",
+				   pending, seqno);
+		if (unlink(pending))
+			log_sys_debug("unlink", pending);
+	}
+
+	_unlock_pending(fd, pending);
+}
+
 /*
  * Update backup (and archive) if they're out-of-date or don't exist.
  *
@@ -633,6 +1021,7 @@ void check_current_backup(struct volume_group *vg)
 	    (id_equal(&vg->id, &vg_backup->id))) {
 		log_suppress(old_suppress);
 		release_vg(vg_backup);
+		_clear_pending(vg);
 		return;
 	}
 	log_suppress(old_suppress);
@@ -29,6 +29,8 @@
  * configuration.  As such it should be taken just after the
  * volume group is changed.  Only 1 backup file will exist.
  * Typically backups will be stored in /etc/lvm/backups.
+ *
+ * With backup/deferred, the backup is written once the VG is unlocked.
  */
 
 int archive_init(struct cmd_context *cmd, const char *dir,
@@ -41,7 +43,8 @@ int archive(struct volume_group *vg);
 int archive_display(struct cmd_context *cmd, const char *vg_name);
 int archive_display_file(struct cmd_context *cmd, const char *file);
 
-int backup_init(struct cmd_context *cmd, const char *dir, int enabled);
+int backup_init(struct cmd_context *cmd, const char *dir, int enabled,
+		int deferred);
 void backup_exit(struct cmd_context *cmd);
 
 void backup_enable(struct cmd_context *cmd, int flag);
@@ -49,6 +52,12 @@ int backup(struct volume_group *vg);
 int backup_locally(struct volume_group *vg);
 int backup_remove(struct cmd_context *cmd, const char *vg_name);
 
+/*
+ * Write archives and backups deferred while the VG was locked,
+ * for all VGs if vg_name is NULL.
+ */
+void backup_flush(struct cmd_context *cmd, const char *vg_name);
+
 struct volume_group *backup_read_vg(struct cmd_context *cmd,
 				    const char *vg_name, const char *file);
 
@@ -838,7 +838,10 @@ int label_scan(struct cmd_context *cmd)
 	 * on it.  This info will be used by the vg_read() phase of the
 	 * command.
 	 */
-	dev_cache_scan();
+	if (dev_cache_is_current())
+		log_debug_devs("Using current list of system devices.");
+	else
+		dev_cache_scan();
 
 	if (!(iter = dev_iter_create(cmd->full_filter, 0))) {
 		log_error("Scanning failed to get devices.");
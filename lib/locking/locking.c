@@ -22,6 +22,7 @@
 #include "lib/mm/memlock.h"
 #include "lib/config/defaults.h"
 #include "lib/cache/lvmcache.h"
+#include "lib/format_text/archiver.h"
 #include "lib/misc/lvm-signal.h"
 
 #include <assert.h>
@@ -39,6 +40,23 @@ static int _file_locking_sysinit = 0;
 static int _file_locking_ignorefail = 0;
 static int _file_locking_failed = 0;
 
+/* VG unlocks waiting for udev, see defer_unlock_vg() */
+#define DEFERRED_UNLOCKS_MAX 64
+static DM_LIST_INIT(_deferred_unlocks);
+static unsigned _deferred_unlock_count = 0;
+
+/* Taking vol while the deferred VG locks are held would break lock order */
+static int _deferred_unlocks_before(const char *vol)
+{
+	struct dm_str_list *sl;
+
+	dm_list_iterate_items(sl, &_deferred_unlocks)
+		if (strcmp(sl->str, vol) >= 0)
+			return 0;
+
+	return 1;
+}
+
 static void _unblock_signals(void)
 {
 	/* Don't unblock signals while any locks are held */
@@ -136,6 +154,7 @@ int init_locking(struct cmd_context *cmd,
 	_file_locking_readonly = file_locking_readonly;
 	_file_locking_sysinit = file_locking_sysinit;
 	_file_locking_ignorefail = file_locking_ignorefail;
+	_file_locking_failed = 0;
 
 	log_debug("File locking settings: readonly:%d sysinit:%d ignorelockingfailure:%d global/metadata_read_only:%d global/wait_for_locks:%d.",
 		  _file_locking_readonly, _file_locking_sysinit, _file_locking_ignorefail,
@@ -157,11 +176,30 @@ int init_locking(struct cmd_context *cmd,
 
 void fin_locking(void)
 {
+	struct dm_str_list *sl, *tsl;
+
+	/* Dropped with all other locks */
+	dm_list_iterate_items_safe(sl, tsl, &_deferred_unlocks) {
+		dm_list_del(&sl->list);
+		free(sl);
+	}
+	_deferred_unlock_count = 0;
+
 	/* file locking disabled */
 	if (!_locking.flags)
 		return;
 
 	_locking.fin_locking();
+	_locking.flags = 0;
+}
+
+/*
+ * Does the command take real file locks and may it take write locks?
+ * Not with --nolocking, --readonly, or when file locking failed.
+ */
+int file_locking_writable(void)
+{
+	return _locking.flags && !_file_locking_readonly && !_file_locking_failed;
 }
 
 /*
@@ -197,6 +235,10 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 		return 0;
 	}
 
+	if ((lck_type != LCK_UNLOCK) && _deferred_unlock_count && is_real_vg(resource) &&
+	    !_deferred_unlocks_before(resource) && !sync_local_dev_names(cmd))
+		stack;
+
 	/*
 	 * File locking is disabled by --nolocking.
 	 */
@@ -276,6 +318,11 @@ out_hold:
 
 	/* FIXME: we shouldn't need to keep track of this either. */
 	_update_vg_lock_count(resource, flags);
+
+	/* Write the archives and backup deferred while the VG was locked */
+	if ((lck_type == LCK_UNLOCK) && is_real_vg(resource))
+		backup_flush(cmd, resource);
+
 	return 1;
 
 out_fail:
@@ -311,10 +358,53 @@ int vg_write_lock_held(void)
 	return _vg_write_lock_held;
 }
 
+static void _release_deferred_unlocks(struct cmd_context *cmd)
+{
+	struct dm_str_list *sl, *tsl;
+
+	dm_list_iterate_items_safe(sl, tsl, &_deferred_unlocks) {
+		dm_list_del(&sl->list);
+		_deferred_unlock_count--;
+		if (!lock_vol(cmd, sl->str, LCK_VG_UNLOCK, NULL))
+			stack;
+		free(sl);
+	}
+}
+
 int sync_local_dev_names(struct cmd_context* cmd)
 {
 	memlock_unlock(cmd);
 	fs_unlock();
+	_release_deferred_unlocks(cmd);
+	return 1;
+}
+
+/*
+ * With cmd->defer_dev_sync, a VG is not unlocked until udev has finished
+ * with its devices, but the command goes on with the next VG while udev
+ * works.  sync_local_dev_names() waits for udev and then releases the VG
+ * locks.  Returns 0 when the VG has to be unlocked the usual way.
+ */
+int defer_unlock_vg(struct cmd_context *cmd, const char *vol)
+{
+	struct dm_str_list *sl;
+	size_t len = strlen(vol) + 1;
+
+	if (!cmd->defer_dev_sync || (_deferred_unlock_count >= DEFERRED_UNLOCKS_MAX) ||
+	    !_deferred_unlocks_before(vol) ||
+	    !(sl = malloc(sizeof(*sl) + len)))
+		return 0;
+
+	memcpy(sl + 1, vol, len);
+	sl->str = (const char *) (sl + 1);
+	dm_list_add(&_deferred_unlocks, &sl->list);
+	_deferred_unlock_count++;
+
+	memlock_unlock(cmd);
+	fs_unlock_deferred();
+
+	log_debug_locking("Deferring unlock of VG %s until udev has processed its devices.", vol);
+
 	return 1;
 }
 
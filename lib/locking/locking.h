@@ -25,6 +25,7 @@ int init_locking(struct cmd_context *cmd, int file_locking_sysinit, int file_loc
 void fin_locking(void);
 void reset_locking(void);
 int vg_write_lock_held(void);
+int file_locking_writable(void);
 
 /*
  *   Lock/unlock on-disk volume group data.
@@ -60,6 +61,8 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 
 #define unlock_vg(cmd, vg, vol)	\
 	do { \
+		if (is_real_vg(vol) && defer_unlock_vg(cmd, vol)) \
+			break; \
 		if (is_real_vg(vol) && !sync_local_dev_names(cmd)) \
 			stack; \
 		if (!lock_vol(cmd, vol, LCK_VG_UNLOCK, NULL)) \
@@ -72,6 +75,7 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 	} while (0)
 
 int sync_local_dev_names(struct cmd_context* cmd);
+int defer_unlock_vg(struct cmd_context *cmd, const char *vol);
 
 /* Process list of LVs */
 struct volume_group;
@@ -23,6 +23,23 @@ static int _use_lvmlockd = 0;         /* is 1 if command is configured to use lv
 static int _lvmlockd_connected = 0;   /* is 1 if command is connected to lvmlockd */
 static int _lvmlockd_init_failed = 0; /* used to suppress further warnings */
 
+/*
+ * LV locks acquired ahead of time by lockd_lv_batch(), indexed by LV uuid.
+ * lockd_lv_name() finds these instead of sending a request per LV.
+ */
+struct lockd_lv_batched {
+	struct dm_list list;
+	struct logical_volume *lv;
+	const char *mode;
+	char uuid[64];
+	unsigned locked:1;	/* the lock is held */
+	unsigned acquired:1;	/* the lock was not held before the batch */
+	unsigned used:1;	/* lockd_lv_name() requested the lock */
+};
+
+static struct dm_hash_table *_lv_batch_hash = NULL;
+static struct dm_list _lv_batch_list;
+
 void lvmlockd_set_socket(const char *sock)
 {
 	_lvmlockd_socket = sock;
@@ -2027,6 +2044,29 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 	if (flags & LDLV_PERSISTENT)
 		opts = "persistent";
 
+	if (_lv_batch_hash && (flags & LDLV_PERSISTENT)) {
+		struct lockd_lv_batched *lvb = dm_hash_lookup(_lv_batch_hash, lv_uuid);
+
+		if (lvb && lvb->locked && !strcmp(lvb->mode, mode)) {
+			log_debug("lockd LV %s/%s mode %s uuid %s from batch", vg->name, lv_name, mode, lv_uuid);
+			lvb->used = 1;
+			return 1;
+		}
+
+		/*
+		 * The lock is released or changes mode below, so the batch
+		 * no longer holds it: later requests must go to lvmlockd and
+		 * lockd_lv_batch_release() must not unlock it again.
+		 */
+		if (lvb) {
+			lvb->locked = 0;
+			if (!strcmp(mode, "un"))
+				lvb->acquired = 0;
+			else
+				lvb->used = 1;
+		}
+	}
+
  retry:
 	log_debug("lockd LV %s/%s mode %s uuid %s", vg->name, lv_name, mode, lv_uuid);
 
@@ -2234,6 +2274,243 @@ int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 			     lv->lock_args, def_mode, flags);
 }
 
+/*
+ * The LV holding the lock that lockd_lv() would acquire for lv,
+ * or NULL if that lock is not a plain request for the LV's own
+ * lock (or thin pool lock) in the given mode.
+ */
+static struct logical_volume *_lockd_lv_batch_target(struct logical_volume *lv, const char *mode)
+{
+	int no_sh = 0;
+
+	if (lv_is_thin_volume(lv)) {
+		lv = first_seg(lv) ? first_seg(lv)->pool_lv : NULL;
+		no_sh = 1;
+	} else if (lv_is_thin_pool(lv)) {
+		no_sh = 1;
+	} else if (lv_is_thin_type(lv) || lv_is_mirror_type(lv)) {
+		return NULL;
+	} else if (lv_is_external_origin(lv) ||
+		   lv_is_raid_type(lv) ||
+		   lv_is_cache_type(lv)) {
+		no_sh = 1;
+	}
+
+	if (!lv || !lv->lock_args)
+		return NULL;
+
+	if (no_sh && !strcmp(mode, "sh"))
+		return NULL;
+
+	return lv;
+}
+
+static int _lockd_lv_batch_send(struct cmd_context *cmd, struct volume_group *vg,
+				struct lockd_lv_batched **lvbs, int count,
+				const char *mode)
+{
+	const char *cmd_name = get_cmd_name();
+	struct lockd_lv_batched *lvb;
+	daemon_request req;
+	daemon_reply reply;
+	char key[32];
+	int reply_count;
+	int result;
+	int i, r = 0;
+
+	if (!cmd_name || !cmd_name[0])
+		cmd_name = "none";
+
+	/*
+	 * The first LV uses the fields of a single lock_lv request, so
+	 * an lvmlockd without batch support still locks that one, and
+	 * replies without lv_count.
+	 */
+	req = daemon_request_make("lock_lv");
+
+	if (!daemon_request_extend(req,
+				   "cmd = %s", cmd_name,
+				   "pid = " FMTd64, (int64_t) getpid(),
+				   "mode = %s", mode,
+				   "opts = %s", "persistent",
+				   "vg_name = %s", vg->name,
+				   "lv_name = %s", lvbs[0]->lv->name,
+				   "lv_uuid = %s", lvbs[0]->uuid,
+				   "vg_lock_type = %s", vg->lock_type ?: "none",
+				   "vg_lock_args = %s", vg->lock_args ?: "none",
+				   "lv_lock_args = %s", lvbs[0]->lv->lock_args ?: "none",
+				   "lv_count = " FMTd64, (int64_t) count,
+				   NULL))
+		goto_out;
+
+	for (i = 1; i < count; i++) {
+		lvb = lvbs[i];
+
+		if ((dm_snprintf(key, sizeof(key), "lv_name_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lvb->lv->name, NULL))
+			goto_out;
+
+		if ((dm_snprintf(key, sizeof(key), "lv_uuid_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lvb->uuid, NULL))
+			goto_out;
+
+		if ((dm_snprintf(key, sizeof(key), "lv_lock_args_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lvb->lv->lock_args ?: "none", NULL))
+			goto_out;
+	}
+
+	log_debug("lockd LV batch of %d in %s mode %s", count, vg->name, mode);
+
+	reply = daemon_send(_lvmlockd, req);
+
+	if (!_lockd_result(reply, &result, NULL)) {
+		daemon_reply_destroy(reply);
+		goto out;
+	}
+
+	if ((reply_count = daemon_reply_int(reply, "lv_count", 0)) != count) {
+		/* Only the first LV was locked. */
+		log_debug("lockd LV batch not supported, result %d", result);
+		count = 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		lvb = lvbs[i];
+
+		if (reply_count == count) {
+			if (dm_snprintf(key, sizeof(key), "op_result_%d", i) < 0)
+				continue;
+			result = daemon_reply_int(reply, key, NO_LOCKD_RESULT);
+		}
+
+		/*
+		 * Failures are left to lockd_lv_name() which repeats the
+		 * request for the LV and reports the specific error.
+		 */
+		if (!result)
+			lvb->locked = lvb->acquired = 1;
+		else if (result == -EALREADY)
+			lvb->locked = 1;
+		else
+			log_debug("lockd LV %s/%s batch result %d", vg->name, lvb->lv->name, result);
+	}
+
+	daemon_reply_destroy(reply);
+	r = 1;
+out:
+	daemon_request_destroy(req);
+
+	return r;
+}
+
+/*
+ * Acquire the LV locks for a list of LVs (struct lv_list) in one
+ * request to lvmlockd.  The following lockd_lv() calls for these
+ * LVs are satisfied from the result without another request.
+ * LV locks that were acquired here, but not used by a following
+ * lockd_lv(), are released by lockd_lv_batch_release().
+ *
+ * Returns 0 if no batch request could be made, in which case each
+ * lockd_lv() makes its own request as usual.
+ */
+int lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+		   struct dm_list *lvs, const char *def_mode, uint32_t flags)
+{
+	struct lockd_lv_batched *lvbs[LVMLOCKD_LV_BATCH_MAX];
+	struct lockd_lv_batched *lvb;
+	struct logical_volume *lv;
+	struct lv_list *lvl;
+	const char *mode = def_mode ? : "ex";
+	char lv_uuid[64] __attribute__((aligned(8)));
+	int count = 0;
+
+	if (!vg_is_shared(vg) || !(flags & LDLV_PERSISTENT))
+		return 0;
+
+	if (cmd->metadata_read_only || cmd->lockd_lv_disable)
+		return 0;
+
+	if (!_use_lvmlockd || !_lvmlockd_connected)
+		return 0;
+
+	if (strcmp(mode, "ex") && strcmp(mode, "sh"))
+		return 0;
+
+	if (!_lv_batch_hash) {
+		if (!(_lv_batch_hash = dm_hash_create(128)))
+			return_0;
+		dm_list_init(&_lv_batch_list);
+	}
+
+	dm_list_iterate_items(lvl, lvs) {
+		if (!(lv = _lockd_lv_batch_target(lvl->lv, mode)))
+			continue;
+
+		if (!id_write_format(&lv->lvid.id[1], lv_uuid, sizeof(lv_uuid)))
+			continue;
+
+		/* Thin LVs in one pool share the pool lock. */
+		if (dm_hash_lookup(_lv_batch_hash, lv_uuid))
+			continue;
+
+		if (!(lvb = dm_pool_zalloc(cmd->mem, sizeof(*lvb))))
+			return_0;
+
+		lvb->lv = lv;
+		lvb->mode = mode;
+		memcpy(lvb->uuid, lv_uuid, sizeof(lvb->uuid));
+
+		if (!dm_hash_insert(_lv_batch_hash, lvb->uuid, lvb))
+			return_0;
+
+		dm_list_add(&_lv_batch_list, &lvb->list);
+
+		lvbs[count++] = lvb;
+
+		if (count == LVMLOCKD_LV_BATCH_MAX) {
+			if (!_lockd_lv_batch_send(cmd, vg, lvbs, count, mode))
+				return_0;
+			count = 0;
+		}
+	}
+
+	if (count && !_lockd_lv_batch_send(cmd, vg, lvbs, count, mode))
+		return_0;
+
+	return 1;
+}
+
+/*
+ * Unlock LVs locked by lockd_lv_batch() that no lockd_lv() asked for,
+ * e.g. because activation stopped early, and forget the batch.
+ */
+void lockd_lv_batch_release(struct cmd_context *cmd)
+{
+	struct dm_hash_table *hash = _lv_batch_hash;
+	struct lockd_lv_batched *lvb;
+	struct logical_volume *lv;
+
+	if (!hash)
+		return;
+
+	_lv_batch_hash = NULL;
+
+	dm_list_iterate_items(lvb, &_lv_batch_list) {
+		if (!lvb->acquired || lvb->used)
+			continue;
+
+		lv = lvb->lv;
+
+		log_debug("lockd LV %s/%s unused from batch", lv->vg->name, lv->name);
+
+		if (!lockd_lv_name(cmd, lv->vg, lv->name, &lv->lvid.id[1],
+				   lv->lock_args, "un", LDLV_PERSISTENT))
+			log_error("Failed to unlock logical volume %s.", display_lvname(lv));
+	}
+
+	dm_hash_destroy(hash);
+}
+
 static int _init_lv_sanlock(struct cmd_context *cmd, struct volume_group *vg,
 			    const char *lv_name, struct id *lv_id,
 			    const char **lock_args_ret)
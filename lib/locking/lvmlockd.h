@@ -80,6 +80,9 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 		  const char *lock_args, const char *def_mode, uint32_t flags);
 int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags);
+int lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+		   struct dm_list *lvs, const char *def_mode, uint32_t flags);
+void lockd_lv_batch_release(struct cmd_context *cmd);
 
 /* lvcreate/lvremove use init/free */
 
@@ -206,6 +209,16 @@ static inline int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	return 1;
 }
 
+static inline int lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+		   struct dm_list *lvs, const char *def_mode, uint32_t flags)
+{
+	return 0;
+}
+
+static inline void lockd_lv_batch_release(struct cmd_context *cmd)
+{
+}
+
 static inline int lockd_init_lv(struct cmd_context *cmd, struct volume_group *vg,
 		  	struct logical_volume *lv, struct lvcreate_params *lp)
 {
@@ -208,6 +208,120 @@ char *lvseg_seg_metadata_le_ranges_str(struct dm_pool *mem, const struct lv_segm
 	return str_list_to_str(mem, list, seg->lv->vg->cmd->report_list_item_separator);
 }
 
+struct extent_heat {
+	uint64_t ios;
+	uint32_t le;
+};
+
+static int _extent_heat_cmp_hot(const void *a, const void *b)
+{
+	const struct extent_heat *ha = a, *hb = b;
+
+	if (ha->ios != hb->ios)
+		return (ha->ios < hb->ios) ? 1 : -1;
+
+	return (ha->le < hb->le) ? -1 : (ha->le > hb->le);
+}
+
+static int _extent_heat_cmp_cold(const void *a, const void *b)
+{
+	const struct extent_heat *ha = a, *hb = b;
+
+	if (ha->ios != hb->ios)
+		return (ha->ios > hb->ios) ? 1 : -1;
+
+	return (ha->le < hb->le) ? -1 : (ha->le > hb->le);
+}
+
+/*
+ * Add the PV extents holding logical extent le of lv to result as
+ * "pv_name:pe". Each stripe of a striped segment and each image of
+ * a mirrored one is listed; other segment types are skipped.
+ */
+static int _lv_le_pes(struct dm_pool *mem, const struct logical_volume *lv,
+		      uint32_t le, struct dm_list *result)
+{
+	struct lv_segment *seg;
+	uint32_t area_offset;
+	unsigned s;
+	char *item;
+
+	if (!(seg = find_seg_by_le(lv, le)))
+		return 1;
+
+	if (seg_is_striped(seg))
+		area_offset = (le - seg->le) / seg->area_count;
+	else if (seg_is_mirrored(seg))
+		area_offset = le - seg->le;
+	else
+		return 1;
+
+	for (s = 0; s < seg->area_count; s++) {
+		switch (seg_type(seg, s)) {
+		case AREA_PV:
+			if (!(item = dm_pool_alloc(mem, strlen(dev_name(seg_dev(seg, s))) + 12)))
+				return_0;
+			sprintf(item, "%s:%" PRIu32, dev_name(seg_dev(seg, s)),
+				seg_pe(seg, s) + area_offset);
+			if (!str_list_add_no_dup_check(mem, result, item))
+				return_0;
+			break;
+		case AREA_LV:
+			if (!_lv_le_pes(mem, seg_lv(seg, s), seg_le(seg, s) + area_offset, result))
+				return_0;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * List the PV extents of the count logical extents of lv with the most
+ * (hottest) or least I/O since extent heat tracking was started. The
+ * list is empty if the LV is inactive or is not tracked.
+ */
+struct dm_list *lv_extent_heat_pes(struct dm_pool *mem, const struct logical_volume *lv,
+				   int hottest, uint32_t count)
+{
+	struct dm_list *result;
+	struct extent_heat *heat;
+	uint64_t *ios;
+	uint32_t le;
+
+	if (!(result = str_list_create(mem)))
+		return_NULL;
+
+	if (!lv->le_count || !count)
+		return result;
+
+	if (!(ios = dm_pool_alloc(mem, sizeof(*ios) * lv->le_count)) ||
+	    !(heat = dm_pool_alloc(mem, sizeof(*heat) * lv->le_count)))
+		return_NULL;
+
+	if (!lv_extent_heat(lv, ios))
+		return result;
+
+	for (le = 0; le < lv->le_count; le++) {
+		heat[le].ios = ios[le];
+		heat[le].le = le;
+	}
+
+	qsort(heat, lv->le_count, sizeof(*heat),
+	      hottest ? _extent_heat_cmp_hot : _extent_heat_cmp_cold);
+
+	if (count > lv->le_count)
+		count = lv->le_count;
+
+	for (le = 0; le < count; le++)
+		if (!_lv_le_pes(mem, lv, heat[le].le, result))
+			return_NULL;
+
+	return result;
+}
+
 char *lvseg_tags_dup(const struct lv_segment *seg)
 {
 	return tags_format_and_copy(seg->lv->vg->vgmem, &seg->tags);
@@ -142,6 +142,8 @@ struct dm_list *lvseg_seg_le_ranges(struct dm_pool *mem, const struct lv_segment
 char *lvseg_seg_le_ranges_str(struct dm_pool *mem, const struct lv_segment *seg);
 struct dm_list *lvseg_seg_metadata_le_ranges(struct dm_pool *mem, const struct lv_segment *seg);
 char *lvseg_seg_metadata_le_ranges_str(struct dm_pool *mem, const struct lv_segment *seg);
+struct dm_list *lv_extent_heat_pes(struct dm_pool *mem, const struct logical_volume *lv,
+				   int hottest, uint32_t count);
 
 /* LV kernel properties */
 int lv_kernel_major(const struct logical_volume *lv);
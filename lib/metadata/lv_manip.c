@@ -68,10 +68,28 @@ struct alloc_parms {
 /*
  * Holds varying state of each allocation attempt.
  */
+/*
+ * PV segments (and their area index) used by the end of prev_lvseg,
+ * collected once per allocation instead of for every candidate pv_area.
+ */
+struct prev_pv_area {
+	struct pv_segment *pvseg;
+	uint32_t s;
+};
+
+struct prev_pv_areas {
+	struct prev_pv_area *areas;
+	uint32_t count;
+	uint32_t size;
+	unsigned collected;
+};
+
 struct alloc_state {
 	const struct alloc_parms *alloc_parms;
 	struct pv_area_used *areas;
 	uint32_t areas_size;
+	struct prev_pv_areas prev_last_le;	/* Last LE of prev_lvseg */
+	struct prev_pv_areas prev_whole_lv;	/* Whole LV up to end of prev_lvseg (maximise_cling) */
 	uint32_t log_area_count_still_needed;	/* Number of areas still needing to be allocated for the log */
 	uint32_t allocated;	/* Total number of extents allocated so far */
 	uint32_t num_positional_areas;	/* Number of parallel allocations that must be contiguous/cling */
@@ -2484,25 +2502,46 @@ static int _is_condition(struct cmd_context *cmd __attribute__((unused)),
 	return 2;	/* Finished */
 }
 
+static int _collect_prev_pv_area(struct cmd_context *cmd __attribute__((unused)),
+				 struct pv_segment *pvseg, uint32_t s,
+				 void *data)
+{
+	struct prev_pv_areas *prev = data;
+	struct prev_pv_area *areas;
+
+	if (prev->count >= prev->size) {
+		if (!(areas = realloc(prev->areas, sizeof(*areas) * (prev->size ? prev->size * 2 : 8)))) {
+			log_error("Memory reallocation for previous segment areas failed.");
+			return 0;
+		}
+		prev->areas = areas;
+		prev->size = prev->size ? prev->size * 2 : 8;
+	}
+
+	prev->areas[prev->count].pvseg = pvseg;
+	prev->areas[prev->count].s = s;
+	prev->count++;
+
+	return 1;
+}
+
 /*
- * Is pva on same PV as any existing areas?
+ * Return the PV segments used by prev_lvseg->lv between le and le + len,
+ * in the order _for_each_pv visits them.  They do not change while
+ * an allocation is in progress, so walk the LV only the first time.
  */
-static int _check_cling(struct alloc_handle *ah,
-			const struct dm_config_node *cling_tag_list_cn,
-			struct lv_segment *prev_lvseg, struct pv_area *pva,
-			struct alloc_state *alloc_state)
+static struct prev_pv_areas *_get_prev_pv_areas(struct alloc_handle *ah,
+						struct lv_segment *prev_lvseg,
+						struct alloc_state *alloc_state,
+						int whole_lv)
 {
-	struct pv_match pvmatch;
-	int r;
+	struct prev_pv_areas *prev = whole_lv ? &alloc_state->prev_whole_lv : &alloc_state->prev_last_le;
 	uint32_t le, len;
 
-	pvmatch.ah = ah;
-	pvmatch.condition = cling_tag_list_cn ? _has_matching_pv_tag : _is_same_pv;
-	pvmatch.alloc_state = alloc_state;
-	pvmatch.pva = pva;
-	pvmatch.cling_tag_list_cn = cling_tag_list_cn;
+	if (prev->collected)
+		return prev;
 
-	if (ah->maximise_cling) {
+	if (whole_lv) {
 		/* Check entire LV */
 		le = 0;
 		len = prev_lvseg->le + prev_lvseg->len;
@@ -2512,16 +2551,81 @@ static int _check_cling(struct alloc_handle *ah,
 		len = 1;
 	}
 
+	prev->count = 0;
+
 	/* FIXME Cope with stacks by flattening */
-	if (!(r = _for_each_pv(ah->cmd, prev_lvseg->lv, le, len, NULL, NULL,
-			       0, 0, -1, 1,
-			       _is_condition, &pvmatch)))
-		stack;
+	if (!_for_each_pv(ah->cmd, prev_lvseg->lv, le, len, NULL, NULL,
+			  0, 0, -1, 1,
+			  _collect_prev_pv_area, prev))
+		return_NULL;
 
-	if (r != 2)
-		return 0;
+	prev->collected = 1;
 
-	return 1;
+	return prev;
+}
+
+static void _free_prev_pv_areas(struct alloc_state *alloc_state)
+{
+	free(alloc_state->prev_last_le.areas);
+	free(alloc_state->prev_whole_lv.areas);
+}
+
+/*
+ * Does pva satisfy pvmatch against any of the collected PV segments?
+ */
+static int _check_prev_pv_areas(struct alloc_handle *ah, struct pv_match *pvmatch,
+				struct lv_segment *prev_lvseg, int whole_lv)
+{
+	struct prev_pv_areas *prev;
+	uint32_t i;
+	int r;
+
+	if (!(prev = _get_prev_pv_areas(ah, prev_lvseg, pvmatch->alloc_state, whole_lv)))
+		return_0;
+
+	for (i = 0; i < prev->count; i++)
+		if ((r = _is_condition(ah->cmd, prev->areas[i].pvseg, prev->areas[i].s, pvmatch)) != 1)
+			return (r == 2) ? 1 : 0;
+
+	return 0;
+}
+
+/*
+ * Is any PV segment at the end of prev_lvseg on the same PV as pva?
+ */
+static int _prev_lvseg_uses_pv(struct alloc_handle *ah, struct lv_segment *prev_lvseg,
+			       struct pv_area *pva, struct alloc_state *alloc_state)
+{
+	struct prev_pv_areas *prev;
+	uint32_t i;
+
+	if (!(prev = _get_prev_pv_areas(ah, prev_lvseg, alloc_state, 0)))
+		return 1;	/* Let the caller try the next area */
+
+	for (i = 0; i < prev->count; i++)
+		if (prev->areas[i].pvseg->pv == pva->map->pv)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Is pva on same PV as any existing areas?
+ */
+static int _check_cling(struct alloc_handle *ah,
+			const struct dm_config_node *cling_tag_list_cn,
+			struct lv_segment *prev_lvseg, struct pv_area *pva,
+			struct alloc_state *alloc_state)
+{
+	struct pv_match pvmatch;
+
+	pvmatch.ah = ah;
+	pvmatch.condition = cling_tag_list_cn ? _has_matching_pv_tag : _is_same_pv;
+	pvmatch.alloc_state = alloc_state;
+	pvmatch.pva = pva;
+	pvmatch.cling_tag_list_cn = cling_tag_list_cn;
+
+	return _check_prev_pv_areas(ah, &pvmatch, prev_lvseg, ah->maximise_cling);
 }
 
 /*
@@ -2532,7 +2636,6 @@ static int _check_contiguous(struct alloc_handle *ah,
 			     struct alloc_state *alloc_state)
 {
 	struct pv_match pvmatch;
-	int r;
 
 	pvmatch.ah = ah;
 	pvmatch.condition = _is_contiguous;
@@ -2540,17 +2643,7 @@ static int _check_contiguous(struct alloc_handle *ah,
 	pvmatch.pva = pva;
 	pvmatch.cling_tag_list_cn = NULL;
 
-	/* FIXME Cope with stacks by flattening */
-	if (!(r = _for_each_pv(ah->cmd, prev_lvseg->lv,
-			       prev_lvseg->le + prev_lvseg->len - 1, 1, NULL, NULL,
-			       0, 0, -1, 1,
-			       _is_condition, &pvmatch)))
-		stack;
-
-	if (r != 2)
-		return 0;
-
-	return 1;
+	return _check_prev_pv_areas(ah, &pvmatch, prev_lvseg, 0);
 }
 
 /*
@@ -2638,7 +2731,8 @@ static area_use_t _check_pva(struct alloc_handle *ah, struct pv_area *pva, uint3
 
 		/* Try next area on same PV if looking for contiguous space */
 		if (alloc_parms->flags & A_CONTIGUOUS_TO_LVSEG)
-			return NEXT_AREA;
+			return _prev_lvseg_uses_pv(ah, alloc_parms->prev_lvseg, pva, alloc_state) ?
+				NEXT_AREA : NEXT_PV;
 
 		/* Cling to prev_lvseg? */
 		if (((alloc_parms->flags & A_CLING_TO_LVSEG) ||
@@ -2979,7 +3073,11 @@ static int _find_some_parallel_space(struct alloc_handle *ah,
 	if (ix + preferred_count < devices_needed + alloc_state->log_area_count_still_needed)
 		return 1;
 
-	/* Sort the areas so we allocate from the biggest */
+	/*
+	 * Sort the areas so we allocate from the biggest.
+	 * Except with ALLOC_ANYWHERE, each pass over the PVs above adds at
+	 * most one area per PV, so only a few entries are sorted here.
+	 */
 	if (log_iteration_count) {
 		if (ix > devices_needed + 1) {
 			log_debug_alloc("Sorting %u log areas", ix - devices_needed);
@@ -3181,6 +3279,7 @@ static int _allocate(struct alloc_handle *ah,
 	struct alloc_parms alloc_parms;
 	struct alloc_state alloc_state;
 
+	memset(&alloc_state, 0, sizeof(alloc_state));
 	alloc_state.allocated = lv ? lv->le_count : 0;
 
 	if (alloc_state.allocated >= ah->new_extents && !ah->log_area_count) {
@@ -3312,6 +3411,7 @@ static int _allocate(struct alloc_handle *ah,
 
       out:
 	free(alloc_state.areas);
+	_free_prev_pv_areas(&alloc_state);
 	return r;
 }
 
@@ -6087,6 +6187,11 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	struct seg_list *sl;
 	struct lv_segment *seg = first_seg(lv);
 	int is_last_pool = lv_is_pool(lv);
+	/*
+	 * In a shared VG the pool lock is dropped when this LV is removed,
+	 * so the pool is updated before that rather than with the batch.
+	 */
+	int defer_pool_update = cmd->defer_thin_pool_updates && !vg_is_shared(lv->vg);
 
 	vg = lv->vg;
 
@@ -6210,7 +6315,8 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	}
 
 	/* Clear thin pool stacked messages */
-	if (pool_lv && !pool_has_message(first_seg(pool_lv), lv, 0) &&
+	if (pool_lv && !defer_pool_update &&
+	    !pool_has_message(first_seg(pool_lv), lv, 0) &&
 	    !update_pool_lv(pool_lv, 1)) {
 		if (force < DONT_PROMPT_OVERRIDE) {
 			log_error("Failed to update pool %s.", display_lvname(pool_lv));
@@ -6289,9 +6395,13 @@ int lv_remove_single(struct cmd_context *cmd, struct logical_volume *lv,
 	if (!vg_write(vg) || !vg_commit(vg))
 		return_0;
 
-	/* Release unneeded blocks in thin pool */
-	/* TODO: defer when multiple LVs relased at once */
-	if (pool_lv && !update_pool_lv(pool_lv, 1)) {
+	/*
+	 * Release unneeded blocks in thin pool.
+	 * With deferred updates, the delete stays queued with the messages of
+	 * the other LVs removed by this command and update_pool_lvs() sends
+	 * them all under the same transaction_id.
+	 */
+	if (pool_lv && !defer_pool_update && !update_pool_lv(pool_lv, 1)) {
 		if (force < DONT_PROMPT_OVERRIDE) {
 			log_error("Failed to update pool %s.", display_lvname(pool_lv));
 			return 0;
@@ -185,6 +185,7 @@
 #define READ_FOR_UPDATE		0x00100000U /* A meta-flag, useful with toollib for_each_* functions. */
 #define PROCESS_SKIP_SCAN	 0x00200000U /* skip lvmcache_label_scan in process_each_pv */
 #define PROCESS_SKIP_ORPHAN_LOCK 0x00400000U /* skip lock_vol(VG_ORPHAN) in vg_read */
+#define READ_LOCK_HELD		0x00800000U /* vg_read takes over the VG read lock held by the caller */
 
 /* vg's "read_status" field */
 #define FAILED_INCONSISTENT	0x00000001U
@@ -843,6 +844,7 @@ int validate_cache_chunk_size(struct cmd_context *cmd, uint32_t chunk_size);
 int validate_thin_pool_chunk_size(struct cmd_context *cmd, uint32_t chunk_size);
 int validate_pool_chunk_size(struct cmd_context *cmd, const struct segment_type *segtype, uint32_t chunk_size);
 int update_pool_lv(struct logical_volume *lv, int activate);
+int update_pool_lvs(struct volume_group *vg);
 int get_default_allocation_thin_pool_chunk_size(struct cmd_context *cmd, struct profile *profile,
 						uint32_t *chunk_size, int *chunk_size_calc_method);
 int update_thin_pool_params(struct cmd_context *cmd,
@@ -1053,6 +1055,8 @@ int lv_is_origin(const struct logical_volume *lv);
 
 int lv_is_thin_origin(const struct logical_volume *lv, unsigned *snap_count);
 int lv_is_thin_snapshot(const struct logical_volume *lv);
+int lv_thin_usage(const struct logical_volume *lv,
+		  uint64_t *exclusive, uint64_t *shared);
 
 int lv_is_cow(const struct logical_volume *lv);
 #define lv_is_thick_snapshot lv_is_cow
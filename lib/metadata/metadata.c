@@ -3676,8 +3676,14 @@ static struct volume_group *_vg_read(struct cmd_context *cmd,
 	 * with the orphan lock), and when we can tell that the global
 	 * lock is taken prior to the label scan, and still held here,
 	 * we can also skip the rescan in that case.
+	 *
+	 * process_each_vg may already have rescanned the devices of this
+	 * VG together with other VGs while holding their locks.
 	 */
-	if (!cmd->can_use_one_scan || lvmcache_scan_mismatch(cmd, vgname, vgid)) {
+	if (lvmcache_vg_is_rescanned(vgname, vgid)) {
+		log_debug_metadata("Devices for %s already rescanned", vgname);
+		skipped_rescan = 0;
+	} else if (!cmd->can_use_one_scan || lvmcache_scan_mismatch(cmd, vgname, vgid)) {
 		/* the skip rescan special case is for clvmd vg_read_by_vgid */
 		/* FIXME: this is not a warn flag, pass this differently */
 		if (warn_flags & SKIP_RESCAN)
@@ -4920,6 +4926,8 @@ static struct volume_group *_vg_lock_and_read(struct cmd_context *cmd, const cha
 	int enable_repair = 1;
 	int is_shared = 0;
 	int skip_lock = is_orphan_vg(vg_name) && (read_flags & PROCESS_SKIP_ORPHAN_LOCK);
+	/* The lock is then released here on failure, as if taken here */
+	int lock_held = (read_flags & READ_LOCK_HELD) && (lock_flags == LCK_VG_READ);
 
 	if ((read_flags & READ_ALLOW_INCONSISTENT) || (lock_flags != LCK_VG_WRITE)) {
 		enable_repair = 0;
@@ -4929,16 +4937,18 @@ static struct volume_group *_vg_lock_and_read(struct cmd_context *cmd, const cha
 	if (!validate_name(vg_name) && !is_orphan_vg(vg_name)) {
 		log_error("Volume group name \"%s\" has invalid characters.",
 			  vg_name);
+		if (lock_held)
+			unlock_vg(cmd, NULL, vg_name);
 		return NULL;
 	}
 
-	if (!skip_lock &&
+	if (!skip_lock && !lock_held &&
 	    !lock_vol(cmd, vg_name, lock_flags, NULL)) {
 		log_error("Can't get lock for %s", vg_name);
 		return _vg_make_handle(cmd, vg, FAILED_LOCKING);
 	}
 
-	if (skip_lock)
+	if (skip_lock || lock_held)
 		log_very_verbose("Locking %s already done", vg_name);
 
 	if (is_orphan_vg(vg_name))
@@ -42,8 +42,73 @@ static void _remove_area(struct pv_area *a)
 	a->map->pe_count -= a->count;
 }
 
+struct new_area {
+	struct pv_area *pva;
+	unsigned seq;
+};
+
+/* Largest first, equal sizes in the order they were created */
+static int _comp_new_area(const void *l, const void *r)
+{
+	const struct new_area *lna = l, *rna = r;
+
+	if (lna->pva->count != rna->pva->count)
+		return (lna->pva->count < rna->pva->count) ? 1 : -1;
+
+	return (lna->seq < rna->seq) ? -1 : 1;
+}
+
+/*
+ * Move the areas on list 'new' into the size-ordered areas of pvm.
+ * The result is the same as inserting each area in creation order
+ * with _insert_area(), but sorting them first avoids walking the areas
+ * of a fragmented PV once for every free area it has.
+ */
+static int _insert_new_areas(struct pv_map *pvm, struct dm_list *new)
+{
+	struct new_area *sorted;
+	struct pv_area *pva, *pos;
+	struct dm_list *cursor;
+	unsigned i, nr;
+
+	if (!(nr = dm_list_size(new)))
+		return 1;
+
+	if (!(sorted = malloc(nr * sizeof(*sorted)))) {
+		log_error("Couldn't allocate sorted areas for %s.", pv_dev_name(pvm->pv));
+		return 0;
+	}
+
+	i = 0;
+	dm_list_iterate_items(pva, new) {
+		sorted[i].pva = pva;
+		sorted[i].seq = i;
+		i++;
+	}
+
+	qsort(sorted, nr, sizeof(*sorted), _comp_new_area);
+
+	/* Merge: each area goes after existing ones at least as large */
+	cursor = dm_list_first(&pvm->areas);
+	for (i = 0; i < nr; i++) {
+		pva = sorted[i].pva;
+		while (cursor) {
+			pos = dm_list_item(cursor, struct pv_area);
+			if (pva->count > pos->count)
+				break;
+			cursor = dm_list_next(&pvm->areas, cursor);
+		}
+		dm_list_del(&pva->list);
+		dm_list_add(cursor ? : &pvm->areas, &pva->list);
+	}
+
+	free(sorted);
+
+	return 1;
+}
+
 static int _create_single_area(struct dm_pool *mem, struct pv_map *pvm,
-			       uint32_t start, uint32_t length)
+			       struct dm_list *new, uint32_t start, uint32_t length)
 {
 	struct pv_area *pva;
 
@@ -56,12 +121,14 @@ static int _create_single_area(struct dm_pool *mem, struct pv_map *pvm,
 	pva->start = start;
 	pva->count = length;
 	pva->unreserved = pva->count;
-	_insert_area(&pvm->areas, pva, 0);
+	dm_list_add(new, &pva->list);
+	pvm->pe_count += pva->count;
 
 	return 1;
 }
 
 static int _create_alloc_areas_for_pv(struct dm_pool *mem, struct pv_map *pvm,
+				      struct dm_list *new,
 				      uint32_t start, uint32_t count)
 {
 	struct pv_segment *peg;
@@ -94,7 +161,7 @@ static int _create_alloc_areas_for_pv(struct dm_pool *mem, struct pv_map *pvm,
 		area_len = (end >= peg->pe + peg->len - 1) ?
 			   peg->len - (pe - peg->pe) : end - pe + 1;
 
-		if (!_create_single_area(mem, pvm, pe, area_len))
+		if (!_create_single_area(mem, pvm, new, pe, area_len))
 			return_0;
 
       next:
@@ -108,29 +175,36 @@ static int _create_all_areas_for_pv(struct dm_pool *mem, struct pv_map *pvm,
 				    struct dm_list *pe_ranges)
 {
 	struct pe_range *aa;
+	struct dm_list new;
+
+	dm_list_init(&new);
 
 	if (!pe_ranges) {
 		/* Use whole PV */
-		if (!_create_alloc_areas_for_pv(mem, pvm, UINT32_C(0),
+		if (!_create_alloc_areas_for_pv(mem, pvm, &new, UINT32_C(0),
 						pvm->pv->pe_count))
 			return_0;
+	} else
+		dm_list_iterate_items(aa, pe_ranges)
+			if (!_create_alloc_areas_for_pv(mem, pvm, &new, aa->start,
+							aa->count))
+				return_0;
 
-		return 1;
-	}
-
-	dm_list_iterate_items(aa, pe_ranges) {
-		if (!_create_alloc_areas_for_pv(mem, pvm, aa->start,
-						aa->count))
-			return_0;
-	}
-
-	return 1;
+	return _insert_new_areas(pvm, &new);
 }
 
 static int _create_maps(struct dm_pool *mem, struct dm_list *pvs, struct dm_list *pvms)
 {
-	struct pv_map *pvm, *pvm2;
+	struct pv_map *pvm;
 	struct pv_list *pvl;
+	struct dm_hash_table *pvm_by_dev;
+	int r = 0;
+
+	/* Same device may be listed several times with different pe_ranges */
+	if (!(pvm_by_dev = dm_hash_create(dm_list_size(pvs) + 1))) {
+		log_error("Couldn't create hash table for physical volume maps.");
+		return 0;
+	}
 
 	dm_list_iterate_items(pvl, pvs) {
 		if (!(pvl->pv->status & ALLOCATABLE_PV) ||
@@ -142,28 +216,29 @@ static int _create_maps(struct dm_pool *mem, struct dm_list *pvs, struct dm_list
 			continue;
 		assert(pvl->pv->dev);
 
-		pvm = NULL;
-
-		dm_list_iterate_items(pvm2, pvms)
-			if (pvm2->pv->dev == pvl->pv->dev) {
-				pvm = pvm2;
-				break;
-			}
-
-		if (!pvm) {
+		if (!(pvm = dm_hash_lookup_binary(pvm_by_dev, &pvl->pv->dev, sizeof(pvl->pv->dev)))) {
 			if (!(pvm = dm_pool_zalloc(mem, sizeof(*pvm))))
-				return_0;
+				goto_out;
 
 			pvm->pv = pvl->pv;
 			dm_list_init(&pvm->areas);
 			dm_list_add(pvms, &pvm->list);
+
+			if (!dm_hash_insert_binary(pvm_by_dev, &pvl->pv->dev, sizeof(pvl->pv->dev), pvm)) {
+				log_error("Couldn't add physical volume map to hash table.");
+				goto out;
+			}
 		}
 
 		if (!_create_all_areas_for_pv(mem, pvm, pvl->pe_ranges))
-			return_0;
+			goto_out;
 	}
 
-	return 1;
+	r = 1;
+out:
+	dm_hash_destroy(pvm_by_dev);
+
+	return r;
 }
 
 /*
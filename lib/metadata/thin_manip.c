@@ -14,12 +14,19 @@
 
 #include "lib/misc/lib.h"
 #include "lib/activate/activate.h"
+#include "lib/commands/toolcontext.h"
 #include "lib/locking/locking.h"
 #include "lib/mm/memlock.h"
 #include "lib/metadata/metadata.h"
 #include "lib/metadata/segtype.h"
 #include "lib/config/defaults.h"
 #include "lib/display/display.h"
+#include "lib/format_text/archiver.h"
+#include "lib/mm/xlate.h"
+#include "lib/misc/crc.h"
+#include "lib/misc/lvm-signal.h"
+
+#include <sys/file.h>
 
 /* TODO: drop unused no_update */
 int attach_pool_message(struct lv_segment *pool_seg, dm_thin_message_t type,
@@ -553,6 +560,41 @@ int update_pool_lv(struct logical_volume *lv, int activate)
 	return ret;
 }
 
+/*
+ * Send the messages queued in each thin pool of the VG with one pool
+ * reload and metadata commit per pool.
+ */
+int update_pool_lvs(struct volume_group *vg)
+{
+	struct lv_list *lvl;
+	int updated = 0, r = 1;
+
+	/* Not holding the pool locks anymore, lv_remove_single() did not defer */
+	if (vg_is_shared(vg))
+		return 1;
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!lv_is_thin_pool(lvl->lv) ||
+		    dm_list_empty(&first_seg(lvl->lv)->thin_messages))
+			continue;
+
+		log_debug_metadata("Sending %u queued messages to pool %s.",
+				   dm_list_size(&first_seg(lvl->lv)->thin_messages),
+				   display_lvname(lvl->lv));
+
+		if (!update_pool_lv(lvl->lv, 1)) {
+			log_error("Failed to update pool %s.", display_lvname(lvl->lv));
+			r = 0;
+		} else
+			updated = 1;
+	}
+
+	if (updated)
+		backup(vg);
+
+	return r;
+}
+
 static uint64_t _estimate_size(uint32_t data_extents, uint32_t extent_size, uint64_t size)
 {
 	/*
@@ -916,3 +958,480 @@ int validate_thin_pool_chunk_size(struct cmd_context *cmd, uint32_t chunk_size)
 
 	return r;
 }
+
+/*
+ * Pool metadata snapshot scan.
+ *
+ * Walks the data mapping btree of a reserved pool metadata snapshot and
+ * counts, for each thin device, the data blocks it maps and how many of
+ * them no other thin device in the pool maps.  Blocks are read with
+ * O_DIRECT one at a time and their checksums are verified, so memory
+ * use is one block per btree level plus a 2-bit reference counter per
+ * pool data block, limited to THIN_SCAN_MAX_REFS_SIZE.
+ *
+ * Only a snapshot reserved by lvm is scanned, never one held by another
+ * tool.  Reserving and releasing it is serialised by a lock file per
+ * pool in the locking directory.  The lock file names the process
+ * while it holds the reservation, so a reservation left behind by a
+ * killed command is released by the next one.
+ */
+#define THIN_METADATA_BLOCK_SIZE	4096
+#define THIN_SUPERBLOCK_MAGIC		27022010
+#define THIN_BTREE_INTERNAL_NODE	0x1
+#define THIN_BTREE_LEAF_NODE		0x2
+#define THIN_BTREE_MAX_DEPTH		32	/* Both levels of the mapping tree */
+#define THIN_SUPERBLOCK_CSUM_XOR	160774
+#define THIN_BTREE_CSUM_XOR		121107
+#define THIN_SCAN_MAX_REFS_SIZE		(64 * 1024 * 1024)	/* 256Mi data blocks */
+
+struct thin_disk_superblock {
+	uint32_t csum;
+	uint32_t flags;
+	uint64_t blocknr;
+	uint8_t uuid[16];
+	uint64_t magic;
+	uint32_t version;
+	uint32_t time;
+	uint64_t trans_id;
+	uint64_t held_root;
+	uint8_t data_space_map_root[128];
+	uint8_t metadata_space_map_root[128];
+	uint64_t data_mapping_root;
+	uint64_t device_details_root;
+} __attribute__((packed));
+
+struct thin_btree_node_header {
+	uint32_t csum;
+	uint32_t flags;
+	uint64_t blocknr;
+	uint32_t nr_entries;
+	uint32_t max_entries;
+	uint32_t value_size;
+	uint32_t padding;
+} __attribute__((packed));
+
+struct thin_usage {
+	struct dm_list list;
+	uint32_t device_id;
+	uint64_t mapped_blocks;
+	uint64_t exclusive_blocks;
+};
+
+/* Scan results, cached for the command in cmd->thin_usage_cache. */
+struct thin_pool_usage {
+	struct dm_list list;
+	union lvid lvid;
+	uint64_t transaction_id;
+	struct dm_list devices;
+};
+
+struct thin_scan {
+	struct dm_pool *mem;
+	const char *path;
+	int fd;
+	int counting;			/* First pass counts references */
+	uint64_t nr_blocks;		/* Metadata blocks */
+	uint64_t nr_data_blocks;
+	uint8_t *refs;			/* 2-bit saturating counters */
+	char *buf;			/* One block per btree level */
+	struct dm_list *devices;
+	struct thin_usage *dev;
+};
+
+static int _thin_scan_read(struct thin_scan *ts, uint64_t blocknr, char *buf)
+{
+	if (blocknr >= ts->nr_blocks) {
+		log_error("Thin metadata block " FMTu64 " is beyond the end of %s.",
+			  blocknr, ts->path);
+		return 0;
+	}
+
+	if (pread(ts->fd, buf, THIN_METADATA_BLOCK_SIZE,
+		  (off_t) (blocknr * THIN_METADATA_BLOCK_SIZE)) != THIN_METADATA_BLOCK_SIZE) {
+		log_sys_error("pread", ts->path);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Checksum of a metadata block as written by the kernel */
+static int _thin_scan_csum_ok(const char *buf, uint32_t csum_xor)
+{
+	uint32_t csum = calc_crc32c(0xffffffff, (const uint8_t *) buf + sizeof(uint32_t),
+				    THIN_METADATA_BLOCK_SIZE - sizeof(uint32_t)) ^ csum_xor;
+
+	return le32_to_cpu(*(const uint32_t *) buf) == csum;
+}
+
+static unsigned _thin_scan_refs(const struct thin_scan *ts, uint64_t block)
+{
+	return (ts->refs[block >> 2] >> ((block & 3) << 1)) & 3;
+}
+
+static struct thin_usage *_thin_scan_device(struct thin_scan *ts, uint32_t device_id)
+{
+	struct thin_usage *tu;
+
+	dm_list_iterate_items(tu, ts->devices)
+		if (tu->device_id == device_id)
+			return tu;
+
+	if (!ts->counting) {
+		log_error(INTERNAL_ERROR "Thin device %u appeared in %s.",
+			  device_id, ts->path);
+		return NULL;
+	}
+
+	if (!(tu = dm_pool_zalloc(ts->mem, sizeof(*tu)))) {
+		log_error("Failed to allocate thin usage.");
+		return NULL;
+	}
+
+	tu->device_id = device_id;
+	dm_list_add(ts->devices, &tu->list);
+
+	return tu;
+}
+
+/*
+ * Visit each mapping under the btree root: the top level maps device
+ * ids to the root of their own tree, which maps thin blocks to data
+ * blocks with the time of the mapping in the low 24 bits.
+ */
+static int _thin_scan_walk(struct thin_scan *ts, uint64_t root,
+			   unsigned depth, int top_level)
+{
+	char *buf = ts->buf + depth * THIN_METADATA_BLOCK_SIZE;
+	const struct thin_btree_node_header *hdr = (const void *) buf;
+	const uint64_t *keys = (const void *) (buf + sizeof(*hdr));
+	const uint64_t *values;
+	uint32_t flags, nr_entries, max_entries, i;
+	uint64_t value;
+
+	if (depth >= THIN_BTREE_MAX_DEPTH) {
+		log_error("Thin metadata btree on %s is too deep.", ts->path);
+		return 0;
+	}
+
+	if (!_thin_scan_read(ts, root, buf))
+		return_0;
+
+	flags = le32_to_cpu(hdr->flags);
+	nr_entries = le32_to_cpu(hdr->nr_entries);
+	max_entries = le32_to_cpu(hdr->max_entries);
+
+	if (!_thin_scan_csum_ok(buf, THIN_BTREE_CSUM_XOR)) {
+		log_error("Checksum mismatch in thin metadata btree node " FMTu64 " on %s.",
+			  root, ts->path);
+		return 0;
+	}
+
+	if ((le64_to_cpu(hdr->blocknr) != root) ||
+	    ((flags != THIN_BTREE_INTERNAL_NODE) && (flags != THIN_BTREE_LEAF_NODE)) ||
+	    (le32_to_cpu(hdr->value_size) != sizeof(uint64_t)) ||
+	    (nr_entries > max_entries) ||
+	    (max_entries > (THIN_METADATA_BLOCK_SIZE - sizeof(*hdr)) / (2 * sizeof(uint64_t)))) {
+		log_error("Invalid thin metadata btree node " FMTu64 " on %s.",
+			  root, ts->path);
+		return 0;
+	}
+
+	values = keys + max_entries;
+
+	for (i = 0; i < nr_entries; i++) {
+		value = le64_to_cpu(values[i]);
+
+		if (flags == THIN_BTREE_INTERNAL_NODE) {
+			if (!_thin_scan_walk(ts, value, depth + 1, top_level))
+				return_0;
+			continue;
+		}
+
+		if (top_level) {
+			if (!(ts->dev = _thin_scan_device(ts, (uint32_t) le64_to_cpu(keys[i]))) ||
+			    !_thin_scan_walk(ts, value, depth + 1, 0))
+				return_0;
+			continue;
+		}
+
+		if ((value >>= 24) >= ts->nr_data_blocks) {
+			log_error("Thin metadata on %s maps data block " FMTu64
+				  " beyond the end of the pool.", ts->path, value);
+			return 0;
+		}
+
+		if (ts->counting) {
+			if (_thin_scan_refs(ts, value) < 2)
+				ts->refs[value >> 2] += 1 << ((value & 3) << 1);
+			ts->dev->mapped_blocks++;
+		} else if (_thin_scan_refs(ts, value) == 1)
+			ts->dev->exclusive_blocks++;
+	}
+
+	return 1;
+}
+
+static int _thin_scan_snapshot(struct thin_scan *ts, uint64_t held_root)
+{
+	const struct thin_disk_superblock *sb = (const void *) ts->buf;
+	uint64_t root;
+
+	/* The held root is a copy of the superblock at reservation time. */
+	if (!_thin_scan_read(ts, held_root, ts->buf))
+		return_0;
+
+	if ((le64_to_cpu(sb->magic) != THIN_SUPERBLOCK_MAGIC) ||
+	    (le64_to_cpu(sb->blocknr) != held_root) ||
+	    !_thin_scan_csum_ok(ts->buf, THIN_SUPERBLOCK_CSUM_XOR)) {
+		log_error("Invalid thin metadata snapshot " FMTu64 " on %s.",
+			  held_root, ts->path);
+		return 0;
+	}
+
+	root = le64_to_cpu(sb->data_mapping_root);
+
+	ts->counting = 1;
+	if (!_thin_scan_walk(ts, root, 0, 1))
+		return_0;
+
+	ts->counting = 0;
+	if (!_thin_scan_walk(ts, root, 0, 1))
+		return_0;
+
+	return 1;
+}
+
+/* Returns the locked descriptor of the pool's metadata snapshot lock file */
+static int _thin_snap_lock(const struct logical_volume *pool_lv, char *path, size_t size)
+{
+	const char *dir = find_config_tree_str(pool_lv->vg->cmd, global_locking_dir_CFG, NULL);
+	char uuid[64];
+	int fd;
+
+	if (!dir || !id_write_format(&pool_lv->lvid.id[1], uuid, sizeof(uuid)) ||
+	    (dm_snprintf(path, size, "%s/T_%s", dir, uuid) < 0)) {
+		log_error("Failed to build metadata snapshot lock name for thin pool %s.",
+			  display_lvname(pool_lv));
+		return -1;
+	}
+
+	if ((fd = open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0600)) < 0) {
+		log_sys_debug("open", path);
+		return -1;
+	}
+
+	sigint_allow();
+	if (flock(fd, LOCK_EX)) {
+		sigint_restore();
+		log_sys_debug("flock", path);
+		if (close(fd))
+			log_sys_debug("close", path);
+		return -1;
+	}
+	sigint_restore();
+
+	return fd;
+}
+
+/* Record whether lvm holds the reservation, for a later command to clean up. */
+static int _thin_snap_mark(int fd, const char *path, int reserved)
+{
+	char buf[32];
+	int len;
+
+	if (ftruncate(fd, 0)) {
+		log_sys_error("ftruncate", path);
+		return 0;
+	}
+
+	if (!reserved)
+		return 1;
+
+	if (((len = dm_snprintf(buf, sizeof(buf), "%d\n", (int) getpid())) < 0) ||
+	    (pwrite(fd, buf, len, 0) != len)) {
+		log_sys_error("write", path);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _thin_snap_marked(int fd)
+{
+	struct stat st;
+
+	return !fstat(fd, &st) && st.st_size;
+}
+
+static struct thin_pool_usage *_thin_pool_usage(const struct logical_volume *pool_lv)
+{
+	struct cmd_context *cmd = pool_lv->vg->cmd;
+	const struct logical_volume *mlv = first_seg(pool_lv)->metadata_lv;
+	struct dm_status_thin_pool status;
+	struct thin_pool_usage *tpu;
+	struct thin_scan ts = { .fd = -1 };
+	char lock_path[PATH_MAX];
+	uint64_t held_root;
+	int lock_fd, reserved = 0, r = 0;
+
+	if (!lv_thin_pool_status(pool_lv, 0, &status))
+		return NULL;	/* Inactive pool */
+
+	dm_list_iterate_items(tpu, &cmd->thin_usage_cache)
+		if (!memcmp(&tpu->lvid, &pool_lv->lvid, sizeof(tpu->lvid)) &&
+		    (tpu->transaction_id == status.transaction_id))
+			return tpu;
+
+	if (status.fail || status.needs_check)
+		return NULL;
+
+	if (status.read_only) {
+		log_warn("WARNING: Cannot reserve metadata snapshot of read-only thin pool %s.",
+			 display_lvname(pool_lv));
+		return NULL;
+	}
+
+	if ((status.total_data_blocks + 3) / 4 > THIN_SCAN_MAX_REFS_SIZE) {
+		log_warn("WARNING: Thin pool %s has too many data blocks to scan its metadata.",
+			 display_lvname(pool_lv));
+		return NULL;
+	}
+
+	if ((lock_fd = _thin_snap_lock(pool_lv, lock_path, sizeof(lock_path))) < 0) {
+		log_warn("WARNING: Cannot lock metadata snapshot of thin pool %s.",
+			 display_lvname(pool_lv));
+		return NULL;
+	}
+
+	if (!lv_thin_pool_status(pool_lv, 0, &status))
+		goto_out;
+
+	if (status.held_metadata_root) {
+		if (!_thin_snap_marked(lock_fd)) {
+			log_warn("WARNING: Metadata snapshot of thin pool %s is held by another tool.",
+				 display_lvname(pool_lv));
+			goto out;
+		}
+		log_verbose("Releasing metadata snapshot of thin pool %s left by an interrupted command.",
+			    display_lvname(pool_lv));
+		if (!lv_thin_pool_metadata_snap(pool_lv, 0))
+			goto_out;
+	}
+
+	if (!_thin_snap_mark(lock_fd, lock_path, 1))
+		goto_out;
+
+	if (!lv_thin_pool_metadata_snap(pool_lv, 1))
+		goto_out;
+	reserved = 1;
+
+	if (!lv_thin_pool_status(pool_lv, 0, &status) ||
+	    !(held_root = status.held_metadata_root)) {
+		log_error("Failed to find metadata snapshot of thin pool %s.",
+			  display_lvname(pool_lv));
+		goto out;
+	}
+
+	if (!(tpu = dm_pool_zalloc(cmd->mem, sizeof(*tpu))))
+		goto_out;
+
+	tpu->lvid = pool_lv->lvid;
+	tpu->transaction_id = status.transaction_id;
+	dm_list_init(&tpu->devices);
+
+	ts.mem = cmd->mem;
+	ts.devices = &tpu->devices;
+	ts.nr_blocks = mlv->size / (THIN_METADATA_BLOCK_SIZE >> SECTOR_SHIFT);
+	ts.nr_data_blocks = status.total_data_blocks;
+
+	if (!(ts.path = lv_dmpath_dup(cmd->mem, mlv)))
+		goto_out;
+
+	if (!(ts.refs = zalloc((size_t) ((ts.nr_data_blocks + 3) / 4)))) {
+		log_error("Failed to allocate reference counters for thin pool %s.",
+			  display_lvname(pool_lv));
+		goto out;
+	}
+
+	if (posix_memalign((void **) &ts.buf, THIN_METADATA_BLOCK_SIZE,
+			   THIN_BTREE_MAX_DEPTH * THIN_METADATA_BLOCK_SIZE)) {
+		ts.buf = NULL;
+		log_error("Failed to allocate thin metadata buffers.");
+		goto out;
+	}
+
+	if ((ts.fd = open(ts.path, O_RDONLY | O_DIRECT)) < 0) {
+		log_sys_error("open", ts.path);
+		goto out;
+	}
+
+	log_debug_metadata("Scanning metadata snapshot " FMTu64 " of thin pool %s.",
+			   held_root, display_lvname(pool_lv));
+
+	if (!_thin_scan_snapshot(&ts, held_root))
+		goto_out;
+
+	/* Released and maybe reserved again by someone else meanwhile? */
+	if (!lv_thin_pool_status(pool_lv, 0, &status) ||
+	    (status.held_metadata_root != held_root)) {
+		log_error("Metadata snapshot of thin pool %s changed while it was scanned.",
+			  display_lvname(pool_lv));
+		reserved = 0;
+		goto out;
+	}
+
+	dm_list_add(&cmd->thin_usage_cache, &tpu->list);
+	r = 1;
+out:
+	if ((ts.fd >= 0) && close(ts.fd))
+		log_sys_debug("close", ts.path);
+	free(ts.buf);
+	free(ts.refs);
+
+	if (reserved && !lv_thin_pool_metadata_snap(pool_lv, 0))
+		log_warn("WARNING: Failed to release metadata snapshot of thin pool %s.",
+			 display_lvname(pool_lv));
+	else if (!_thin_snap_mark(lock_fd, lock_path, 0))
+		stack;
+
+	if (close(lock_fd))
+		log_sys_debug("close", lock_path);
+
+	return r ? tpu : NULL;
+}
+
+/*
+ * Get the space a thin volume uses exclusively and shares with other
+ * thin volumes of its pool, in sectors.  The pool must be active and
+ * the command must have asked for it with cmd->report_thin_usage.
+ */
+int lv_thin_usage(const struct logical_volume *lv,
+		  uint64_t *exclusive, uint64_t *shared)
+{
+	const struct lv_segment *seg = first_seg(lv);
+	const struct thin_pool_usage *tpu;
+	const struct thin_usage *tu;
+
+	/* Only when asked for, scanning reserves a metadata snapshot */
+	if (!lv_is_thin_volume(lv) || !lv->vg->cmd->report_thin_usage)
+		return 0;
+
+	if (!(tpu = _thin_pool_usage(seg->pool_lv)))
+		return 0;
+
+	*exclusive = *shared = 0;
+
+	/* A device missing from the snapshot maps nothing */
+	dm_list_iterate_items(tu, &tpu->devices)
+		if (tu->device_id == seg->device_id) {
+			*exclusive = tu->exclusive_blocks;
+			*shared = tu->mapped_blocks - tu->exclusive_blocks;
+			break;
+		}
+
+	*exclusive *= first_seg(seg->pool_lv)->chunk_size;
+	*shared *= first_seg(seg->pool_lv)->chunk_size;
+
+	return 1;
+}
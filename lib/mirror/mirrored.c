@@ -37,6 +37,7 @@ enum {
 
 struct mirror_state {
 	uint32_t default_region_size;
+	uint32_t pvmove_parallel_segments;
 };
 
 static void _mirrored_display(const struct lv_segment *seg)
@@ -150,6 +151,7 @@ static struct mirror_state *_mirrored_init_target(struct dm_pool *mem,
 					 struct cmd_context *cmd)
 {
 	struct mirror_state *mirr_state;
+	int parallel;
 
 	if (!(mirr_state = dm_pool_alloc(mem, sizeof(*mirr_state)))) {
 		log_error("struct mirr_state allocation failed");
@@ -158,6 +160,12 @@ static struct mirror_state *_mirrored_init_target(struct dm_pool *mem,
 
 	mirr_state->default_region_size = get_default_region_size(cmd);
 
+	if ((parallel = find_config_tree_int(cmd, activation_pvmove_parallel_segments_CFG, NULL)) < 1) {
+		log_warn("WARNING: Ignoring invalid pvmove_parallel_segments %d, using 1.", parallel);
+		parallel = 1;
+	}
+	mirr_state->pvmove_parallel_segments = (uint32_t) parallel;
+
 	return mirr_state;
 }
 
@@ -349,15 +357,16 @@ static int _mirrored_add_target_line(struct dev_manager *dm, struct dm_pool *mem
 		mirror_status = MIRR_DISABLED;
 
 	/*
-	 * For pvmove, only have one mirror segment RUNNING at once.
-	 * Segments before this are COMPLETED and use 2nd area.
-	 * Segments after this are DISABLED and use 1st area.
+	 * For pvmove, only have pvmove_parallel_segments mirror segments
+	 * RUNNING at once.
+	 * Segments before these are COMPLETED and use 2nd area.
+	 * Segments after these are DISABLED and use 1st area.
 	 */
 	if (seg->status & PVMOVE) {
 		if (seg->extents_copied == seg->area_len) {
 			mirror_status = MIRR_COMPLETED;
 			start_area = 1;
-		} else if ((*pvmove_mirror_count)++) {
+		} else if ((*pvmove_mirror_count)++ >= mirr_state->pvmove_parallel_segments) {
 			mirror_status = MIRR_DISABLED;
 			area_count = 1;
 		}
@@ -21,5 +21,6 @@
 #define INITIAL_CRC 0xf597a6cf
 
 uint32_t calc_crc(uint32_t initial, const uint8_t *buf, uint32_t size);
+uint32_t calc_crc32c(uint32_t initial, const uint8_t *buf, uint32_t size);
 
 #endif
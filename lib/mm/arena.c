@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/mm/arena.h"
+
+struct arena_block {
+	size_t size;			/* including this header */
+	struct arena_block *next;	/* only valid while free */
+};
+
+#define ARENA_HEADER ((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+void arena_init(struct arena *a, void *mem, size_t size)
+{
+	a->mem = mem;
+	a->size = size;
+	a->used = a->high_water = 0;
+	a->misses = 0;
+	a->free = mem;
+	a->free->size = size;
+	a->free->next = NULL;
+}
+
+void *arena_alloc(struct arena *a, size_t s)
+{
+	size_t size = ARENA_HEADER + ((s + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1));
+	struct arena_block *b, **prev, *rest;
+
+	/* First fit */
+	for (prev = &a->free; (b = *prev); prev = &b->next)
+		if (b->size >= size)
+			break;
+
+	if (!b) {
+		a->misses++;
+		return NULL;
+	}
+
+	if (b->size - size >= ARENA_HEADER + ARENA_ALIGN) {
+		rest = (struct arena_block *) ((char *) b + size);
+		rest->size = b->size - size;
+		rest->next = b->next;
+		*prev = rest;
+		b->size = size;
+	} else
+		*prev = b->next;
+
+	a->used += b->size;
+	if (a->used > a->high_water)
+		a->high_water = a->used;
+
+	return (char *) b + ARENA_HEADER;
+}
+
+int arena_free(struct arena *a, void *ptr)
+{
+	struct arena_block *b, *before = NULL, *after;
+
+	if (((char *) ptr < a->mem) || ((char *) ptr >= a->mem + a->size))
+		return 0;
+
+	b = (struct arena_block *) ((char *) ptr - ARENA_HEADER);
+	a->used -= b->size;
+
+	for (after = a->free; after && (after < b); after = after->next)
+		before = after;
+
+	/* Merge with the following free block */
+	if (after && ((char *) b + b->size == (char *) after)) {
+		b->size += after->size;
+		b->next = after->next;
+	} else
+		b->next = after;
+
+	/* Merge with the preceding free block */
+	if (before && ((char *) before + before->size == (char *) b)) {
+		before->size += b->size;
+		before->next = b->next;
+	} else if (before)
+		before->next = b;
+	else
+		a->free = b;
+
+	return 1;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef LVM_ARENA_H
+#define LVM_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Allocator for a fixed, preallocated area of memory.  Free space is
+ * kept in an address ordered list of blocks, so a block released early
+ * can be reused even while other blocks are still held.  Adjacent free
+ * blocks are merged on release.
+ */
+struct arena_block;
+
+struct arena {
+	char *mem;
+	size_t size;
+	size_t used;			/* including block headers */
+	size_t high_water;
+	struct arena_block *free;
+	unsigned misses;		/* allocations that did not fit */
+};
+
+#define ARENA_ALIGN 16
+
+/* mem must be aligned to ARENA_ALIGN */
+void arena_init(struct arena *a, void *mem, size_t size);
+void *arena_alloc(struct arena *a, size_t s);
+
+/* Returns 0 if ptr is not from the arena */
+int arena_free(struct arena *a, void *ptr);
+
+#endif
@@ -15,6 +15,7 @@
 
 #include "lib/misc/lib.h"
 #include "lib/mm/memlock.h"
+#include "lib/mm/arena.h"
 #include "lib/config/defaults.h"
 #include "lib/config/config.h"
 #include "lib/commands/toolcontext.h"
@@ -26,6 +27,7 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <malloc.h>
+#include <link.h>
 
 #ifdef HAVE_VALGRIND
 #include <valgrind.h>
@@ -84,6 +86,14 @@ static size_t _size_malloc_tmp;
 static size_t _size_malloc = 2000000;
 
 static void *_malloc_mem = NULL;
+
+/*
+ * Preallocated and touched area memory pool chunks are taken from while
+ * devices are suspended.  Chunks may outlive the critical section, so
+ * the area is kept until exit.
+ */
+static struct arena _arena;
+static size_t _size_arena;
 static int _mem_locked = 0;
 static int _priority_raised = 0;
 static int _critical_section = 0;
@@ -105,7 +115,6 @@ static const char * const _blacklist_maps[] = {
 	"/LC_MESSAGES/",
 	"gconv/gconv-modules.cache",
 	"/ld-2.",		/* not using dlopen,dlsym during mlock */
-	"/libaio.so.",		/* not using aio during mlock */
 	"/libattr.so.",		/* not using during mlock (udev) */
 	"/libblkid.so.",	/* not using blkid during mlock (udev) */
 	"/libbz2.so.",		/* not using during mlock (udev) */
@@ -134,9 +143,31 @@ static const char * const _blacklist_maps[] = {
 	/* "/libdevmapper-event.so" */
 };
 
+/* default selection of file maps for mlock_targeted */
+static const char * const _select_maps[] = {
+	"/libc.so.", "/libc-",	/* system calls, string and memory functions */
+	"/ld-",			/* lazy symbol binding */
+	"/libpthread.so.", "/libpthread-",
+	"/librt.so.", "/librt-",
+	"/libaio.so.",		/* metadata written while suspended */
+	"/libdevmapper.so.",	/* ioctls */
+	"/libdevmapper-event.so.", /* monitoring */
+	"/liblvm2cmd.so.",	/* lvm commands run by dmeventd plugins */
+	"/libdevmapper-event-lvm2", /* dmeventd plugins */
+};
+
 typedef enum { LVM_MLOCK, LVM_MUNLOCK } lvmlock_t;
 
 static unsigned _use_mlockall;
+static unsigned _use_mlock_targeted;
+static char _self_exe[PATH_MAX] = "";
+
+/* Address ranges of the objects loaded when memory was locked */
+struct loaded_range {
+	unsigned long from, to;
+};
+static struct loaded_range *_loaded_ranges;
+static unsigned _loaded_count;
 static int _maps_fd;
 static size_t _maps_len = 8192; /* Initial buffer size for reading /proc/self/maps */
 static char *_maps_buffer;
@@ -224,11 +255,157 @@ static void _release_memory(void)
 	free(_malloc_mem);
 }
 
+static void *_arena_alloc(size_t s)
+{
+	return arena_alloc(&_arena, s);
+}
+
+static int _arena_free(void *ptr)
+{
+	return arena_free(&_arena, ptr);
+}
+
+static void _allocate_arena(void)
+{
+	void *mem;
+
+	if (_arena.mem || !_size_arena)
+		return;
+
+	if ((mem = mmap(NULL, _size_arena, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+		log_sys_debug("mmap", "pool arena");
+		return;
+	}
+
+	_touch_memory(mem, _size_arena);
+	arena_init(&_arena, mem, _size_arena);
+	dm_pool_set_chunk_allocator(NULL, _arena_free);
+}
+
+static void _log_arena(void)
+{
+	if (!_arena.mem)
+		return;
+
+	log_debug_mem("Pool arena high water mark %" PRIsize_t " of %" PRIsize_t
+		      " bytes, %u chunks from malloc.",
+		      _arena.high_water, _arena.size, _arena.misses);
+	if (_arena.misses)
+		log_warn("WARNING: %u memory pool chunks did not fit into %" PRIsize_t
+			 " KiB of activation/reserved_pool_memory while devices were suspended.",
+			 _arena.misses, _arena.size >> 10);
+	_arena.high_water = _arena.used;
+	_arena.misses = 0;
+}
+
+static int _count_loaded(struct dl_phdr_info *info,
+			 size_t size __attribute__((unused)), void *data)
+{
+	unsigned *count = data;
+	unsigned i;
+
+	for (i = 0; i < info->dlpi_phnum; ++i)
+		if (info->dlpi_phdr[i].p_type == PT_LOAD)
+			++*count;
+
+	return 0;
+}
+
+static int _add_loaded(struct dl_phdr_info *info,
+		       size_t size __attribute__((unused)), void *data)
+{
+	unsigned *size_ranges = data;
+	unsigned long from;
+	unsigned i;
+
+	for (i = 0; i < info->dlpi_phnum; ++i) {
+		if (info->dlpi_phdr[i].p_type != PT_LOAD)
+			continue;
+		if (_loaded_count == *size_ranges)
+			return 1; /* loaded since counted */
+		from = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+		_loaded_ranges[_loaded_count].from = from;
+		_loaded_ranges[_loaded_count].to = from + info->dlpi_phdr[i].p_memsz;
+		_loaded_count++;
+	}
+
+	return 0;
+}
+
+/*
+ * Remember where the executable and the shared libraries in use
+ * (including dlopened plugins) are loaded, so mlock_targeted can select
+ * their maps without a hand kept list of library names.
+ */
+static void _read_loaded_objects(void)
+{
+	unsigned size_ranges = 0;
+
+	(void) dl_iterate_phdr(_count_loaded, &size_ranges);
+
+	free(_loaded_ranges);
+	_loaded_count = 0;
+	if (!(_loaded_ranges = malloc(size_ranges * sizeof(*_loaded_ranges)))) {
+		log_debug_mem("Failed to allocate list of loaded objects.");
+		return;
+	}
+
+	(void) dl_iterate_phdr(_add_loaded, &size_ranges);
+}
+
+static void _release_loaded_objects(void)
+{
+	free(_loaded_ranges);
+	_loaded_ranges = NULL;
+	_loaded_count = 0;
+}
+
+/*
+ * With mlock_targeted only anonymous memory, the executable and
+ * the selected libraries are locked.  Without mlock_select, every
+ * loaded object is selected, so compared to locking without
+ * mlock_targeted only mapped files that are not loaded objects are
+ * left out.  Locking less needs an mlock_select list.
+ */
+static int _maps_selected(const struct dm_config_node *select_cn,
+			  unsigned long from, unsigned long to, const char *line)
+{
+	const struct dm_config_value *cv;
+	const char *path = line + strcspn(line, "/[");
+	unsigned i;
+
+	/* Anonymous memory, heap and stack */
+	if (!*path || (*path == '['))
+		return 1;
+
+	if (*_self_exe && !strncmp(path, _self_exe, strlen(_self_exe)))
+		return 1;
+
+	if (!select_cn) {
+		for (i = 0; i < _loaded_count; ++i)
+			if ((from < _loaded_ranges[i].to) && (to > _loaded_ranges[i].from))
+				return 1;
+		for (i = 0; i < DM_ARRAY_SIZE(_select_maps); ++i)
+			if (strstr(path, _select_maps[i]))
+				return 1;
+		return 0;
+	}
+
+	for (cv = select_cn->v; cv; cv = cv->next)
+		if ((cv->type == DM_CFG_STRING) && cv->v.str[0] &&
+		    strstr(path, cv->v.str))
+			return 1;
+
+	return 0;
+}
+
 /*
  * mlock/munlock memory areas from /proc/self/maps
  * format described in kernel/Documentation/filesystem/proc.txt
  */
-static int _maps_line(const struct dm_config_node *cn, lvmlock_t lock,
+static int _maps_line(const struct dm_config_node *cn,
+		      const struct dm_config_node *select_cn, lvmlock_t lock,
 		      const char *line, size_t *mstats)
 {
 	const struct dm_config_value *cv;
@@ -259,6 +436,12 @@ static int _maps_line(const struct dm_config_node *cn, lvmlock_t lock,
 			return 1;
 		}
 
+	if (_use_mlock_targeted && !_maps_selected(select_cn, (unsigned long) from,
+						  (unsigned long) to, line + pos)) {
+		log_debug_mem("%s area not selected %s : Skipping.", lock_str, line);
+		return 1;
+	}
+
 	sz = to - from;
 	if (!cn) {
 		/* If no blacklist configured, use an internal set */
@@ -312,7 +495,7 @@ static int _maps_line(const struct dm_config_node *cn, lvmlock_t lock,
 
 static int _memlock_maps(struct cmd_context *cmd, lvmlock_t lock, size_t *mstats)
 {
-	const struct dm_config_node *cn;
+	const struct dm_config_node *cn, *select_cn = NULL;
 	char *line, *line_end;
 	size_t len;
 	ssize_t n;
@@ -370,10 +553,12 @@ static int _memlock_maps(struct cmd_context *cmd, lvmlock_t lock, size_t *mstats
 
 	line = _maps_buffer;
 	cn = find_config_tree_array(cmd, activation_mlock_filter_CFG, NULL);
+	if (_use_mlock_targeted)
+		select_cn = find_config_tree_array(cmd, activation_mlock_select_CFG, NULL);
 
 	while ((line_end = strchr(line, '\n'))) {
 		*line_end = '\0'; /* remove \n */
-		if (!_maps_line(cn, lock, line, mstats))
+		if (!_maps_line(cn, select_cn, lock, line, mstats))
 			ret = 0;
 		line = line_end + 1;
 	}
@@ -507,10 +692,30 @@ static void _restore_priority_if_possible(struct cmd_context *cmd)
 	_priority_raised = 0;
 }
 
+/* Path of the executable as shown in /proc/self/maps */
+static void _read_self_exe(struct cmd_context *cmd)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+
+	if (dm_snprintf(path, sizeof(path), "%s/self/exe", cmd->proc_dir) < 0) {
+		log_error("proc_dir too long");
+		return;
+	}
+
+	if ((len = readlink(path, _self_exe, sizeof(_self_exe) - 1)) < 0) {
+		log_sys_debug("readlink", path);
+		len = 0;
+	}
+
+	_self_exe[len] = '\0';
+}
+
 /* Stop memory getting swapped out */
 static void _lock_mem(struct cmd_context *cmd)
 {
 	_allocate_memory();
+	_allocate_arena();
 	(void)strerror(0);		/* Force libc.mo load */
 	(void)dm_udev_get_sync_support(); /* udev is initialized */
 	log_very_verbose("Locking memory");
@@ -532,6 +737,13 @@ static void _lock_mem(struct cmd_context *cmd)
 			return;
 		}
 
+		_use_mlock_targeted = find_config_tree_bool(cmd, activation_mlock_targeted_CFG, NULL);
+		if (_use_mlock_targeted) {
+			if (!*_self_exe)
+				_read_self_exe(cmd);
+			_read_loaded_objects();
+		}
+
 		if (!(_maps_fd = open(_procselfmaps, O_RDONLY))) {
 			log_sys_error("open", _procselfmaps);
 			return;
@@ -575,6 +787,8 @@ static void _unlock_mem(struct cmd_context *cmd)
 	_restore_priority_if_possible(cmd);
 
 	_release_memory();
+	_release_loaded_objects();
+	_log_arena();
 }
 
 static void _lock_mem_if_needed(struct cmd_context *cmd)
@@ -621,6 +835,8 @@ void critical_section_inc(struct cmd_context *cmd, const char *reason)
 		_critical_section = 1;
 		log_debug_activation("Entering critical section (%s).", reason);
 		_lock_mem_if_needed(cmd);
+		if (_arena.mem)
+			dm_pool_set_chunk_allocator(_arena_alloc, _arena_free);
 	} else
 		log_debug_activation("Entering prioritized section (%s).", reason);
 
@@ -633,6 +849,8 @@ void critical_section_dec(struct cmd_context *cmd, const char *reason)
 	if (_critical_section && !dm_get_suspended_counter()) {
 		_critical_section = 0;
 		log_debug_activation("Leaving critical section (%s).", reason);
+		if (_arena.mem)
+			dm_pool_set_chunk_allocator(NULL, _arena_free);
 	} else
 		log_debug_activation("Leaving section (%s).", reason);
 
@@ -682,6 +900,9 @@ void memlock_init(struct cmd_context *cmd)
 	_size_stack = 1024ULL * (cmd->threaded ? DEFAULT_RESERVED_STACK :
 				 find_config_tree_int(cmd, activation_reserved_stack_CFG, NULL));
 	_size_malloc_tmp = find_config_tree_int(cmd, activation_reserved_memory_CFG, NULL) * 1024ULL;
+	/* Chunk allocator is process wide, other threads may use pools too. */
+	_size_arena = cmd->threaded ? 0 :
+		find_config_tree_int(cmd, activation_reserved_pool_memory_CFG, NULL) * 1024ULL;
 	_default_priority = find_config_tree_int(cmd, activation_process_priority_CFG, NULL);
 }
 
@@ -693,6 +914,8 @@ void memlock_reset(void)
 	_critical_section = 0;
 	_prioritized_section = 0;
 	_memlock_count_daemon = 0;
+	if (_arena.mem)
+		dm_pool_set_chunk_allocator(NULL, _arena_free);
 }
 
 void memlock_unlock(struct cmd_context *cmd)
@@ -79,6 +79,8 @@ FIELD(LVS, lv, STR_LIST, "Ancestors", lvid, 0, lvancestors, lv_ancestors, "LV an
 FIELD(LVS, lv, STR_LIST, "FAncestors", lvid, 0, lvfullancestors, lv_full_ancestors, "LV ancestors including stored history of the ancestry chain.", 0)
 FIELD(LVS, lv, STR_LIST, "Descendants", lvid, 0, lvdescendants, lv_descendants, "LV descendants ignoring any stored history of the ancestry chain.", 0)
 FIELD(LVS, lv, STR_LIST, "FDescendants", lvid, 0, lvfulldescendants, lv_full_descendants, "LV descendants including stored history of the ancestry chain.", 0)
+FIELD(LVS, lv, STR_LIST, "HotExtents", lvid, 0, lvhotextents, lv_hot_extents, "PV extents of the LV with the most I/O if extent heat tracking is enabled.", 0)
+FIELD(LVS, lv, STR_LIST, "ColdExtents", lvid, 0, lvcoldextents, lv_cold_extents, "PV extents of the LV with the least I/O if extent heat tracking is enabled.", 0)
 FIELD(LVS, lv, NUM, "Mismatches", lvid, 0, raidmismatchcount, raid_mismatch_count, "For RAID, number of mismatches found or repaired.", 0)
 FIELD(LVS, lv, STR, "SyncAction", lvid, 0, raidsyncaction, raid_sync_action, "For RAID, the current synchronization action being performed.", 0)
 FIELD(LVS, lv, NUM, "WBehind", lvid, 0, raidwritebehind, raid_write_behind, "For RAID1, the number of outstanding writes allowed to writemostly devices.", 0)
@@ -96,6 +98,8 @@ FIELD(LVS, lv, STR, "Meta", lvid, 0, metadatalv, metadata_lv, "For thin and cach
 FIELD(LVS, lv, STR, "Meta UUID", lvid, 38, metadatalvuuid, metadata_lv_uuid, "For thin and cache pools, the UUID of the LV holding the associated metadata.", 0)
 FIELD(LVS, lv, STR, "Pool", lvid, 0, poollv, pool_lv, "For thin volumes, the thin pool LV for this volume.", 0)
 FIELD(LVS, lv, STR, "Pool UUID", lvid, 38, poollvuuid, pool_lv_uuid, "For thin volumes, the UUID of the thin pool LV for this volume.", 0)
+FIELD(LVS, lv, SIZ, "Exclusive", lvid, 0, thinexclusivesize, thin_exclusive_size, "For thin volumes, the size of data mapped by no other thin volume of the pool, from a scan of a pool metadata snapshot if the pool is active. Only reported when named explicitly and with file locking.", 0)
+FIELD(LVS, lv, SIZ, "Shared", lvid, 0, thinsharedsize, thin_shared_size, "For thin volumes, the size of data also mapped by other thin volumes of the pool, from a scan of a pool metadata snapshot if the pool is active. Only reported when named explicitly and with file locking.", 0)
 FIELD(LVS, lv, STR_LIST, "LV Tags", tags, 0, tags, lv_tags, "Tags, if any.", 0)
 FIELD(LVS, lv, STR, "LProfile", lvid, 0, lvprofile, lv_profile, "Configuration profile attached to this LV.", 0)
 FIELD(LVS, lv, STR, "LLockArgs", lvid, 0, lvlockargs, lv_lockargs, "Lock args of the LV used by lvmlockd.", 0)
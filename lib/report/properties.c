@@ -322,6 +322,14 @@ GET_LV_NUM_PROPERTY_FN(origin_size, (SECTOR_SIZE * lv_origin_size(lv)))
 #define _lv_ancestors_get prop_not_implemented_get
 #define _lv_full_ancestors_set prop_not_implemented_set
 #define _lv_full_ancestors_get prop_not_implemented_get
+#define _thin_exclusive_size_set prop_not_implemented_set
+#define _thin_exclusive_size_get prop_not_implemented_get
+#define _thin_shared_size_set prop_not_implemented_set
+#define _thin_shared_size_get prop_not_implemented_get
+#define _lv_hot_extents_set prop_not_implemented_set
+#define _lv_hot_extents_get prop_not_implemented_get
+#define _lv_cold_extents_set prop_not_implemented_set
+#define _lv_cold_extents_get prop_not_implemented_get
 #define _lv_descendants_set prop_not_implemented_set
 #define _lv_descendants_get prop_not_implemented_get
 #define _lv_full_descendants_set prop_not_implemented_set
@@ -2052,6 +2052,36 @@ static int _lvancestors_disp(struct dm_report *rh, struct dm_pool *mem,
 	return _field_set_string_list(rh, field, ancestors.result, private, 0, NULL);
 }
 
+/* Number of extents listed by lv_hot_extents and lv_cold_extents. */
+#define EXTENT_HEAT_REPORT_COUNT 8
+
+static int _lvextentheat_disp(struct dm_report *rh, struct dm_pool *mem,
+			      struct dm_report_field *field,
+			      const void *data, void *private, int hottest)
+{
+	const struct logical_volume *lv = (const struct logical_volume *) data;
+	struct dm_list *pes;
+
+	if (!(pes = lv_extent_heat_pes(mem, lv, hottest, EXTENT_HEAT_REPORT_COUNT)))
+		return_0;
+
+	return _field_set_string_list(rh, field, pes, private, 0, NULL);
+}
+
+static int _lvhotextents_disp(struct dm_report *rh, struct dm_pool *mem,
+			      struct dm_report_field *field,
+			      const void *data, void *private)
+{
+	return _lvextentheat_disp(rh, mem, field, data, private, 1);
+}
+
+static int _lvcoldextents_disp(struct dm_report *rh, struct dm_pool *mem,
+			       struct dm_report_field *field,
+			       const void *data, void *private)
+{
+	return _lvextentheat_disp(rh, mem, field, data, private, 0);
+}
+
 static int _lvfullancestors_disp(struct dm_report *rh, struct dm_pool *mem,
 				 struct dm_report_field *field,
 				 const void *data, void *private)
@@ -3227,6 +3257,34 @@ static int _lvmetadatasize_disp(struct dm_report *rh, struct dm_pool *mem,
 	return _field_set_value(field, "", &GET_TYPE_RESERVED_VALUE(num_undef_64));
 }
 
+static int _thinusage_disp(struct dm_report *rh, struct dm_pool *mem,
+			   struct dm_report_field *field,
+			   const void *data, void *private, int exclusive)
+{
+	const struct logical_volume *lv = (const struct logical_volume *) data;
+	uint64_t exclusive_size, shared_size;
+
+	if (lv_is_thin_volume(lv) &&
+	    lv_thin_usage(lv, &exclusive_size, &shared_size))
+		return _size64_disp(rh, mem, field, exclusive ? &exclusive_size : &shared_size, private);
+
+	return _field_set_value(field, "", &GET_TYPE_RESERVED_VALUE(num_undef_64));
+}
+
+static int _thinexclusivesize_disp(struct dm_report *rh, struct dm_pool *mem,
+				   struct dm_report_field *field,
+				   const void *data, void *private)
+{
+	return _thinusage_disp(rh, mem, field, data, private, 1);
+}
+
+static int _thinsharedsize_disp(struct dm_report *rh, struct dm_pool *mem,
+				struct dm_report_field *field,
+				const void *data, void *private)
+{
+	return _thinusage_disp(rh, mem, field, data, private, 0);
+}
+
 static int _thincount_disp(struct dm_report *rh, struct dm_pool *mem,
                          struct dm_report_field *field,
                          const void *data, void *private)
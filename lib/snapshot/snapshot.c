@@ -111,22 +111,22 @@ static int _snap_target_percent(void **target_state __attribute__((unused)),
 				char *params, uint64_t *total_numerator,
 				uint64_t *total_denominator)
 {
-	struct dm_status_snapshot *s;
+	struct dm_status_snapshot s;
 
-	if (!dm_get_status_snapshot(mem, params, &s))
+	if (!dm_get_status_snapshot_into(params, &s))
 		return_0;
 
-	if (s->invalid)
+	if (s.invalid)
 		*percent = DM_PERCENT_INVALID;
-	else if (s->merge_failed)
+	else if (s.merge_failed)
 		*percent = LVM_PERCENT_MERGE_FAILED;
 	else {
-		*total_numerator += s->used_sectors;
-		*total_denominator += s->total_sectors;
-		if (s->has_metadata_sectors &&
-		    s->used_sectors == s->metadata_sectors)
+		*total_numerator += s.used_sectors;
+		*total_denominator += s.total_sectors;
+		if (s.has_metadata_sectors &&
+		    s.used_sectors == s.metadata_sectors)
 			*percent = DM_PERCENT_0;
-		else if (s->used_sectors == s->total_sectors)
+		else if (s.used_sectors == s.total_sectors)
 			*percent = DM_PERCENT_100;
 		else
 			*percent = dm_make_percent(*total_numerator, *total_denominator);
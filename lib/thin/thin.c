@@ -401,31 +401,31 @@ static int _thin_pool_add_target_line(struct dev_manager *dm,
 
 static int _thin_pool_target_percent(void **target_state __attribute__((unused)),
 				     dm_percent_t *percent,
-				     struct dm_pool *mem,
+				     struct dm_pool *mem __attribute__((unused)),
 				     struct cmd_context *cmd __attribute__((unused)),
 				     struct lv_segment *seg,
 				     char *params,
 				     uint64_t *total_numerator,
 				     uint64_t *total_denominator)
 {
-	struct dm_status_thin_pool *s;
+	struct dm_status_thin_pool s;
 
-	if (!dm_get_status_thin_pool(mem, params, &s))
+	if (!dm_get_status_thin_pool_into(params, &s))
 		return_0;
 
-	if (s->fail || s->error)
+	if (s.fail || s.error)
 		*percent = DM_PERCENT_INVALID;
 	/* With 'seg' report metadata percent, otherwice data percent */
 	else if (seg) {
-		*percent = dm_make_percent(s->used_metadata_blocks,
-					   s->total_metadata_blocks);
-		*total_numerator += s->used_metadata_blocks;
-		*total_denominator += s->total_metadata_blocks;
+		*percent = dm_make_percent(s.used_metadata_blocks,
+					   s.total_metadata_blocks);
+		*total_numerator += s.used_metadata_blocks;
+		*total_denominator += s.total_metadata_blocks;
 	} else {
-		*percent = dm_make_percent(s->used_data_blocks,
-					   s->total_data_blocks);
-		*total_numerator += s->used_data_blocks;
-		*total_denominator += s->total_data_blocks;
+		*percent = dm_make_percent(s.used_data_blocks,
+					   s.total_data_blocks);
+		*total_numerator += s.used_data_blocks;
+		*total_denominator += s.total_data_blocks;
 	}
 
 	return 1;
@@ -616,45 +616,45 @@ static int _thin_add_target_line(struct dev_manager *dm,
 
 static int _thin_target_percent(void **target_state __attribute__((unused)),
 				dm_percent_t *percent,
-				struct dm_pool *mem,
+				struct dm_pool *mem __attribute__((unused)),
 				struct cmd_context *cmd __attribute__((unused)),
 				struct lv_segment *seg,
 				char *params,
 				uint64_t *total_numerator,
 				uint64_t *total_denominator)
 {
-	struct dm_status_thin *s;
+	struct dm_status_thin s;
 	uint64_t csize;
 
 	/* Status for thin device is in sectors */
-	if (!dm_get_status_thin(mem, params, &s))
+	if (!dm_get_status_thin_into(params, &s))
 		return_0;
 
-	if (s->fail)
+	if (s.fail)
 		*percent = DM_PERCENT_INVALID;
 	else if (seg) {
 		/* Pool allocates whole chunk so round-up to nearest one */
 		csize = first_seg(seg->pool_lv)->chunk_size;
 		csize = ((seg->lv->size + csize - 1) / csize) * csize;
-		if (s->mapped_sectors > csize) {
+		if (s.mapped_sectors > csize) {
 			log_warn("WARNING: LV %s maps %s while the size is only %s.",
 				 display_lvname(seg->lv),
-				 display_size(cmd, s->mapped_sectors),
+				 display_size(cmd, s.mapped_sectors),
 				 display_size(cmd, csize));
 			/* Don't show nonsense numbers like i.e. 1000% full */
-			s->mapped_sectors = csize;
+			s.mapped_sectors = csize;
 		}
 
-		*percent = dm_make_percent(s->mapped_sectors, csize);
+		*percent = dm_make_percent(s.mapped_sectors, csize);
 		*total_denominator += csize;
 	} else {
 		/* No lv_segment info here */
 		*percent = DM_PERCENT_INVALID;
 		/* FIXME: Using denominator to pass the mapped info upward? */
-		*total_denominator += s->highest_mapped_sector;
+		*total_denominator += s.highest_mapped_sector;
 	}
 
-	*total_numerator += s->mapped_sectors;
+	*total_numerator += s.mapped_sectors;
 
 	return 1;
 }
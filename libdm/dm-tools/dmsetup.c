@@ -301,6 +301,12 @@ static uint64_t _interval = 0; /* configured interval in nsecs */
 static uint64_t _new_interval = 0; /* flag top-of-interval */
 static uint64_t _last_interval = 0; /* approx. measured interval in nsecs */
 
+/* Samples stats of all reported devices once per interval. */
+static struct dm_stats_collector *_stats_collector = NULL;
+
+/* Emit heatmap frames instead of report rows. */
+static int _stats_heatmap_output = 0;
+
 /* Invalid fd value used to signal end-of-reporting. */
 #define TIMER_STOPPED (-2)
 
@@ -859,12 +865,134 @@ out:
 	return r;
 }
 
+/*
+ * Return the collected stats handle for a device, adding the device
+ * to the collector the first time it is reported. *added is set if
+ * the handle has only its first sample.
+ */
+static struct dm_stats *_get_collected_stats(struct dm_info *info, int *added)
+{
+	struct dm_stats *dms;
+
+	*added = 0;
+
+	if ((dms = dm_stats_collector_get_stats(_stats_collector, info->major, info->minor)))
+		return dms;
+
+	if (!(dms = dm_stats_create(DM_STATS_PROGRAM_ID)))
+		return_NULL;
+
+	if (!dm_stats_bind_devno(dms, info->major, info->minor) ||
+	    !dm_stats_collector_add(_stats_collector, dms)) {
+		dm_stats_destroy(dms);
+		return_NULL;
+	}
+
+	*added = 1;
+
+	return dms;
+}
+
+static void _print_json_string(const char *str)
+{
+	putchar('"');
+	for (; *str; str++) {
+		if ((*str == '"') || (*str == '\\'))
+			printf("\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			printf("\\u%04x", (unsigned char) *str);
+		else
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+/*
+ * Print one heatmap frame per region of the device as a single line
+ * of JSON. Each frame is one row of a time x latency matrix: the
+ * latency histogram and I/O counts of every area in the region for
+ * the current interval, with percentile estimates for the region.
+ */
+static int _display_stats_heatmap(struct dm_task *dmt, struct dm_info *info,
+				  struct dm_stats *dms)
+{
+	static const double _percentiles[] = { 50.0, 99.0, 99.9 };
+	static const char * const _percentile_names[] = { "p50", "p99", "p999" };
+	const struct dm_histogram *dmh;
+	uint64_t region_id, area_id, nr_areas, start, len, area_len;
+	int bin, nr_bins;
+	unsigned i;
+
+	dm_stats_foreach_region(dms) {
+		region_id = dm_stats_get_current_region(dms);
+		nr_areas = dm_stats_get_region_nr_areas(dms, region_id);
+		nr_bins = dm_stats_get_region_nr_histogram_bins(dms, region_id);
+
+		if (!dm_stats_get_region_start(dms, &start, region_id) ||
+		    !dm_stats_get_region_len(dms, &len, region_id) ||
+		    !dm_stats_get_region_area_len(dms, &area_len, region_id))
+			return_0;
+
+		printf("{\"interval\":" FMTu64 ",\"interval_ns\":" FMTu64 ",\"name\":",
+		       _interval_num(), dm_stats_get_sampling_interval_ns(dms));
+		_print_json_string(dm_task_get_name(dmt));
+		printf(",\"major\":%d,\"minor\":%d,\"region_id\":" FMTu64
+		       ",\"start\":" FMTu64 ",\"length\":" FMTu64
+		       ",\"area_length\":" FMTu64,
+		       info->major, info->minor, region_id, start, len, area_len);
+
+		if (nr_bins) {
+			if (!(dmh = dm_stats_get_histogram(dms, region_id,
+							   DM_STATS_WALK_REGION)))
+				return_0;
+			printf(",\"bounds\":[");
+			for (bin = 0; bin < nr_bins; bin++)
+				printf("%s" FMTu64, bin ? "," : "",
+				       dm_histogram_get_bin_lower(dmh, bin));
+			putchar(']');
+			for (i = 0; i < DM_ARRAY_SIZE(_percentiles); i++)
+				printf(",\"%s\":" FMTu64, _percentile_names[i],
+				       dm_histogram_get_percentile(dmh, _percentiles[i]));
+		}
+
+		printf(",\"areas\":[");
+		for (area_id = 0; area_id < nr_areas; area_id++) {
+			if (!dm_stats_get_area_start(dms, &start, region_id, area_id))
+				return_0;
+			printf("%s{\"start\":" FMTu64 ",\"ios\":" FMTu64
+			       ",\"sectors\":" FMTu64 ",\"io_ns\":" FMTu64,
+			       area_id ? "," : "", start,
+			       dm_stats_get_reads(dms, region_id, area_id)
+			       + dm_stats_get_writes(dms, region_id, area_id),
+			       dm_stats_get_read_sectors(dms, region_id, area_id)
+			       + dm_stats_get_write_sectors(dms, region_id, area_id),
+			       dm_stats_get_io_nsecs(dms, region_id, area_id));
+			if (nr_bins) {
+				if (!(dmh = dm_stats_get_histogram(dms, region_id, area_id)))
+					return_0;
+				printf(",\"bins\":[");
+				for (bin = 0; bin < nr_bins; bin++)
+					printf("%s" FMTu64, bin ? "," : "",
+					       dm_histogram_get_bin_count(dmh, bin));
+				putchar(']');
+			}
+			putchar('}');
+		}
+		printf("]}\n");
+	}
+
+	fflush(stdout);
+
+	return 1;
+}
+
 static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 {
 	struct dmsetup_report_obj obj;
 	uint64_t walk_flags = _statstype;
 	int r = 0;
 	int selected;
+	int collected = 0, added = 0;
 	char *device_name;
 
 	obj.task = dmt;
@@ -910,7 +1038,29 @@ static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 	 * Obtain statistics for the current reporting object and set
 	 * the interval estimate used for stats rate conversion.
 	 */
-	if (_report_type & DR_STATS) {
+	if ((_report_type & DR_STATS) && _stats_collector) {
+		/*
+		 * Repeating report: the collector sampled the device at
+		 * the start of this interval and set its counters and
+		 * interval to the change since the previous sample.
+		 */
+		if (!(obj.stats = _get_collected_stats(info, &added)))
+			goto_out;
+		collected = 1;
+
+		if (!dm_stats_get_nr_regions(obj.stats)) {
+			log_debug("Skipping %s with no regions.", dm_task_get_name(dmt));
+			r = 1;
+			goto out;
+		}
+
+		/* Update timestamps and handle end-of-interval accounting. */
+		_update_interval_times();
+
+		/* No previous sample: use measured approximation. */
+		if (added)
+			dm_stats_set_sampling_interval_ns(obj.stats, _last_interval);
+	} else if (_report_type & DR_STATS) {
 		if (!(obj.stats = dm_stats_create(DM_STATS_PROGRAM_ID)))
 			goto_out;
 
@@ -949,6 +1099,11 @@ static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 		}
 	}
 
+	if (_stats_heatmap_output) {
+		r = _display_stats_heatmap(dmt, info, obj.stats);
+		goto out;
+	}
+
 	/* group report with no groups? */
 	if ((walk_flags == DM_STATS_WALK_GROUP)
 	    && !dm_stats_get_nr_groups(obj.stats))
@@ -968,7 +1123,7 @@ out:
 		dm_task_destroy(obj.deps_task);
 	if (obj.split_name)
 		_destroy_split_name(obj.split_name);
-	if (obj.stats)
+	if (obj.stats && !collected)
 		dm_stats_destroy(obj.stats);
 	return r;
 }
@@ -3995,6 +4150,45 @@ static int _dm_stats_hist_percent_ranges_disp(struct dm_report *rh,
 	return _stats_hist_percent_disp(rh, field, data, DM_HISTOGRAM_BOUNDS_RANGE);
 }
 
+static int _stats_hist_percentile_disp(struct dm_report *rh,
+				       struct dm_report_field *field, const void *data,
+				       double percentile)
+{
+	const struct dm_stats *dms = (const struct dm_stats *) data;
+	const struct dm_histogram *dmh;
+	uint64_t latency = 0;
+
+	if ((dmh = dm_stats_get_histogram(dms, DM_STATS_REGION_CURRENT,
+					  DM_STATS_AREA_CURRENT)))
+		latency = dm_histogram_get_percentile(dmh, percentile);
+
+	return dm_report_field_uint64(rh, field, &latency);
+}
+
+static int _dm_stats_hist_p50_disp(struct dm_report *rh,
+				   struct dm_pool *mem __attribute__((unused)),
+				   struct dm_report_field *field, const void *data,
+				   void *private __attribute__((unused)))
+{
+	return _stats_hist_percentile_disp(rh, field, data, 50.0);
+}
+
+static int _dm_stats_hist_p99_disp(struct dm_report *rh,
+				   struct dm_pool *mem __attribute__((unused)),
+				   struct dm_report_field *field, const void *data,
+				   void *private __attribute__((unused)))
+{
+	return _stats_hist_percentile_disp(rh, field, data, 99.0);
+}
+
+static int _dm_stats_hist_p999_disp(struct dm_report *rh,
+				    struct dm_pool *mem __attribute__((unused)),
+				    struct dm_report_field *field, const void *data,
+				    void *private __attribute__((unused)))
+{
+	return _stats_hist_percentile_disp(rh, field, data, 99.9);
+}
+
 static int _stats_hist_bounds_disp(struct dm_report *rh,
 				   struct dm_report_field *field, const void *data,
 				   int bounds)
@@ -4626,6 +4820,9 @@ FIELD_F(STATS, STR, "Histogram Counts", 16, dm_stats_hist_count_ranges, "hist_co
 FIELD_F(STATS, STR, "Histogram%", 10, dm_stats_hist_percent, "hist_percent", "Relative latency histogram.")
 FIELD_F(STATS, STR, "Histogram%", 10, dm_stats_hist_percent_bounds, "hist_percent_bounds", "Relative latency histogram with bin boundaries.")
 FIELD_F(STATS, STR, "Histogram%", 10, dm_stats_hist_percent_ranges, "hist_percent_ranges", "Relative latency histogram with bin ranges.")
+FIELD_F(STATS, NUM, "P50Ns", 5, dm_stats_hist_p50, "hist_p50", "Median latency in nanoseconds estimated from the histogram.")
+FIELD_F(STATS, NUM, "P99Ns", 5, dm_stats_hist_p99, "hist_p99", "99th percentile latency in nanoseconds estimated from the histogram.")
+FIELD_F(STATS, NUM, "P999Ns", 6, dm_stats_hist_p999, "hist_p999", "99.9th percentile latency in nanoseconds estimated from the histogram.")
 
 /* Stats interval duration estimates */
 FIELD_F(STATS, NUM, "IntervalNs", 10, dm_stats_sample_interval_ns, "interval_ns", "Sampling interval in nanoseconds.")
@@ -5855,6 +6052,13 @@ out:
 	return r;
 }
 
+static int _stats_heatmap(CMD_ARGS)
+{
+	_stats_heatmap_output = 1;
+
+	return _stats_report(cmd, subcommand, argc, argv, names, multiple_devices);
+}
+
 static int _stats_group(CMD_ARGS)
 {
 	char *name, *alias = NULL, *regions = NULL;
@@ -6158,6 +6362,7 @@ static int _stats_help(CMD_ARGS);
 #define PRINT_OPTS "[--clear] " ALL_PROGS_REGIONS_DEVICES
 #define REPORT_OPTS "[--interval <seconds>] [--count <cnt>]" INDENT \
 "[--units <u>] " SELECT_OPTS INDENT DM_REPORT_OPTS INDENT ALL_PROGS_OPT
+#define HEATMAP_OPTS "[--interval <seconds>] [--count <cnt>]" INDENT ALL_PROGS_OPT
 #define GROUP_OPTS "[--alias NAME] --regions <regions>" INDENT ALL_PROGS_OPT ALL_DEVICES_OPT
 #define UNGROUP_OPTS GROUP_ID_OPT ALL_PROGS_OPT INDENT ALL_DEVICES_OPT
 #define UPDATE_OPTS GROUP_ID_OPT INDENT FILE_MONITOR_OPTS " <file_path>"
@@ -6174,6 +6379,7 @@ static struct command _stats_subcommands[] = {
 	{"create", FILEMAP_OPTS "<file_path>", 0, -1, 1, 0, _stats_create},
 	{"delete", ALL_PROGS_REGIONS_DEVICES, 1, -1, 1, 0, _stats_delete},
 	{"group", GROUP_OPTS, 1, -1, 1, 0, _stats_group},
+	{"heatmap", HEATMAP_OPTS "[<device>...]", 0, -1, 1, 0, _stats_heatmap},
 	{"list", ALL_PROGS_OPT ALL_REGIONS_OPT, 0, -1, 1, 0, _stats_report},
 	{"print", PRINT_OPTS, 0, -1, 1, 0, _stats_print},
 	{"report", REPORT_OPTS "[<device>...]", 0, -1, 1, 0, _stats_report},
@@ -6200,6 +6406,7 @@ static struct command _stats_subcommands[] = {
 #undef FILEMAP_OPTS
 #undef PRINT_OPTS
 #undef REPORT_OPTS
+#undef HEATMAP_OPTS
 #undef GROUP_OPTS
 #undef UNGROUP_OPTS
 
@@ -7410,17 +7617,29 @@ unknown:
 	}
 
 	/* Start interval timer. */
-	if (_count > 1)
+	if (_count > 1) {
 		if (!_start_timer()) {
 			ret = 1;
 			goto_out;
 		}
+		if ((_report_type & DR_STATS) &&
+		    !(_stats_collector = dm_stats_collector_create(_program_id, 2))) {
+			ret = 1;
+			goto_out;
+		}
+	}
 
 doit:
 	multiple_devices = (cmd->repeatable_cmd && argc != 1 &&
 			    (argc || (!_switches[UUID_ARG] && !_switches[MAJOR_ARG])));
 
 	do {
+		/* Sample all devices reported so far in one pass. */
+		if (_stats_collector && !dm_stats_collector_sample(_stats_collector)) {
+			ret = 1;
+			goto_out;
+		}
+
 		r = _perform_command_for_all_repeatable_args(cmd, subcommand, argc, argv, NULL, multiple_devices);
 		if (_concise_output_produced) {
 			putchar('\n');
@@ -7433,7 +7652,9 @@ doit:
 			dm_report_output(_report);
 
 			if (_count > 1 && r) {
-				putchar('\n');
+				/* heatmap frames are one object per line */
+				if (!_stats_heatmap_output)
+					putchar('\n');
 				fflush(stdout);
 				/* wait for --interval and update timestamps */
 				if (!_do_report_wait()) {
@@ -7453,6 +7674,9 @@ out:
 	if (_report)
 		dm_report_free(_report);
 
+	if (_stats_collector)
+		dm_stats_collector_destroy(_stats_collector);
+
 	if (_dtree)
 		dm_tree_free(_dtree);
 
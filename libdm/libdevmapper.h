@@ -398,6 +398,15 @@ struct dm_status_snapshot {
 int dm_get_status_snapshot(struct dm_pool *mem, const char *params,
 			   struct dm_status_snapshot **status);
 
+/*
+ * The _into forms parse into a structure supplied by the caller, without
+ * allocating, for callers polling status repeatedly.  Raid, cache and
+ * mirror status refer to strings and arrays of variable length, so they
+ * are only returned allocated from a pool.
+ */
+int dm_get_status_snapshot_into(const char *params,
+				struct dm_status_snapshot *status);
+
 /* Parse params from STATUS call for thin_pool target */
 typedef enum {
 	DM_THIN_DISCARDS_IGNORE,
@@ -424,6 +433,8 @@ struct dm_status_thin_pool {
 
 int dm_get_status_thin_pool(struct dm_pool *mem, const char *params,
 			    struct dm_status_thin_pool **status);
+int dm_get_status_thin_pool_into(const char *params,
+				 struct dm_status_thin_pool *status);
 
 /* Parse params from STATUS call for thin target */
 struct dm_status_thin {
@@ -435,6 +446,7 @@ struct dm_status_thin {
 
 int dm_get_status_thin(struct dm_pool *mem, const char *params,
 		       struct dm_status_thin **status);
+int dm_get_status_thin_into(const char *params, struct dm_status_thin *status);
 
 /*
  * device-mapper statistics support
@@ -3435,6 +3447,16 @@ dm_percent_t dm_histogram_get_bin_percent(const struct dm_histogram *dmh,
  */
 uint64_t dm_histogram_get_sum(const struct dm_histogram *dmh);
 
+/*
+ * Estimate the latency below which the given percentage (0.0 to 100.0)
+ * of the observations in the histogram fall. The value returned is the
+ * upper bound of the bin containing the requested percentile, or the
+ * lower bound of the final, unbounded bin, in nanoseconds. Returns
+ * zero if the histogram has no observations.
+ */
+uint64_t dm_histogram_get_percentile(const struct dm_histogram *dmh,
+				     double percentile);
+
 /*
  * Histogram formatting flags.
  */
@@ -3476,6 +3498,122 @@ uint64_t dm_histogram_get_sum(const struct dm_histogram *dmh);
 const char *dm_histogram_to_string(const struct dm_histogram *dmh, int bin,
 				   int width, int flags);
 
+/*
+ * Statistics collector.
+ *
+ * A collector samples the regions of many dm_stats handles in one
+ * pass and keeps the last nr_samples samples of every region in a
+ * ring buffer, so that counter deltas can be taken over any number
+ * of past samples without clearing the kernel counters (which would
+ * disturb other readers).
+ *
+ * Samples are stored by column: for each sample and counter the
+ * values of all areas of a region are contiguous, and the delta
+ * methods below fill one array element per area.
+ *
+ * After each sample with a previous one, the handle's own counters
+ * (and histograms) are set to the change over the last interval and
+ * its sampling interval to the measured time between the samples.
+ * The normal dm_stats_get_*() metric methods, reports and walks of
+ * the handle then show per-interval values.
+ */
+struct dm_stats_collector;
+
+/*
+ * Create a collector that keeps nr_samples samples (at least 2) of
+ * each region that belongs to program_id.
+ */
+struct dm_stats_collector *dm_stats_collector_create(const char *program_id,
+						     unsigned nr_samples);
+
+/*
+ * Destroy a collector and all the dm_stats handles added to it.
+ */
+void dm_stats_collector_destroy(struct dm_stats_collector *dsc);
+
+/*
+ * Add a bound dm_stats handle to the collector. The collector lists
+ * its regions, takes a first sample and owns the handle from now on.
+ */
+int dm_stats_collector_add(struct dm_stats_collector *dsc,
+			   struct dm_stats *dms);
+
+/*
+ * Remove a handle from the collector and destroy it.
+ */
+void dm_stats_collector_remove(struct dm_stats_collector *dsc,
+			       struct dm_stats *dms);
+
+/*
+ * Return the handle added to the collector for the device major:minor
+ * (if it was bound with dm_stats_bind_devno()), or NULL.
+ */
+struct dm_stats *dm_stats_collector_get_stats(const struct dm_stats_collector *dsc,
+					      int major, int minor);
+
+/*
+ * Sample every region of every handle added to the collector.
+ *
+ * The region list of a handle is read again if one of its regions
+ * cannot be printed, discarding its stored samples. A handle that
+ * still fails (e.g. the device was removed) is skipped and has no
+ * samples until it can be read again. Returns 0 only if no handle
+ * could be sampled.
+ */
+int dm_stats_collector_sample(struct dm_stats_collector *dsc);
+
+/*
+ * Return the number of samples stored for a handle, at most the
+ * nr_samples given to dm_stats_collector_create().
+ */
+unsigned dm_stats_collector_get_nr_samples(const struct dm_stats_collector *dsc,
+					   const struct dm_stats *dms);
+
+/*
+ * Fill deltas[] (one element per area of region_id) with the change
+ * of counter between the newest sample and the sample lag samples
+ * older, and set *interval_ns to the time between them. lag must be
+ * at least 1 and less than the number of stored samples.
+ *
+ * DM_STATS_IO_IN_PROGRESS_COUNT is not cumulative: its newest value
+ * is returned. A counter that went backwards (the region was cleared)
+ * also returns its newest value.
+ */
+int dm_stats_collector_get_deltas(const struct dm_stats_collector *dsc,
+				  const struct dm_stats *dms, uint64_t region_id,
+				  dm_stats_counter_t counter, unsigned lag,
+				  uint64_t *deltas, uint64_t *interval_ns);
+
+/*
+ * Fill rates[] with the per-second rate of change of counter for
+ * each area of region_id over the last lag samples.
+ */
+int dm_stats_collector_get_rates(const struct dm_stats_collector *dsc,
+				 const struct dm_stats *dms, uint64_t region_id,
+				 dm_stats_counter_t counter, unsigned lag,
+				 double *rates);
+
+/*
+ * Fill util[] with the fraction of time each area of region_id was
+ * busy over the last lag samples.
+ */
+int dm_stats_collector_get_utilization(const struct dm_stats_collector *dsc,
+				       const struct dm_stats *dms, uint64_t region_id,
+				       unsigned lag, dm_percent_t *util);
+
+/*
+ * Fill latency_ns[] with the given percentile (0 to 100) of I/O
+ * latency for each area of region_id over the last lag samples,
+ * taken from the histogram bin counts: the result is the upper bound
+ * of the bin holding the percentile (the lower bound for the last,
+ * unbounded bin) or 0 if there was no I/O. The region must have a
+ * histogram.
+ */
+int dm_stats_collector_get_latency_percentile(const struct dm_stats_collector *dsc,
+					      const struct dm_stats *dms,
+					      uint64_t region_id, unsigned lag,
+					      double percentile, uint64_t *latency_ns);
+
 /*************************
  * config file parse/print
  *************************/
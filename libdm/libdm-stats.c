@@ -48,7 +48,7 @@
 
 #define STATS_ROW_BUF_LEN 4096
 #define STATS_MSG_BUF_LEN 1024
-#define STATS_FIE_BUF_LEN 2048
+#define STATS_FIE_BUF_LEN 65536
 
 #define SECTOR_SHIFT 9L
 
@@ -100,6 +100,7 @@ struct dm_stats_region {
 	uint64_t timescale; /* precise_timestamps is per-region */
 	struct dm_histogram *bounds; /* histogram configuration */
 	struct dm_histogram *histogram; /* aggregate cache */
+	int histogram_stale; /* counters changed since aggregation */
 	struct dm_stats_counters *counters;
 };
 
@@ -108,6 +109,7 @@ struct dm_stats_group {
 	const char *alias;
 	dm_bitset_t regions;
 	struct dm_histogram *histogram;
+	int histogram_stale;
 };
 
 struct dm_stats {
@@ -967,6 +969,7 @@ static int _stats_parse_list_region(struct dm_stats *dms,
 
 	/* clear aggregate cache */
 	region->histogram = NULL;
+	region->histogram_stale = 0;
 
 	region->group_id = DM_STATS_GROUP_NOT_PRESENT;
 
@@ -1025,6 +1028,8 @@ static int _stats_parse_list(struct dm_stats *dms, const char *resp)
 		cur_group.group_id = DM_STATS_GROUP_NOT_PRESENT;
 		cur_group.regions = NULL;
 		cur_group.alias = NULL;
+		cur_group.histogram = NULL;
+		cur_group.histogram_stale = 0;
 
 		if (!_stats_parse_list_region(dms, &cur, line))
 			goto_bad;
@@ -1133,116 +1138,208 @@ bad:
 }
 
 /*
- * Parse histogram data returned from a @stats_print operation.
+ * Parse an unsigned decimal integer from a @stats_print row and
+ * advance *p past it. Only the digits beyond the 19th can overflow
+ * a uint64_t, so the range check is limited to those.
  */
-static int _stats_parse_histogram(struct dm_pool *mem, char *hist_str,
-				  struct dm_histogram **histogram,
-				  struct dm_stats_region *region)
+static int _stats_parse_u64(const char **p, uint64_t *val)
 {
-	static const char _valid_chars[] = "0123456789:";
-	struct dm_histogram *bounds = region->bounds;
-	struct dm_histogram hist = {
-		.nr_bins = region->bounds->nr_bins
-	};
-	const char *c, *v, *val_start;
-	struct dm_histogram_bin cur;
-	uint64_t sum = 0, this_val;
-	char *endptr = NULL;
-	int bin = 0;
+	const char *c = *p, *start = *p;
+	uint64_t v = 0;
+	unsigned d;
 
-	c = hist_str;
+	while ((d = (unsigned) (unsigned char) *c - '0') <= 9) {
+		if ((c - start) >= 19 && (v > (UINT64_MAX - d) / 10))
+			return 0;
+		v = v * 10 + d;
+		c++;
+	}
 
-	if (!dm_pool_begin_object(mem, sizeof(cur)))
-		return_0;
+	if (c == start)
+		return 0;
 
-	if (!dm_pool_grow_object(mem, &hist, sizeof(hist)))
-		goto_bad;
+	*val = v;
+	*p = c;
 
-	do {
-		memset(&cur, 0, sizeof(cur));
-		for (v = _valid_chars; *v; v++)
-			if (*c == *v)
-				break;
-		if (!*v)
-			goto badchar;
+	return 1;
+}
 
-		if (*c == ',')
-			goto badchar;
-		else {
-			val_start = c;
-			endptr = NULL;
+static int _stats_skip_blanks(const char **p)
+{
+	const char *c = *p;
 
-			errno = 0;
-			this_val = strtoull(val_start, &endptr, 10);
-			if (errno || !endptr) {
-				log_error("Could not parse histogram value.");
-				goto bad;
-			}
-			c = endptr; /* Advance to colon, or end. */
+	while (*c == ' ' || *c == '\t')
+		c++;
 
-			if (*c == ':')
-				c++;
-			else if (*c & (*c != '\n'))
-				/* Expected ':', '\n', or NULL. */
-				goto badchar;
+	if (c == *p)
+		return 0;
 
-			if (*c == ':')
-				c++;
+	*p = c;
 
-			cur.upper = bounds->bins[bin].upper;
-			cur.count = this_val;
-			sum += this_val;
+	return 1;
+}
 
-			if (!dm_pool_grow_object(mem, &cur, sizeof(cur)))
-				goto_bad;
+/*
+ * Parse histogram data returned from a @stats_print operation into
+ * the preallocated histogram for one area.
+ */
+static int _stats_parse_histogram(const char **p, struct dm_histogram *hist,
+				  struct dm_stats_region *region)
+{
+	struct dm_histogram *bounds = region->bounds;
+	uint64_t sum = 0, this_val;
+	int bin;
 
-			bin++;
+	if (!_stats_skip_blanks(p))
+		goto badchar;
+
+	for (bin = 0; bin < bounds->nr_bins; bin++) {
+		if (bin) {
+			if (**p != ':')
+				goto badchar;
+			(*p)++;
 		}
-	} while (*c && (*c != '\n'));
+		if (!_stats_parse_u64(p, &this_val)) {
+			log_error("Could not parse histogram value.");
+			return 0;
+		}
+		hist->bins[bin].upper = bounds->bins[bin].upper;
+		hist->bins[bin].count = this_val;
+		sum += this_val;
+	}
 
-	log_debug("Added region histogram data with %d entries.", hist.nr_bins);
+	if (**p && (**p != '\n') && (**p != ' '))
+		goto badchar;
 
-	*histogram = dm_pool_end_object(mem);
-	(*histogram)->sum = sum;
+	hist->nr_bins = bounds->nr_bins;
+	hist->sum = sum;
 
 	return 1;
 
 badchar:
-	log_error("Invalid character in histogram data: '%c' (0x%x)", *c, *c);
-bad:
-	dm_pool_abandon_object(mem);
+	log_error("Invalid character in histogram data: '%c' (0x%x)", **p, **p);
 	return 0;
 }
 
+/*
+ * Parse one area row of a @stats_print response into cur and advance
+ * *p to the histogram data, if any.
+ */
+static int _stats_parse_area(const char **p, uint64_t *start, uint64_t *len,
+			     struct dm_stats_counters *cur)
+{
+	const char *c = *p;
+
+	if (!_stats_parse_u64(&c, start) || (*c++ != '+') ||
+	    !_stats_parse_u64(&c, len))
+		return 0;
+
+#define _STATS_FIELD(field) \
+	if (!_stats_skip_blanks(&c) || !_stats_parse_u64(&c, &cur->field)) \
+		return 0
+
+	_STATS_FIELD(reads);
+	_STATS_FIELD(reads_merged);
+	_STATS_FIELD(read_sectors);
+	_STATS_FIELD(read_nsecs);
+	_STATS_FIELD(writes);
+	_STATS_FIELD(writes_merged);
+	_STATS_FIELD(write_sectors);
+	_STATS_FIELD(write_nsecs);
+	_STATS_FIELD(io_in_progress);
+	_STATS_FIELD(io_nsecs);
+	_STATS_FIELD(weighted_io_nsecs);
+	_STATS_FIELD(total_read_nsecs);
+	_STATS_FIELD(total_write_nsecs);
+
+#undef _STATS_FIELD
+
+	*p = c;
+
+	return 1;
+}
+
+static uint64_t _stats_nr_rows(const char *resp)
+{
+	uint64_t nr_rows = 0;
+
+	while (*resp) {
+		nr_rows++;
+		if (!(resp = strchr(resp, '\n')))
+			break;
+		resp++;
+	}
+
+	return nr_rows;
+}
+
+/*
+ * Test whether the counters table of a region can hold a new
+ * @stats_print response of nr_rows areas: the number of areas and
+ * the histogram bins of every area must be unchanged.
+ */
+static int _stats_counters_reusable(struct dm_stats_region *region,
+				    uint64_t nr_rows)
+{
+	struct dm_histogram *hist;
+
+	if (!region->counters || (_nr_areas_region(region) != nr_rows))
+		return 0;
+
+	hist = region->counters[0].histogram;
+
+	if (!region->bounds)
+		return !hist;
+
+	return hist && (hist->nr_bins == region->bounds->nr_bins);
+}
+
+/*
+ * Parse the @stats_print response for a region into its counters
+ * table, with the histograms of all areas in a single block. The
+ * table of a previous response is overwritten in place when it has
+ * the same shape, so that repeated sampling does not grow the pools.
+ * On failure the table of a reused region is left partially updated:
+ * callers drop the region table in that case.
+ */
 static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 			       struct dm_stats_region *region,
 			       uint64_t timescale)
 {
-	struct dm_histogram *hist = NULL;
-	struct dm_pool *mem = dms->mem;
-	struct dm_stats_counters cur;
-	FILE *stats_rows = NULL;
-	uint64_t start = 0, len = 0;
-	char row[STATS_ROW_BUF_LEN];
-	int r;
+	struct dm_stats_counters *counters, *cur;
+	char *hist_block = NULL;
+	size_t hist_size = 0;
+	uint64_t nr_rows, row, start = 0, len = 0;
+	uint64_t region_start = 0, region_step = 0;
+	const char *c;
+	int reuse;
 
 	if (!resp) {
 		log_error("Could not parse empty @stats_print response.");
 		return 0;
 	}
 
-	region->start = UINT64_MAX;
+	if (!(nr_rows = _stats_nr_rows(resp)))
+		/* no area data read from @stats_print */
+		return_0;
 
-	if (!dm_pool_begin_object(mem, 512))
-		goto_bad;
+	if (region->bounds)
+		hist_size = sizeof(struct dm_histogram) +
+			region->bounds->nr_bins * sizeof(struct dm_histogram_bin);
 
-	/*
-	 * dm_task_get_message_response() returns a 'const char *' but
-	 * since fmemopen also permits "w" it expects a 'char *'.
-	 */
-	stats_rows = fmemopen((char *)resp, strlen(resp), "r");
-	if (!stats_rows)
-		goto_bad;
+	if ((reuse = _stats_counters_reusable(region, nr_rows))) {
+		counters = region->counters;
+		hist_block = (char *) counters[0].histogram;
+	} else {
+		if (!(counters = dm_pool_alloc(dms->mem, nr_rows * sizeof(*counters))))
+			return_0;
+
+		if (hist_size &&
+		    !(hist_block = dm_pool_alloc(dms->hist_mem, nr_rows * hist_size))) {
+			dm_pool_free(dms->mem, counters);
+			return_0;
+		}
+	}
 
 	/*
 	 * Output format for each step-sized area of a region:
@@ -1270,90 +1367,68 @@ static int _stats_parse_region(struct dm_stats *dms, const char *resp,
 	 * 12. the total time spent reading in milliseconds
 	 * 13. the total time spent writing in milliseconds
 	 *
+	 * When the region has histogram bounds, the counters are
+	 * followed by a ':' separated list of histogram bin counts.
 	*/
-	while (fgets(row, sizeof(row), stats_rows)) {
-		r = sscanf(row, FMTu64 "+" FMTu64 /* start+len */
-			   /* reads */
-			   FMTu64 " " FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* writes */
-			   FMTu64 " " FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* in flight & io nsecs */
-			   FMTu64 " " FMTu64 " " FMTu64 " "
-			   /* tot read/write nsecs */
-			   FMTu64 " " FMTu64, &start, &len,
-			   &cur.reads, &cur.reads_merged, &cur.read_sectors,
-			   &cur.read_nsecs,
-			   &cur.writes, &cur.writes_merged, &cur.write_sectors,
-			   &cur.write_nsecs,
-			   &cur.io_in_progress,
-			   &cur.io_nsecs, &cur.weighted_io_nsecs,
-			   &cur.total_read_nsecs, &cur.total_write_nsecs);
-		if (r != 15) {
+	for (c = resp, row = 0; row < nr_rows; row++) {
+		cur = &counters[row];
+
+		if (!_stats_parse_area(&c, &start, &len, cur)) {
 			log_error("Could not parse @stats_print row.");
 			goto bad;
 		}
 
 		/* scale time values up if needed */
 		if (timescale != 1) {
-			cur.read_nsecs *= timescale;
-			cur.write_nsecs *= timescale;
-			cur.io_nsecs *= timescale;
-			cur.weighted_io_nsecs *= timescale;
-			cur.total_read_nsecs *= timescale;
-			cur.total_write_nsecs *= timescale;
+			cur->read_nsecs *= timescale;
+			cur->write_nsecs *= timescale;
+			cur->io_nsecs *= timescale;
+			cur->weighted_io_nsecs *= timescale;
+			cur->total_read_nsecs *= timescale;
+			cur->total_write_nsecs *= timescale;
 		}
 
-		if (region->bounds) {
-			/* Find first histogram separator. */
-			char *hist_str = strchr(row, ':');
-			if (!hist_str) {
-				log_error("Could not parse histogram value.");
-				goto bad;
-			}
-			/* Find space preceding histogram. */
-			while (hist_str && *(hist_str - 1) != ' ')
-				hist_str--;
-
-			/* Use a separate pool for histogram objects since we
-			 * are growing the area table and each area's histogram
-			 * table simultaneously.
-			 */
-			if (!_stats_parse_histogram(dms->hist_mem, hist_str,
-						    &hist, region))
+		if (hist_size) {
+			cur->histogram = (struct dm_histogram *) (hist_block + row * hist_size);
+			if (!_stats_parse_histogram(&c, cur->histogram, region))
 				goto_bad;
-			hist->dms = dms;
-			hist->region = region;
-		}
-
-		cur.histogram = hist;
+			cur->histogram->dms = dms;
+			cur->histogram->region = region;
+		} else
+			cur->histogram = NULL;
 
-		if (!dm_pool_grow_object(mem, &cur, sizeof(cur)))
-			goto_bad;
+		/* Skip anything else on this row. */
+		while (*c && (*c != '\n'))
+			c++;
+		if (*c)
+			c++;
 
-		if (region->start == UINT64_MAX) {
-			region->start = start;
-			region->step = len; /* area size is always uniform. */
+		if (!row) {
+			region_start = start;
+			region_step = len; /* area size is always uniform. */
 		}
 	}
 
-	if (region->start == UINT64_MAX)
-		/* no area data read from @stats_print */
-		goto bad;
-
+	region->start = region_start;
+	region->step = region_step;
 	region->len = (start + len) - region->start;
 	region->timescale = timescale;
-	region->counters = dm_pool_end_object(mem);
+	region->counters = counters;
 
-	if (fclose(stats_rows))
-		stack;
+	/* Aggregate histograms are rebuilt in place on next access. */
+	region->histogram_stale = 1;
+	if (dms->groups && (region->group_id != DM_STATS_GROUP_NOT_PRESENT))
+		dms->groups[region->group_id].histogram_stale = 1;
 
 	return 1;
 
 bad:
-	if (stats_rows)
-		if (fclose(stats_rows))
-			stack;
-	dm_pool_abandon_object(mem);
+	if (reuse)
+		return 0;
+
+	if (hist_block)
+		dm_pool_free(dms->hist_mem, hist_block);
+	dm_pool_free(dms->mem, counters);
 
 	return 0;
 }
@@ -3318,6 +3393,7 @@ static struct dm_histogram *_aggregate_histogram(const struct dm_stats *dms,
 						 uint64_t area_id)
 {
 	struct dm_histogram *dmh_aggr, *dmh_cur, **dmh_cachep;
+	int *stalep;
 	uint64_t group_id = DM_STATS_GROUP_NOT_PRESENT;
 	int bin, nr_bins, group = 1;
 	size_t hist_size;
@@ -3334,11 +3410,13 @@ static struct dm_histogram *_aggregate_histogram(const struct dm_stats *dms,
 		if (!dms->regions[region_id].counters)
 			return dms->regions[region_id].bounds;
 
-		if (dms->regions[region_id].histogram)
+		if (dms->regions[region_id].histogram &&
+		    !dms->regions[region_id].histogram_stale)
 			return dms->regions[region_id].histogram;
 
 		dmh_cur = dms->regions[region_id].counters[0].histogram;
 		dmh_cachep = &dms->regions[region_id].histogram;
+		stalep = &dms->regions[region_id].histogram_stale;
 		nr_bins = dms->regions[region_id].bounds->nr_bins;
 	} else {
 		/* group aggregation */
@@ -3353,18 +3431,23 @@ static struct dm_histogram *_aggregate_histogram(const struct dm_stats *dms,
 		if (!dms->regions[group_id].counters)
 			return dms->regions[group_id].bounds;
 
-		if (dms->groups[group_id].histogram)
+		if (dms->groups[group_id].histogram &&
+		    !dms->groups[group_id].histogram_stale)
 			return dms->groups[group_id].histogram;
 
 		dmh_cur = dms->regions[group_id].counters[0].histogram;
 		dmh_cachep = &dms->groups[group_id].histogram;
+		stalep = &dms->groups[group_id].histogram_stale;
 		nr_bins = dms->regions[group_id].bounds->nr_bins;
 	}
 
 	hist_size = sizeof(*dmh_aggr)
 		     + nr_bins * sizeof(struct dm_histogram_bin);
 
-	if (!(dmh_aggr = dm_pool_zalloc(dms->hist_mem, hist_size))) {
+	if ((dmh_aggr = *dmh_cachep))
+		/* Reuse the stale cached histogram. */
+		memset(dmh_aggr, 0, hist_size);
+	else if (!(dmh_aggr = dm_pool_zalloc(dms->hist_mem, hist_size))) {
 		log_error("Could not allocate group histogram");
 		return 0;
 	}
@@ -3389,6 +3472,7 @@ static struct dm_histogram *_aggregate_histogram(const struct dm_stats *dms,
 
 	/* cache aggregate histogram for subsequent access */
 	*dmh_cachep = dmh_aggr;
+	*stalep = 0;
 
 	return dmh_aggr;
 }
@@ -3476,6 +3560,31 @@ dm_percent_t dm_histogram_get_bin_percent(const struct dm_histogram *dmh,
 	return dm_make_percent((uint64_t) val, total);
 }
 
+uint64_t dm_histogram_get_percentile(const struct dm_histogram *dmh,
+				     double percentile)
+{
+	uint64_t total = dm_histogram_get_sum(dmh), seen = 0;
+	double target;
+	int bin;
+
+	if (!total || (dmh->nr_bins < 2) ||
+	    (percentile < 0.0) || (percentile > 100.0))
+		return 0;
+
+	target = percentile * (double) total / 100.0;
+	for (bin = 0; bin < dmh->nr_bins; bin++) {
+		seen += dmh->bins[bin].count;
+		if ((double) seen >= target)
+			break;
+	}
+
+	/* The last bin has no upper bound: use its lower one. */
+	if (bin >= dmh->nr_bins - 1)
+		bin = dmh->nr_bins - 2;
+
+	return dmh->bins[bin].upper;
+}
+
 /*
  * Histogram string helper functions: used to construct histogram and
  * bin boundary strings from numeric data.
@@ -3839,6 +3948,652 @@ bad:
 	return NULL;
 }
 
+/*
+ * Statistics collector.
+ */
+
+/* Samples of one region: [sample][counter][area] and [sample][area][bin]. */
+struct dm_stats_ring {
+	uint64_t nr_areas;
+	int nr_bins;
+	uint64_t *counters;
+	uint64_t *bins;
+};
+
+struct dm_stats_collected {
+	struct dm_list list;
+	struct dm_stats *dms;
+	uint64_t nr_rings;
+	struct dm_stats_ring *rings; /* indexed by region_id */
+	uint64_t *sample_ns; /* time of each sample since collector creation */
+	uint64_t nr_taken; /* samples taken since the region list was read */
+};
+
+struct dm_stats_collector {
+	char *program_id;
+	unsigned nr_samples;
+	struct dm_timestamp *start;
+	struct dm_timestamp *now;
+	struct dm_hash_table *by_handle;
+	struct dm_hash_table *by_devno;
+	struct dm_list handles;
+};
+
+#define _DEVNO_KEY_LEN 32
+
+static void _devno_key(char *key, int major, int minor)
+{
+	(void) dm_snprintf(key, _DEVNO_KEY_LEN, "%d:%d", major, minor);
+}
+
+static void _stats_collected_free_rings(struct dm_stats_collected *dsh)
+{
+	uint64_t i;
+
+	for (i = 0; i < dsh->nr_rings; i++) {
+		dm_free(dsh->rings[i].counters);
+		dm_free(dsh->rings[i].bins);
+	}
+
+	dm_free(dsh->rings);
+	dsh->rings = NULL;
+	dsh->nr_rings = 0;
+	dsh->nr_taken = 0;
+}
+
+/*
+ * (Re-)read the region list of a handle and size its rings.
+ */
+static int _stats_collected_list(struct dm_stats_collector *dsc,
+				 struct dm_stats_collected *dsh)
+{
+	struct dm_stats *dms = dsh->dms;
+	struct dm_stats_ring *ring;
+	uint64_t i;
+
+	_stats_collected_free_rings(dsh);
+
+	if (!dm_stats_list(dms, dsc->program_id))
+		return_0;
+
+	if (!dms->regions)
+		return 1;
+
+	if (!(dsh->rings = dm_zalloc((dms->max_region + 1) * sizeof(*dsh->rings)))) {
+		log_error("Could not allocate stats collector rings.");
+		return 0;
+	}
+	dsh->nr_rings = dms->max_region + 1;
+
+	for (i = 0; i < dsh->nr_rings; i++) {
+		if (!_stats_region_present(&dms->regions[i]))
+			continue;
+
+		ring = &dsh->rings[i];
+		ring->nr_areas = _nr_areas_region(&dms->regions[i]);
+		if (!(ring->counters = dm_malloc(dsc->nr_samples * DM_STATS_NR_COUNTERS *
+						 ring->nr_areas * sizeof(uint64_t))))
+			goto_bad;
+
+		if (!dms->regions[i].bounds)
+			continue;
+
+		ring->nr_bins = dms->regions[i].bounds->nr_bins;
+		if (!(ring->bins = dm_malloc(dsc->nr_samples * ring->nr_areas *
+					     ring->nr_bins * sizeof(uint64_t))))
+			goto_bad;
+	}
+
+	return 1;
+
+bad:
+	log_error("Could not allocate stats collector samples.");
+	_stats_collected_free_rings(dsh);
+
+	return 0;
+}
+
+/*
+ * Copy the counters just parsed for a region into sample slot.
+ */
+static void _stats_ring_store(struct dm_stats_ring *ring, uint64_t slot,
+			      const struct dm_stats_counters *counters)
+{
+	uint64_t *col = ring->counters + slot * DM_STATS_NR_COUNTERS * ring->nr_areas;
+	uint64_t *bins;
+	uint64_t a;
+	int b;
+
+#define _STORE_COLUMN(counter, field)					\
+	for (a = 0; a < ring->nr_areas; a++)				\
+		col[counter * ring->nr_areas + a] = counters[a].field
+
+	_STORE_COLUMN(DM_STATS_READS_COUNT, reads);
+	_STORE_COLUMN(DM_STATS_READS_MERGED_COUNT, reads_merged);
+	_STORE_COLUMN(DM_STATS_READ_SECTORS_COUNT, read_sectors);
+	_STORE_COLUMN(DM_STATS_READ_NSECS, read_nsecs);
+	_STORE_COLUMN(DM_STATS_WRITES_COUNT, writes);
+	_STORE_COLUMN(DM_STATS_WRITES_MERGED_COUNT, writes_merged);
+	_STORE_COLUMN(DM_STATS_WRITE_SECTORS_COUNT, write_sectors);
+	_STORE_COLUMN(DM_STATS_WRITE_NSECS, write_nsecs);
+	_STORE_COLUMN(DM_STATS_IO_IN_PROGRESS_COUNT, io_in_progress);
+	_STORE_COLUMN(DM_STATS_IO_NSECS, io_nsecs);
+	_STORE_COLUMN(DM_STATS_WEIGHTED_IO_NSECS, weighted_io_nsecs);
+	_STORE_COLUMN(DM_STATS_TOTAL_READ_NSECS, total_read_nsecs);
+	_STORE_COLUMN(DM_STATS_TOTAL_WRITE_NSECS, total_write_nsecs);
+
+#undef _STORE_COLUMN
+
+	if (!ring->bins)
+		return;
+
+	bins = ring->bins + slot * ring->nr_areas * ring->nr_bins;
+	for (a = 0; a < ring->nr_areas; a++, bins += ring->nr_bins)
+		for (b = 0; b < ring->nr_bins; b++)
+			bins[b] = counters[a].histogram->bins[b].count;
+}
+
+static uint64_t *_stats_ring_column(const struct dm_stats_ring *ring, uint64_t slot,
+				    dm_stats_counter_t counter)
+{
+	return ring->counters + (slot * DM_STATS_NR_COUNTERS + counter) * ring->nr_areas;
+}
+
+static uint64_t _stats_delta(uint64_t new_val, uint64_t old_val)
+{
+	return (new_val >= old_val) ? new_val - old_val : new_val;
+}
+
+/*
+ * Set the handle's counters, histograms and interval to the change
+ * between the two newest samples.
+ */
+static void _stats_collected_set_deltas(struct dm_stats_collector *dsc,
+					struct dm_stats_collected *dsh)
+{
+	struct dm_stats *dms = dsh->dms;
+	struct dm_stats_counters *area;
+	struct dm_stats_ring *ring;
+	uint64_t new_slot = (dsh->nr_taken - 1) % dsc->nr_samples;
+	uint64_t old_slot = (dsh->nr_taken - 2) % dsc->nr_samples;
+	const uint64_t *new_col, *old_col, *new_bins, *old_bins;
+	uint64_t i, a, sum;
+	int b;
+
+	for (i = 0; i < dsh->nr_rings; i++) {
+		ring = &dsh->rings[i];
+		if (!ring->counters)
+			continue;
+
+#define _SET_DELTA(counter, field)					\
+		new_col = _stats_ring_column(ring, new_slot, counter);	\
+		old_col = _stats_ring_column(ring, old_slot, counter);	\
+		for (a = 0; a < ring->nr_areas; a++)			\
+			dms->regions[i].counters[a].field = _stats_delta(new_col[a], old_col[a])
+
+		_SET_DELTA(DM_STATS_READS_COUNT, reads);
+		_SET_DELTA(DM_STATS_READS_MERGED_COUNT, reads_merged);
+		_SET_DELTA(DM_STATS_READ_SECTORS_COUNT, read_sectors);
+		_SET_DELTA(DM_STATS_READ_NSECS, read_nsecs);
+		_SET_DELTA(DM_STATS_WRITES_COUNT, writes);
+		_SET_DELTA(DM_STATS_WRITES_MERGED_COUNT, writes_merged);
+		_SET_DELTA(DM_STATS_WRITE_SECTORS_COUNT, write_sectors);
+		_SET_DELTA(DM_STATS_WRITE_NSECS, write_nsecs);
+		_SET_DELTA(DM_STATS_IO_NSECS, io_nsecs);
+		_SET_DELTA(DM_STATS_WEIGHTED_IO_NSECS, weighted_io_nsecs);
+		_SET_DELTA(DM_STATS_TOTAL_READ_NSECS, total_read_nsecs);
+		_SET_DELTA(DM_STATS_TOTAL_WRITE_NSECS, total_write_nsecs);
+
+#undef _SET_DELTA
+
+		if (!ring->bins)
+			continue;
+
+		new_bins = ring->bins + new_slot * ring->nr_areas * ring->nr_bins;
+		old_bins = ring->bins + old_slot * ring->nr_areas * ring->nr_bins;
+		for (a = 0; a < ring->nr_areas; a++) {
+			area = &dms->regions[i].counters[a];
+			sum = 0;
+			for (b = 0; b < ring->nr_bins; b++) {
+				area->histogram->bins[b].count =
+					_stats_delta(new_bins[b], old_bins[b]);
+				sum += area->histogram->bins[b].count;
+			}
+			area->histogram->sum = sum;
+			new_bins += ring->nr_bins;
+			old_bins += ring->nr_bins;
+		}
+	}
+
+	dms->interval_ns = dsh->sample_ns[new_slot] - dsh->sample_ns[old_slot];
+}
+
+/*
+ * Take one sample of every region of a handle. Returns 0 if any
+ * region could not be read or no longer matches the region list.
+ */
+static int _stats_collected_sample(struct dm_stats_collector *dsc,
+				   struct dm_stats_collected *dsh)
+{
+	struct dm_stats *dms = dsh->dms;
+	struct dm_stats_region *region;
+	struct dm_task *dmt;
+	uint64_t i, slot = dsh->nr_taken % dsc->nr_samples;
+	int r;
+
+	for (i = 0; i < dsh->nr_rings; i++) {
+		if (!dsh->rings[i].counters)
+			continue;
+
+		region = &dms->regions[i];
+		if (!(dmt = _stats_print_region(dms, i, 0, 0, 0)))
+			return_0;
+
+		r = _stats_parse_region(dms, dm_task_get_message_response(dmt),
+					region, region->timescale);
+		dm_task_destroy(dmt);
+
+		if (!r || (_nr_areas_region(region) != dsh->rings[i].nr_areas))
+			return_0;
+
+		_stats_ring_store(&dsh->rings[i], slot, region->counters);
+	}
+
+	if (!dm_timestamp_get(dsc->now))
+		return_0;
+
+	dsh->sample_ns[slot] = dm_timestamp_delta(dsc->now, dsc->start);
+
+	if (++dsh->nr_taken > 1)
+		_stats_collected_set_deltas(dsc, dsh);
+
+	return 1;
+}
+
+static int _stats_collected_sample_or_list(struct dm_stats_collector *dsc,
+					   struct dm_stats_collected *dsh)
+{
+	if (dsh->rings && _stats_collected_sample(dsc, dsh))
+		return 1;
+
+	log_debug("Reading stats regions of %s again.", dsh->dms->name ? : "device");
+
+	if (!_stats_collected_list(dsc, dsh) ||
+	    !_stats_collected_sample(dsc, dsh)) {
+		_stats_collected_free_rings(dsh);
+		return_0;
+	}
+
+	return 1;
+}
+
+struct dm_stats_collector *dm_stats_collector_create(const char *program_id,
+						     unsigned nr_samples)
+{
+	struct dm_stats_collector *dsc;
+
+	if (nr_samples < 2) {
+		log_error("A stats collector needs at least 2 samples.");
+		return NULL;
+	}
+
+	if (!(dsc = dm_zalloc(sizeof(*dsc))))
+		return_NULL;
+
+	dm_list_init(&dsc->handles);
+	dsc->nr_samples = nr_samples;
+
+	if (!(dsc->program_id = dm_strdup(program_id ? : DM_STATS_ALL_PROGRAMS)))
+		goto_bad;
+
+	if (!(dsc->start = dm_timestamp_alloc()) ||
+	    !(dsc->now = dm_timestamp_alloc()) ||
+	    !dm_timestamp_get(dsc->start))
+		goto_bad;
+
+	if (!(dsc->by_handle = dm_hash_create(1024)) ||
+	    !(dsc->by_devno = dm_hash_create(1024)))
+		goto_bad;
+
+	return dsc;
+
+bad:
+	dm_stats_collector_destroy(dsc);
+
+	return NULL;
+}
+
+static struct dm_stats_collected *_stats_collected_find(const struct dm_stats_collector *dsc,
+							const struct dm_stats *dms)
+{
+	return dm_hash_lookup_binary(dsc->by_handle, &dms, sizeof(dms));
+}
+
+static void _stats_collected_destroy(struct dm_stats_collector *dsc,
+				     struct dm_stats_collected *dsh)
+{
+	char key[_DEVNO_KEY_LEN];
+
+	dm_hash_remove_binary(dsc->by_handle, &dsh->dms, sizeof(dsh->dms));
+	if (dsh->dms->bind_major >= 0) {
+		_devno_key(key, dsh->dms->bind_major, dsh->dms->bind_minor);
+		if (dm_hash_lookup(dsc->by_devno, key) == dsh)
+			dm_hash_remove(dsc->by_devno, key);
+	}
+
+	dm_list_del(&dsh->list);
+	_stats_collected_free_rings(dsh);
+	dm_stats_destroy(dsh->dms);
+	dm_free(dsh->sample_ns);
+	dm_free(dsh);
+}
+
+void dm_stats_collector_destroy(struct dm_stats_collector *dsc)
+{
+	struct dm_stats_collected *dsh, *tmp;
+
+	if (!dsc)
+		return;
+
+	if (dsc->by_handle)
+		dm_list_iterate_items_safe(dsh, tmp, &dsc->handles)
+			_stats_collected_destroy(dsc, dsh);
+
+	if (dsc->by_handle)
+		dm_hash_destroy(dsc->by_handle);
+	if (dsc->by_devno)
+		dm_hash_destroy(dsc->by_devno);
+	if (dsc->start)
+		dm_timestamp_destroy(dsc->start);
+	if (dsc->now)
+		dm_timestamp_destroy(dsc->now);
+	dm_free(dsc->program_id);
+	dm_free(dsc);
+}
+
+int dm_stats_collector_add(struct dm_stats_collector *dsc, struct dm_stats *dms)
+{
+	struct dm_stats_collected *dsh;
+	char key[_DEVNO_KEY_LEN];
+
+	if (!_stats_bound(dms))
+		return_0;
+
+	if (_stats_collected_find(dsc, dms)) {
+		log_error(INTERNAL_ERROR "Stats handle is already collected.");
+		return 0;
+	}
+
+	if (!(dsh = dm_zalloc(sizeof(*dsh))))
+		return_0;
+
+	dsh->dms = dms;
+
+	if (!(dsh->sample_ns = dm_zalloc(dsc->nr_samples * sizeof(*dsh->sample_ns))))
+		goto_bad;
+
+	if (!_stats_collected_list(dsc, dsh) ||
+	    !_stats_collected_sample(dsc, dsh))
+		goto_bad;
+
+	if (!dm_hash_insert_binary(dsc->by_handle, &dsh->dms, sizeof(dsh->dms), dsh))
+		goto_bad;
+
+	if (dms->bind_major >= 0) {
+		_devno_key(key, dms->bind_major, dms->bind_minor);
+		if (!dm_hash_insert(dsc->by_devno, key, dsh)) {
+			dm_hash_remove_binary(dsc->by_handle, &dsh->dms, sizeof(dsh->dms));
+			goto_bad;
+		}
+	}
+
+	dm_list_add(&dsc->handles, &dsh->list);
+
+	return 1;
+
+bad:
+	_stats_collected_free_rings(dsh);
+	dm_free(dsh->sample_ns);
+	dm_free(dsh);
+
+	return 0;
+}
+
+void dm_stats_collector_remove(struct dm_stats_collector *dsc,
+			       struct dm_stats *dms)
+{
+	struct dm_stats_collected *dsh;
+
+	if ((dsh = _stats_collected_find(dsc, dms)))
+		_stats_collected_destroy(dsc, dsh);
+}
+
+struct dm_stats *dm_stats_collector_get_stats(const struct dm_stats_collector *dsc,
+					      int major, int minor)
+{
+	struct dm_stats_collected *dsh;
+	char key[_DEVNO_KEY_LEN];
+
+	_devno_key(key, major, minor);
+
+	if (!(dsh = dm_hash_lookup(dsc->by_devno, key)))
+		return NULL;
+
+	return dsh->dms;
+}
+
+int dm_stats_collector_sample(struct dm_stats_collector *dsc)
+{
+	struct dm_stats_collected *dsh;
+	unsigned nr_handles = 0, nr_failed = 0;
+
+	dm_list_iterate_items(dsh, &dsc->handles) {
+		nr_handles++;
+		if (!_stats_collected_sample_or_list(dsc, dsh)) {
+			log_debug("Skipping stats sample of %s.", dsh->dms->name ? : "device");
+			nr_failed++;
+		}
+	}
+
+	if (nr_handles && (nr_failed == nr_handles)) {
+		log_error("Could not sample any stats handle.");
+		return 0;
+	}
+
+	return 1;
+}
+
+unsigned dm_stats_collector_get_nr_samples(const struct dm_stats_collector *dsc,
+					   const struct dm_stats *dms)
+{
+	struct dm_stats_collected *dsh;
+
+	if (!(dsh = _stats_collected_find(dsc, dms)))
+		return 0;
+
+	return (dsh->nr_taken < dsc->nr_samples) ? (unsigned) dsh->nr_taken : dsc->nr_samples;
+}
+
+/*
+ * Look up the ring of region_id and the slots of the newest sample
+ * and the one lag samples older.
+ */
+static const struct dm_stats_ring *_stats_collected_ring(const struct dm_stats_collector *dsc,
+							 const struct dm_stats *dms,
+							 uint64_t region_id, unsigned lag,
+							 uint64_t *new_slot, uint64_t *old_slot,
+							 uint64_t *interval_ns)
+{
+	struct dm_stats_collected *dsh;
+
+	if (!(dsh = _stats_collected_find(dsc, dms))) {
+		log_error("Stats handle is not collected.");
+		return NULL;
+	}
+
+	if ((region_id >= dsh->nr_rings) || !dsh->rings[region_id].counters) {
+		log_error("Stats region " FMTu64 " is not collected.", region_id);
+		return NULL;
+	}
+
+	if (!lag || (lag >= dm_stats_collector_get_nr_samples(dsc, dms))) {
+		log_error("Not enough stats samples for a delta over %u.", lag);
+		return NULL;
+	}
+
+	*new_slot = (dsh->nr_taken - 1) % dsc->nr_samples;
+	*old_slot = (dsh->nr_taken - 1 - lag) % dsc->nr_samples;
+	*interval_ns = dsh->sample_ns[*new_slot] - dsh->sample_ns[*old_slot];
+
+	return &dsh->rings[region_id];
+}
+
+int dm_stats_collector_get_deltas(const struct dm_stats_collector *dsc,
+				  const struct dm_stats *dms, uint64_t region_id,
+				  dm_stats_counter_t counter, unsigned lag,
+				  uint64_t *deltas, uint64_t *interval_ns)
+{
+	const struct dm_stats_ring *ring;
+	const uint64_t *new_col, *old_col;
+	uint64_t new_slot, old_slot, a;
+
+	if (counter >= DM_STATS_NR_COUNTERS) {
+		log_error("Attempt to read invalid counter: %d", counter);
+		return 0;
+	}
+
+	if (!(ring = _stats_collected_ring(dsc, dms, region_id, lag,
+					   &new_slot, &old_slot, interval_ns)))
+		return_0;
+
+	new_col = _stats_ring_column(ring, new_slot, counter);
+	old_col = _stats_ring_column(ring, old_slot, counter);
+
+	if (counter == DM_STATS_IO_IN_PROGRESS_COUNT)
+		memcpy(deltas, new_col, ring->nr_areas * sizeof(*deltas));
+	else
+		for (a = 0; a < ring->nr_areas; a++)
+			deltas[a] = _stats_delta(new_col[a], old_col[a]);
+
+	return 1;
+}
+
+int dm_stats_collector_get_rates(const struct dm_stats_collector *dsc,
+				 const struct dm_stats *dms, uint64_t region_id,
+				 dm_stats_counter_t counter, unsigned lag,
+				 double *rates)
+{
+	const struct dm_stats_ring *ring;
+	const uint64_t *new_col, *old_col;
+	uint64_t new_slot, old_slot, interval_ns, a;
+	double secs;
+
+	if (counter >= DM_STATS_NR_COUNTERS) {
+		log_error("Attempt to read invalid counter: %d", counter);
+		return 0;
+	}
+
+	if (!(ring = _stats_collected_ring(dsc, dms, region_id, lag,
+					   &new_slot, &old_slot, &interval_ns)))
+		return_0;
+
+	if (!interval_ns)
+		return_0;
+
+	secs = (double) interval_ns / (double) NSEC_PER_SEC;
+	new_col = _stats_ring_column(ring, new_slot, counter);
+	old_col = _stats_ring_column(ring, old_slot, counter);
+
+	for (a = 0; a < ring->nr_areas; a++)
+		rates[a] = (double) _stats_delta(new_col[a], old_col[a]) / secs;
+
+	return 1;
+}
+
+int dm_stats_collector_get_utilization(const struct dm_stats_collector *dsc,
+				       const struct dm_stats *dms, uint64_t region_id,
+				       unsigned lag, dm_percent_t *util)
+{
+	const struct dm_stats_ring *ring;
+	const uint64_t *new_col, *old_col;
+	uint64_t new_slot, old_slot, interval_ns, io_nsecs, a;
+
+	if (!(ring = _stats_collected_ring(dsc, dms, region_id, lag,
+					   &new_slot, &old_slot, &interval_ns)))
+		return_0;
+
+	if (!interval_ns)
+		return_0;
+
+	new_col = _stats_ring_column(ring, new_slot, DM_STATS_IO_NSECS);
+	old_col = _stats_ring_column(ring, old_slot, DM_STATS_IO_NSECS);
+
+	for (a = 0; a < ring->nr_areas; a++) {
+		/* io_nsecs may exceed the interval slightly: clamp at 100% */
+		io_nsecs = _stats_delta(new_col[a], old_col[a]);
+		util[a] = dm_make_percent((io_nsecs < interval_ns) ? io_nsecs : interval_ns,
+					  interval_ns);
+	}
+
+	return 1;
+}
+
+int dm_stats_collector_get_latency_percentile(const struct dm_stats_collector *dsc,
+					      const struct dm_stats *dms,
+					      uint64_t region_id, unsigned lag,
+					      double percentile, uint64_t *latency_ns)
+{
+	const struct dm_stats_ring *ring;
+	const struct dm_histogram *bounds;
+	const uint64_t *new_bins, *old_bins;
+	uint64_t new_slot, old_slot, interval_ns, a, total, seen;
+	double target;
+	int b;
+
+	if ((percentile < 0.0) || (percentile > 100.0)) {
+		log_error("Invalid latency percentile %f.", percentile);
+		return 0;
+	}
+
+	if (!(ring = _stats_collected_ring(dsc, dms, region_id, lag,
+					   &new_slot, &old_slot, &interval_ns)))
+		return_0;
+
+	if (!ring->bins) {
+		log_error("Stats region " FMTu64 " has no histogram.", region_id);
+		return 0;
+	}
+
+	bounds = dms->regions[region_id].bounds;
+	new_bins = ring->bins + new_slot * ring->nr_areas * ring->nr_bins;
+	old_bins = ring->bins + old_slot * ring->nr_areas * ring->nr_bins;
+
+	for (a = 0; a < ring->nr_areas; a++) {
+		for (total = 0, b = 0; b < ring->nr_bins; b++)
+			total += _stats_delta(new_bins[b], old_bins[b]);
+
+		latency_ns[a] = 0;
+		if (total) {
+			target = percentile * (double) total / 100.0;
+			for (seen = 0, b = 0; b < ring->nr_bins; b++) {
+				seen += _stats_delta(new_bins[b], old_bins[b]);
+				if ((double) seen >= target)
+					break;
+			}
+			if (b < ring->nr_bins - 1)
+				latency_ns[a] = bounds->bins[b].upper;
+			else if (ring->nr_bins > 1)
+				/* The last bin has no upper bound: use its lower one. */
+				latency_ns[a] = bounds->bins[ring->nr_bins - 2].upper;
+		}
+
+		new_bins += ring->nr_bins;
+		old_bins += ring->nr_bins;
+	}
+
+	return 1;
+}
+
 /*
  * A lightweight representation of an extent (region, area, file
  * system block or extent etc.). A table of extents can be used
@@ -3848,10 +4603,12 @@ bad:
 struct _extent {
 	struct dm_list list;
 	uint64_t id;
-	uint64_t start;
+	uint64_t start; /* start and len form the extent's hash key */
 	uint64_t len;
 };
 
+#define _extent_key_len (2 * sizeof(uint64_t))
+
 /* last address in an extent */
 #define _extent_end(a) ((a)->start + (a)->len - 1)
 
@@ -4304,7 +5061,7 @@ static uint64_t _stats_map_extents(int fd, struct dm_pool *mem,
 				   struct fiemap_extent *fm_last,
 				   struct fiemap_extent *fm_pending,
 				   uint64_t next_extent,
-				   int *eof)
+				   int *eof, int *unmapped)
 {
 	uint64_t expected = 0, nr_extents = next_extent;
 	unsigned int i;
@@ -4326,8 +5083,10 @@ static uint64_t _stats_map_extents(int fd, struct dm_pool *mem,
 
 		/* cannot map extents that are not yet allocated. */
 		if (fm_ext[i].fe_flags
-		    & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC))
+		    & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC)) {
+			*unmapped = 1;
 			continue;
+		}
 
 		/*
 		 * Begin a new extent if the current physical address differs
@@ -4396,33 +5155,45 @@ bad:
 static struct _extent *_stats_get_extents_for_file(struct dm_pool *mem, int fd,
 						   uint64_t *count)
 {
-	struct fiemap_extent fm_last = {0}, fm_pending = {0}, *fm_ext = NULL;
+	struct fiemap_extent fm_last, fm_pending, *fm_ext = NULL;
 	struct fiemap *fiemap = NULL;
-	int eof = 0, nr_extents = 0;
+	int eof, nr_extents, unmapped;
 	struct _extent *extents;
 	unsigned long flags = 0;
 	uint64_t *buf;
 
-	/* grow temporary extent table in the pool */
-	if (!dm_pool_begin_object(mem, sizeof(*extents)))
-		return NULL;
-
 	buf = dm_zalloc(STATS_FIE_BUF_LEN);
 	if (!buf) {
 		log_error("Could not allocate memory for FIEMAP buffer.");
-		goto bad;
+		return NULL;
 	}
 
 	/* initialise pointers into the ioctl buffer. */
 	fiemap = (struct fiemap *) buf;
 	fm_ext = &fiemap->fm_extents[0];
 
+	/*
+	 * Map the file without FIEMAP_FLAG_SYNC first: writing back a
+	 * large, busy file only to read its extents is expensive. If any
+	 * extent is not yet allocated on disk, map it again with a sync
+	 * so that no data is left out of the map.
+	 */
+retry:
+	/* grow temporary extent table in the pool */
+	if (!dm_pool_begin_object(mem, sizeof(*extents))) {
+		dm_free(buf);
+		return NULL;
+	}
+
+	memset(&fm_last, 0, sizeof(fm_last));
+	memset(&fm_pending, 0, sizeof(fm_pending));
+	fiemap->fm_start = 0;
+	eof = nr_extents = unmapped = 0;
+
 	/* space available per ioctl */
 	*count = (STATS_FIE_BUF_LEN - sizeof(*fiemap))
 		  / sizeof(struct fiemap_extent);
 
-	flags = FIEMAP_FLAG_SYNC;
-
 	do {
 		/* start of ioctl loop - zero size and set count to bufsize */
 		fiemap->fm_length = ~0ULL;
@@ -4443,7 +5214,7 @@ static struct _extent *_stats_get_extents_for_file(struct dm_pool *mem, int fd,
 
 		nr_extents += _stats_map_extents(fd, mem, fiemap, fm_ext,
 						 &fm_last, &fm_pending,
-						 nr_extents, &eof);
+						 nr_extents, &eof, &unmapped);
 
 		/* check for extent mapping error */
 		if (eof < 0)
@@ -4451,6 +5222,14 @@ static struct _extent *_stats_get_extents_for_file(struct dm_pool *mem, int fd,
 
 	} while (eof == 0);
 
+	if (unmapped && !(flags & FIEMAP_FLAG_SYNC)) {
+		log_very_verbose("Unallocated extents in fd %d: remapping "
+				 "with FIEMAP_FLAG_SYNC.", fd);
+		dm_pool_abandon_object(mem);
+		flags = FIEMAP_FLAG_SYNC;
+		goto retry;
+	}
+
 	if (!nr_extents) {
 		log_error("Cannot map file: no allocated extents.");
 		goto bad;
@@ -4472,19 +5251,6 @@ bad:
 	return NULL;
 }
 
-#define MATCH_EXTENT(e, s, l) \
-(((e).start == (s)) && ((e).len == (l)))
-
-static struct _extent *_find_extent(uint64_t nr_extents, struct _extent *extents,
-				    uint64_t start, uint64_t len)
-{
-	size_t i;
-	for (i = 0; i < nr_extents; i++)
-		if (MATCH_EXTENT(extents[i], start, len))
-			return extents + i;
-	return NULL;
-}
-
 /*
  * Clean up a table of region_id values that were created during a
  * failed dm_stats_create_regions_from_fd, or dm_stats_update_regions_from_fd
@@ -4502,51 +5268,58 @@ static void _stats_cleanup_region_ids(struct dm_stats *dms, uint64_t *regions,
 
 /*
  * First update pass: prune no-longer-allocated extents from the group
- * and build a table of the remaining extents so that their creation
- * can be skipped in the second pass.
+ * and record the region_id of each extent that is still mapped in the
+ * kept table, so that its creation can be skipped in the second pass.
+ *
+ * The new extents are indexed by (start, len) so that the diff costs
+ * one lookup per existing region rather than a scan of the extent table.
  */
-static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
-				struct dm_pool *mem, struct _extent *extents,
-				struct _extent **old_extents, uint64_t *count,
-				int *regroup)
+static int64_t _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
+				    struct _extent *extents, uint64_t count,
+				    uint64_t *kept, int *regroup)
 {
 	struct dm_stats_region *region = NULL;
 	struct dm_stats_group *group = NULL;
+	struct dm_hash_table *extent_hash;
+	struct _extent *ext;
 	uint64_t nr_kept, nr_old;
-	struct _extent ext;
-	int64_t i;
+	int64_t i, r = -1;
 
 	group = &dms->groups[group_id];
 
 	log_very_verbose("Checking for changed file extents in group ID "
 			 FMTu64, group_id);
 
-	if (!dm_pool_begin_object(mem, sizeof(**old_extents))) {
-		log_error("Could not allocate extent table.");
-		return 0;
+	if (!(extent_hash = dm_hash_create(count ? count : 1))) {
+		log_error("Could not allocate extent hash table.");
+		return -1;
+	}
+
+	for (i = 0; i < (int64_t) count; i++) {
+		kept[i] = DM_STATS_REGION_NOT_PRESENT;
+		if (!dm_hash_insert_binary(extent_hash, &extents[i].start,
+					   _extent_key_len, extents + i)) {
+			log_error("Could not index file extents.");
+			goto out;
+		}
 	}
 
 	nr_kept = nr_old = 0; /* counts of old and retained extents */
 
 	/*
-	 * First pass: delete de-allocated extents and set regroup=1 if
-	 * deleting the current group leader.
+	 * Delete de-allocated extents and set regroup=1 if deleting the
+	 * current group leader.
 	 */
 	i = dm_bit_get_last(group->regions);
 	for (; i >= 0; i = dm_bit_get_prev(group->regions, i)) {
 		region = &dms->regions[i];
 		nr_old++;
 
-		if (extents && _find_extent(*count, extents,
-				  region->start, region->len)) {
-			ext.start = region->start;
-			ext.len = region->len;
-			ext.id = i;
+		/* region start and len are laid out as in struct _extent */
+		if ((ext = dm_hash_lookup_binary(extent_hash, &region->start,
+						 _extent_key_len))) {
+			kept[ext - extents] = (uint64_t) i;
 			nr_kept++;
-
-			if (!dm_pool_grow_object(mem, &ext, sizeof(ext)))
-				goto out;
-
 			log_very_verbose("Kept region " FMTu64, i);
 		} else {
 
@@ -4563,20 +5336,15 @@ static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
 		}
 	}
 
-	*old_extents = dm_pool_end_object(mem);
-	if (!*old_extents) {
-		log_error("Could not finalize region extent table.");
-		goto out;
-	}
-	log_very_verbose("Kept " FMTd64 " of " FMTd64 " old extents",
+	log_very_verbose("Kept " FMTu64 " of " FMTu64 " old extents",
 			 nr_kept, nr_old);
 	log_very_verbose("Found " FMTu64 " new extents",
-			 *count - nr_kept);
+			 count - nr_kept);
 
-	return (int) nr_kept;
+	r = (int64_t) nr_kept;
 out:
-	dm_pool_abandon_object(mem);
-	return -1;
+	dm_hash_destroy(extent_hash);
+	return r;
 }
 
 /*
@@ -4595,11 +5363,10 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 					 int precise, uint64_t group_id,
 					 uint64_t *count, int *regroup)
 {
-	struct _extent *extents = NULL, *old_extents = NULL;
-	uint64_t *regions = NULL, fail_region, i, num_bits;
+	uint64_t *regions = NULL, *kept = NULL, fail_region, i, num_bits;
 	struct dm_stats_group *group = NULL;
 	struct dm_pool *extent_mem = NULL;
-	struct _extent *old_ext;
+	struct _extent *extents = NULL;
 	char *hist_arg = NULL;
 	struct statfs fsbuf;
 	int64_t nr_kept = 0;
@@ -4665,9 +5432,13 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 
 	if (update) {
 		group = &dms->groups[group_id];
-		if ((nr_kept = _stats_unmap_regions(dms, group_id, extent_mem,
-						     extents, &old_extents,
-						     count, regroup)) < 0)
+		if (*count && !(kept = dm_pool_alloc(extent_mem,
+						     *count * sizeof(*kept)))) {
+			log_error("Could not allocate kept region table.");
+			goto out;
+		}
+		if ((nr_kept = _stats_unmap_regions(dms, group_id, extents,
+						    *count, kept, regroup)) < 0)
 			goto_out;
 	}
 
@@ -4690,14 +5461,9 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 	 * created regions in the group leader bitmap.
 	 */
 	for (i = 0; i < *count; i++) {
-		if (update) {
-			if ((old_ext = _find_extent((uint64_t) nr_kept,
-						    old_extents,
-						    extents[i].start,
-						    extents[i].len))) {
-				regions[i] = old_ext->id;
-				continue;
-			}
+		if (update && (kept[i] != DM_STATS_REGION_NOT_PRESENT)) {
+			regions[i] = kept[i];
+			continue;
 		}
 		if (!_stats_create_region(dms, regions + i, extents[i].start,
 					  extents[i].len, -1, precise, hist_arg,
@@ -15,28 +15,169 @@
 #include "libdm/misc/dmlib.h"
 #include "libdm-common.h"
 
-int dm_get_status_snapshot(struct dm_pool *mem, const char *params,
-			   struct dm_status_snapshot **status)
+/*
+ * Status tokenising helpers.
+ *
+ * Each helper consumes a single token from *p, skipping any leading
+ * blanks, and returns 0 without advancing *p if the token is missing or
+ * malformed. Parsers built from them walk a status line once, and read
+ * into a local structure before allocating the result in one piece.
+ */
+static int _is_blank(char c)
 {
-	struct dm_status_snapshot *s;
-	int r;
+	return (c == ' ') || (c == '\t') || (c == '\n');
+}
 
-	if (!params) {
-		log_error("Failed to parse invalid snapshot params.");
+static const char *_skip_blanks(const char *p)
+{
+	while (_is_blank(*p))
+		p++;
+
+	return p;
+}
+
+static int _read_u64(const char **p, uint64_t *val)
+{
+	const char *s = _skip_blanks(*p);
+	uint64_t v = 0;
+	unsigned d;
+
+	if ((*s < '0') || (*s > '9'))
 		return 0;
+
+	for (; (*s >= '0') && (*s <= '9'); s++) {
+		d = (unsigned) (*s - '0');
+		if (v > (UINT64_MAX - d) / 10)
+			return 0;	/* overflow */
+		v = v * 10 + d;
 	}
 
-	if (!(s = dm_pool_zalloc(mem, sizeof(*s)))) {
-		log_error("Failed to allocate snapshot status structure.");
+	*val = v;
+	*p = s;
+
+	return 1;
+}
+
+static int _read_u32(const char **p, uint32_t *val)
+{
+	const char *s = *p;
+	uint64_t v;
+
+	if (!_read_u64(&s, &v) || (v > UINT32_MAX))
+		return 0;
+
+	*val = (uint32_t) v;
+	*p = s;
+
+	return 1;
+}
+
+/* Read a count: a non-negative int. */
+static int _read_count(const char **p, int *val)
+{
+	const char *s = *p;
+	uint64_t v;
+
+	if (!_read_u64(&s, &v) || (v > INT_MAX))
+		return 0;
+
+	*val = (int) v;
+	*p = s;
+
+	return 1;
+}
+
+static int _read_char(const char **p, char c)
+{
+	if (**p != c)
+		return 0;
+
+	(*p)++;
+
+	return 1;
+}
+
+/* Read a blank-delimited word without copying it. */
+static int _read_word(const char **p, const char **word, size_t *len)
+{
+	const char *s = _skip_blanks(*p), *e = s;
+
+	while (*e && !_is_blank(*e))
+		e++;
+
+	if (e == s)
+		return 0;
+
+	*word = s;
+	*len = (size_t) (e - s);
+	*p = e;
+
+	return 1;
+}
+
+static int _word_is(const char *word, size_t len, const char *str)
+{
+	return !strncmp(word, str, len) && !str[len];
+}
+
+/* Read a <major>:<minor> device number. */
+static int _read_dev(const char **p, uint32_t *major, uint32_t *minor)
+{
+	const char *s = *p;
+
+	if (!_read_u32(&s, major) || !_read_char(&s, ':') || !_read_u32(&s, minor))
 		return 0;
-	}
 
-	r = sscanf(params, FMTu64 "/" FMTu64 " " FMTu64,
-		   &s->used_sectors, &s->total_sectors,
-		   &s->metadata_sectors);
+	*p = s;
 
-	if (r == 3 || r == 2)
-		s->has_metadata_sectors = (r == 3);
+	return 1;
+}
+
+/* Read a <used>/<total> ratio. */
+static int _read_ratio(const char **p, uint64_t *used, uint64_t *total)
+{
+	const char *s = *p;
+
+	if (!_read_u64(&s, used) || !_read_char(&s, '/') || !_read_u64(&s, total))
+		return 0;
+
+	*p = s;
+
+	return 1;
+}
+
+/* Terminate the next word of a copied status string in place. */
+static char *_split_word(char **p)
+{
+	char *s = *p, *e;
+
+	while (_is_blank(*s))
+		s++;
+
+	for (e = s; *e && !_is_blank(*e); e++)
+		;
+
+	if (*e)
+		*e++ = '\0';
+
+	*p = e;
+
+	return s;
+}
+
+int dm_get_status_snapshot_into(const char *params, struct dm_status_snapshot *s)
+{
+	const char *p = params;
+
+	memset(s, 0, sizeof(*s));
+
+	if (!params) {
+		log_error("Failed to parse invalid snapshot params.");
+		return 0;
+	}
+
+	if (_read_ratio(&p, &s->used_sectors, &s->total_sectors))
+		s->has_metadata_sectors = _read_u64(&p, &s->metadata_sectors);
 	else if (!strcmp(params, "Invalid"))
 		s->invalid = 1;
 	else if (!strcmp(params, "Merge failed"))
@@ -44,43 +185,31 @@ int dm_get_status_snapshot(struct dm_pool *mem, const char *params,
 	else if (!strcmp(params, "Overflow"))
 		s->overflow = 1;
 	else {
-		dm_pool_free(mem, s);
 		log_error("Failed to parse snapshot params: %s.", params);
 		return 0;
 	}
 
-	*status = s;
-
 	return 1;
 }
 
-/*
- * Skip nr fields each delimited by a single space.
- * FIXME Don't assume single space.
- */
-static const char *_skip_fields(const char *p, unsigned nr)
-{
-	while (p && nr-- && (p = strchr(p, ' ')))
-		p++;
-
-	return p;
-}
-
-/*
- * Count number of single-space delimited fields.
- * Number of fields is number of spaces plus one.
- */
-static unsigned _count_fields(const char *p)
+int dm_get_status_snapshot(struct dm_pool *mem, const char *params,
+			   struct dm_status_snapshot **status)
 {
-	unsigned nr = 1;
+	struct dm_status_snapshot *s;
 
-	if (!p || !*p)
+	if (!(s = dm_pool_alloc(mem, sizeof(*s)))) {
+		log_error("Failed to allocate snapshot status structure.");
 		return 0;
+	}
 
-	while ((p = _skip_fields(p, 1)))
-		nr++;
+	if (!dm_get_status_snapshot_into(params, s)) {
+		dm_pool_free(mem, s);
+		return_0;
+	}
+
+	*status = s;
 
-	return nr;
+	return 1;
 }
 
 /*
@@ -95,88 +224,85 @@ static unsigned _count_fields(const char *p)
 int dm_get_status_raid(struct dm_pool *mem, const char *params,
 		       struct dm_status_raid **status)
 {
-	int i;
-	unsigned num_fields;
-	const char *p, *pp, *msg_fields = "";
-	struct dm_status_raid *s = NULL;
-	unsigned a = 0;
-
-	if ((num_fields = _count_fields(params)) < 4)
-		goto_bad;
-
-	/* Second field holds the device count */
-	msg_fields = "<#devs> ";
-	if (!(p = _skip_fields(params, 1)) || (sscanf(p, "%d", &i) != 1))
-		goto_bad;
-
-	msg_fields = "";
-	if (!(s = dm_pool_zalloc(mem, sizeof(struct dm_status_raid))))
-		goto_bad;
-
-	if (!(s->raid_type = dm_pool_zalloc(mem, p - params)))
-		goto_bad; /* memory is freed when pool is destroyed */
-
-	if (!(s->dev_health = dm_pool_zalloc(mem, i + 1))) /* Space for health chars */
-		goto_bad;
+	const char *p = params, *q, *msg_fields = "";
+	const char *raid_type, *health, *action = NULL;
+	size_t type_len, health_len, action_len = 0, size;
+	struct dm_status_raid st = { 0 }, *s;
+	char *str;
+	unsigned a = 0, i;
 
 	msg_fields = "<raid_type> <#devices> <health_chars> and <sync_ratio> ";
-	if (sscanf(params, "%s %u %s " FMTu64 "/" FMTu64,
-		   s->raid_type,
-		   &s->dev_count,
-		   s->dev_health,
-		   &s->insync_regions,
-		   &s->total_regions) != 5)
+	if (!params ||
+	    !_read_word(&p, &raid_type, &type_len) ||
+	    !_read_u32(&p, &st.dev_count) ||
+	    !_read_word(&p, &health, &health_len) ||
+	    !_read_ratio(&p, &st.insync_regions, &st.total_regions))
 		goto_bad;
 
 	/*
-	 * All pre-1.5.0 version parameters are read.  Now we check
-	 * for additional 1.5.0+ parameters (i.e. num_fields at least 6).
+	 * All pre-1.5.0 version parameters are read. A 1.5.0+ status adds
+	 * <sync_action> and <mismatch_cnt>: a lone extra field is ignored.
 	 *
 	 * Note that 'sync_action' will be NULL (and mismatch_count
 	 * will be 0) if the kernel returns a pre-1.5.0 status.
 	 */
-	if (num_fields < 6)
-		goto out;
-
 	msg_fields = "<sync_action> and <mismatch_cnt> ";
-
-	/* Skip pre-1.5.0 params */
-	if (!(p = _skip_fields(params, 4)) || !(pp = _skip_fields(p, 1)))
-		goto_bad;
-
-	if (!(s->sync_action = dm_pool_zalloc(mem, pp - p)))
-		goto_bad;
-
-	if (sscanf(p, "%s " FMTu64, s->sync_action, &s->mismatch_count) != 2)
-		goto_bad;
-
-	if (num_fields < 7)
-		goto out;
+	q = p;
+	if (_read_word(&q, &action, &action_len)) {
+		if (_read_u64(&q, &st.mismatch_count))
+			p = q;
+		else if (!*_skip_blanks(q))
+			action = NULL;
+		else
+			goto_bad;
+	}
 
 	/*
-	 * All pre-1.9.0 version parameters are read.  Now we check
-	 * for additional 1.9.0+ parameters (i.e. nr_fields at least 7).
-	 *
 	 * Note that data_offset will be 0 if the
 	 * kernel returns a pre-1.9.0 status.
 	 */
 	msg_fields = "<data_offset>";
-	if (!(p = _skip_fields(params, 6))) /* skip pre-1.9.0 params */
-		goto bad;
-	if (sscanf(p, FMTu64, &s->data_offset) != 1)
+	if (action && *_skip_blanks(p) && !_read_u64(&p, &st.data_offset))
 		goto bad;
 
-out:
+	/* Allocate the status and its strings together. */
+	size = sizeof(st) + type_len + health_len + 2;
+	if (action)
+		size += action_len + 1;
+
+	msg_fields = "";
+	if (!(s = dm_pool_alloc(mem, size)))
+		goto_bad;
+
+	*s = st;
+	str = (char *) (s + 1);
+
+	s->raid_type = str;
+	memcpy(str, raid_type, type_len);
+	str[type_len] = '\0';
+	str += type_len + 1;
+
+	s->dev_health = str;
+	memcpy(str, health, health_len);
+	str[health_len] = '\0';
+	str += health_len + 1;
+
+	if (action) {
+		s->sync_action = str;
+		memcpy(str, action, action_len);
+		str[action_len] = '\0';
+	}
+
 	*status = s;
 
 	if (s->insync_regions == s->total_regions) {
 		/* FIXME: kernel gives misleading info here
 		 * Trying to recognize a true state */
-		while (i-- > 0)
+		for (i = 0; (i < s->dev_count) && (i < health_len); i++)
 			if (s->dev_health[i] == 'a')
 				a++; /* Count number of 'a' */
 
-		if (a && a < s->dev_count) {
+		if (a && a < s->dev_count && s->sync_action) {
 			/* SOME legs are in 'a' */
 			if (!strcasecmp(s->sync_action, "recover")
 			    || !strcasecmp(s->sync_action, "idle"))
@@ -191,9 +317,6 @@ out:
 bad:
 	log_error("Failed to parse %sraid params: %s", msg_fields, params);
 
-	if (s)
-		dm_pool_free(mem, s);
-
 	*status = NULL;
 
 	return 0;
@@ -241,106 +364,120 @@ bad:
 int dm_get_status_cache(struct dm_pool *mem, const char *params,
 			struct dm_status_cache **status)
 {
-	int i, feature_argc;
+	struct dm_status_cache st = { 0 }, *s;
+	const char *p = params, *word, *args;
 	char *str;
-	const char *p, *pp;
-	struct dm_status_cache *s;
+	size_t len, args_len;
+	int i, feature_argc;
 
-	if (!(s = dm_pool_zalloc(mem, sizeof(struct dm_status_cache))))
-		return_0;
+	if (!params)
+		goto bad;
 
 	if (strstr(params, "Error")) {
-		s->error = 1;
-		s->fail = 1; /*  This is also I/O fail state */
+		st.error = 1;
+		st.fail = 1; /*  This is also I/O fail state */
+		args_len = 0;
 		goto out;
 	}
 
 	if (strstr(params, "Fail")) {
-		s->fail = 1;
+		st.fail = 1;
+		args_len = 0;
 		goto out;
 	}
 
 	/* Read in args that have definitive placement */
-	if (sscanf(params,
-		   " " FMTu32
-		   " " FMTu64 "/" FMTu64
-		   " " FMTu32
-		   " " FMTu64 "/" FMTu64
-		   " " FMTu64 " " FMTu64
-		   " " FMTu64 " " FMTu64
-		   " " FMTu64 " " FMTu64
-		   " " FMTu64
-		   " %d",
-		   &s->metadata_block_size,
-		   &s->metadata_used_blocks, &s->metadata_total_blocks,
-		   &s->block_size, /* AKA, chunk_size */
-		   &s->used_blocks, &s->total_blocks,
-		   &s->read_hits, &s->read_misses,
-		   &s->write_hits, &s->write_misses,
-		   &s->demotions, &s->promotions,
-		   &s->dirty_blocks,
-		   &feature_argc) != 14)
-		goto bad;
-
-	/* Now jump to "features" section */
-	if (!(p = _skip_fields(params, 12)))
+	if (!_read_u32(&p, &st.metadata_block_size) ||
+	    !_read_ratio(&p, &st.metadata_used_blocks, &st.metadata_total_blocks) ||
+	    !_read_u32(&p, &st.block_size) || /* AKA, chunk_size */
+	    !_read_ratio(&p, &st.used_blocks, &st.total_blocks) ||
+	    !_read_u64(&p, &st.read_hits) || !_read_u64(&p, &st.read_misses) ||
+	    !_read_u64(&p, &st.write_hits) || !_read_u64(&p, &st.write_misses) ||
+	    !_read_u64(&p, &st.demotions) || !_read_u64(&p, &st.promotions) ||
+	    !_read_u64(&p, &st.dirty_blocks) ||
+	    !_read_count(&p, &feature_argc))
 		goto bad;
 
 	/* Read in features */
 	for (i = 0; i < feature_argc; i++) {
-		if (!strncmp(p, "writethrough ", 13))
-			s->feature_flags |= DM_CACHE_FEATURE_WRITETHROUGH;
-		else if (!strncmp(p, "writeback ", 10))
-			s->feature_flags |= DM_CACHE_FEATURE_WRITEBACK;
-		else if (!strncmp(p, "passthrough ", 12))
-			s->feature_flags |= DM_CACHE_FEATURE_PASSTHROUGH;
-		else if (!strncmp(p, "metadata2 ", 10))
-			s->feature_flags |= DM_CACHE_FEATURE_METADATA2;
+		if (!_read_word(&p, &word, &len))
+			goto bad;
+
+		if (_word_is(word, len, "writethrough"))
+			st.feature_flags |= DM_CACHE_FEATURE_WRITETHROUGH;
+		else if (_word_is(word, len, "writeback"))
+			st.feature_flags |= DM_CACHE_FEATURE_WRITEBACK;
+		else if (_word_is(word, len, "passthrough"))
+			st.feature_flags |= DM_CACHE_FEATURE_PASSTHROUGH;
+		else if (_word_is(word, len, "metadata2"))
+			st.feature_flags |= DM_CACHE_FEATURE_METADATA2;
 		else
 			log_error("Unknown feature in status: %s", params);
-
-		if (!(p = _skip_fields(p, 1)))
-			goto bad;
 	}
 
-	/* Read in core_args. */
-	if (sscanf(p, "%d ", &s->core_argc) != 1)
-		goto bad;
-	if ((s->core_argc > 0) &&
-	    (!(s->core_argv = dm_pool_zalloc(mem, sizeof(char *) * s->core_argc)) ||
-	     !(p = _skip_fields(p, 1)) ||
-	     !(str = dm_pool_strdup(mem, p)) ||
-	     !(p = _skip_fields(p, (unsigned) s->core_argc)) ||
-	     (dm_split_words(str, s->core_argc, 0, s->core_argv) != s->core_argc)))
+	/*
+	 * Core args, policy name and policy args are copied as one
+	 * string and split in place once their extent is known.
+	 */
+	if (!_read_count(&p, &st.core_argc))
 		goto bad;
+	args = _skip_blanks(p);
+	for (i = 0; i < st.core_argc; i++)
+		if (!_read_word(&p, &word, &len))
+			goto bad;
 
-	/* Read in policy args */
-	pp = p;
-	if (!(p = _skip_fields(p, 1)) ||
-	    !(s->policy_name = dm_pool_zalloc(mem, (p - pp))))
-		goto bad;
-	if (sscanf(pp, "%s %d", s->policy_name, &s->policy_argc) != 2)
+	if (!_read_word(&p, &word, &len) ||
+	    !_read_count(&p, &st.policy_argc))
 		goto bad;
-	if (s->policy_argc &&
-	    (!(s->policy_argv = dm_pool_zalloc(mem, sizeof(char *) * s->policy_argc)) ||
-	     !(p = _skip_fields(p, 1)) ||
-	     !(str = dm_pool_strdup(mem, p)) ||
-	     (dm_split_words(str, s->policy_argc, 0, s->policy_argv) != s->policy_argc)))
-		goto bad;
-
-	/* TODO: improve this parser */
-	if (strstr(p, " ro"))
-		s->read_only = 1;
+	for (i = 0; i < st.policy_argc; i++)
+		if (!_read_word(&p, &word, &len))
+			goto bad;
+	args_len = (size_t) (p - args);
+
+	/* Remaining fields: metadata mode and needs_check. */
+	while (_read_word(&p, &word, &len)) {
+		if (_word_is(word, len, "ro"))
+			st.read_only = 1;
+		else if (_word_is(word, len, "needs_check"))
+			st.needs_check = 1;
+	}
 
-	if (strstr(p, " needs_check"))
-		s->needs_check = 1;
 out:
+	len = sizeof(st);
+	if (args_len)
+		len += (size_t) (st.core_argc + st.policy_argc) * sizeof(char *) +
+			args_len + 1;
+
+	if (!(s = dm_pool_alloc(mem, len)))
+		return_0;
+
+	*s = st;
+
+	if (args_len) {
+		str = (char *) (s + 1) + (size_t) (st.core_argc + st.policy_argc) * sizeof(char *);
+		memcpy(str, args, args_len);
+		str[args_len] = '\0';
+
+		if (st.core_argc)
+			s->core_argv = (char **) (s + 1);
+		for (i = 0; i < st.core_argc; i++)
+			s->core_argv[i] = _split_word(&str);
+
+		s->policy_name = _split_word(&str);
+		(void) _split_word(&str); /* #policy args */
+
+		if (st.policy_argc)
+			s->policy_argv = (char **) (s + 1) + st.core_argc;
+		for (i = 0; i < st.policy_argc; i++)
+			s->policy_argv[i] = _split_word(&str);
+	}
+
 	*status = s;
+
 	return 1;
 
 bad:
 	log_error("Failed to parse cache params: %s", params);
-	dm_pool_free(mem, s);
 	*status = NULL;
 
 	return 0;
@@ -348,7 +485,8 @@ bad:
 
 int parse_thin_pool_status(const char *params, struct dm_status_thin_pool *s)
 {
-	int pos;
+	const char *p = params, *word;
+	size_t len;
 
 	memset(s, 0, sizeof(*s));
 
@@ -368,41 +506,46 @@ int parse_thin_pool_status(const char *params, struct dm_status_thin_pool *s)
 		return 1;
 	}
 
-	/* FIXME: add support for held metadata root */
-	if (sscanf(params, FMTu64 " " FMTu64 "/" FMTu64 " " FMTu64 "/" FMTu64 "%n",
-		   &s->transaction_id,
-		   &s->used_metadata_blocks,
-		   &s->total_metadata_blocks,
-		   &s->used_data_blocks,
-		   &s->total_data_blocks, &pos) < 5) {
+	if (!_read_u64(&p, &s->transaction_id) ||
+	    !_read_ratio(&p, &s->used_metadata_blocks, &s->total_metadata_blocks) ||
+	    !_read_ratio(&p, &s->used_data_blocks, &s->total_data_blocks)) {
 		log_error("Failed to parse thin pool params: %s.", params);
 		return 0;
 	}
 
+	/* Held metadata root, or '-' if none is held. */
+	(void) _read_u64(&p, &s->held_metadata_root);
+
+	/* Default is discard_passdown, 'writable' (rw) data and 'queue_if_no_space' */
+	s->discards = DM_THIN_DISCARDS_PASSDOWN;
+
 	/* New status flags */
-	if (strstr(params + pos, "no_discard_passdown"))
-		s->discards = DM_THIN_DISCARDS_NO_PASSDOWN;
-	else if (strstr(params + pos, "ignore_discard"))
-		s->discards = DM_THIN_DISCARDS_IGNORE;
-	else /* default discard_passdown */
-		s->discards = DM_THIN_DISCARDS_PASSDOWN;
-
-	/* Default is 'writable' (rw) data */
-	if (strstr(params + pos, "out_of_data_space"))
-		s->out_of_data_space = 1;
-	else if (strstr(params + pos, "ro "))
-		s->read_only = 1;
-
-	/* Default is 'queue_if_no_space' */
-	if (strstr(params + pos, "error_if_no_space"))
-		s->error_if_no_space = 1;
-
-	if (strstr(params + pos, "needs_check"))
-		s->needs_check = 1;
+	while (_read_word(&p, &word, &len)) {
+		if (_word_is(word, len, "no_discard_passdown"))
+			s->discards = DM_THIN_DISCARDS_NO_PASSDOWN;
+		else if (_word_is(word, len, "ignore_discard"))
+			s->discards = DM_THIN_DISCARDS_IGNORE;
+		else if (_word_is(word, len, "out_of_data_space"))
+			s->out_of_data_space = 1;
+		else if (_word_is(word, len, "ro"))
+			s->read_only = 1;
+		else if (_word_is(word, len, "error_if_no_space"))
+			s->error_if_no_space = 1;
+		else if (_word_is(word, len, "needs_check"))
+			s->needs_check = 1;
+	}
+
+	if (s->out_of_data_space)
+		s->read_only = 0;
 
 	return 1;
 }
 
+int dm_get_status_thin_pool_into(const char *params, struct dm_status_thin_pool *s)
+{
+	return parse_thin_pool_status(params, s);
+}
+
 int dm_get_status_thin_pool(struct dm_pool *mem, const char *params,
 			    struct dm_status_thin_pool **status)
 {
@@ -423,13 +566,14 @@ int dm_get_status_thin_pool(struct dm_pool *mem, const char *params,
 	return 1;
 }
 
-int dm_get_status_thin(struct dm_pool *mem, const char *params,
-		       struct dm_status_thin **status)
+int dm_get_status_thin_into(const char *params, struct dm_status_thin *s)
 {
-	struct dm_status_thin *s;
+	const char *p = params;
 
-	if (!(s = dm_pool_zalloc(mem, sizeof(struct dm_status_thin)))) {
-		log_error("Failed to allocate thin status structure.");
+	memset(s, 0, sizeof(*s));
+
+	if (!params) {
+		log_error("Failed to parse invalid thin params.");
 		return 0;
 	}
 
@@ -437,14 +581,30 @@ int dm_get_status_thin(struct dm_pool *mem, const char *params,
 		/* nothing to parse */
 	} else if (strstr(params, "Fail")) {
 		s->fail = 1;
-	} else if (sscanf(params, FMTu64 " " FMTu64,
-		   &s->mapped_sectors,
-		   &s->highest_mapped_sector) != 2) {
-		dm_pool_free(mem, s);
+	} else if (!_read_u64(&p, &s->mapped_sectors) ||
+		   !_read_u64(&p, &s->highest_mapped_sector)) {
 		log_error("Failed to parse thin params: %s.", params);
 		return 0;
 	}
 
+	return 1;
+}
+
+int dm_get_status_thin(struct dm_pool *mem, const char *params,
+		       struct dm_status_thin **status)
+{
+	struct dm_status_thin *s;
+
+	if (!(s = dm_pool_alloc(mem, sizeof(struct dm_status_thin)))) {
+		log_error("Failed to allocate thin status structure.");
+		return 0;
+	}
+
+	if (!dm_get_status_thin_into(params, s)) {
+		dm_pool_free(mem, s);
+		return_0;
+	}
+
 	*status = s;
 
 	return 1;
@@ -463,19 +623,17 @@ int dm_get_status_thin(struct dm_pool *mem, const char *params,
 int dm_get_status_mirror(struct dm_pool *mem, const char *params,
 			 struct dm_status_mirror **status)
 {
-	struct dm_status_mirror *s;
-	const char *p, *pos = params;
+	struct dm_status_mirror st = { 0 }, *s;
+	uint32_t dev_major[DM_MIRROR_MAX_IMAGES], dev_minor[DM_MIRROR_MAX_IMAGES];
+	uint32_t log_major[DM_MIRROR_MAX_IMAGES], log_minor[DM_MIRROR_MAX_IMAGES];
+	const char *p = params, *q, *word, *dev_health = NULL, *log_health = NULL;
+	const char *log_type;
+	size_t len, log_type_len;
 	unsigned num_devs, argc, i;
-	int used;
-
-	if (!(s = dm_pool_zalloc(mem, sizeof(*s)))) {
-		log_error("Failed to alloc mem pool to parse mirror status.");
-		return 0;
-	}
+	char *str;
 
-	if (sscanf(pos, "%u %n", &num_devs, &used) != 1)
+	if (!params || !_read_u32(&p, &num_devs))
 		goto_out;
-	pos += used;
 
 	if (num_devs > DM_MIRROR_MAX_IMAGES) {
 		log_error(INTERNAL_ERROR "More then " DM_TO_STRING(DM_MIRROR_MAX_IMAGES)
@@ -483,82 +641,85 @@ int dm_get_status_mirror(struct dm_pool *mem, const char *params,
 		goto out;
 	}
 
-	if (!(s->devs = dm_pool_alloc(mem, num_devs * sizeof(*(s->devs))))) {
-		log_error("Allocation of devs failed.");
-		goto out;
-	}
-
-	for (i = 0; i < num_devs; ++i, pos += used)
-		if (sscanf(pos, "%u:%u %n",
-			   &(s->devs[i].major), &(s->devs[i].minor), &used) != 2)
+	for (i = 0; i < num_devs; ++i)
+		if (!_read_dev(&p, &dev_major[i], &dev_minor[i]))
 			goto_out;
 
-	if (sscanf(pos, FMTu64 "/" FMTu64 "%n",
-		   &s->insync_regions, &s->total_regions, &used) != 2)
+	if (!_read_ratio(&p, &st.insync_regions, &st.total_regions) ||
+	    !_read_u32(&p, &argc))
 		goto_out;
-	pos += used;
 
-	if (sscanf(pos, "%u %n", &argc, &used) != 1)
-		goto_out;
-	pos += used;
+	/* The first failure param holds one health char per leg. */
+	for (i = 0; i < argc; i++) {
+		if (!_read_word(&p, &word, &len))
+			goto_out;
+		if (!i) {
+			if (len < num_devs)
+				goto_out;
+			dev_health = word;
+		}
+	}
 
-	for (i = 0; i < num_devs ; ++i)
-		s->devs[i].health = pos[i];
+	q = p;
+	if (_read_word(&q, &word, &len) && _word_is(word, len, "userspace"))
+		/* FIXME: support status of userspace mirror implementation */
+		p = q;
 
-	if (!(pos = _skip_fields(pos, argc)))
+	if (!_read_u32(&p, &argc) ||
+	    !_read_word(&p, &log_type, &log_type_len))
 		goto_out;
 
-	if (strncmp(pos, "userspace", 9) == 0) {
-		pos += 9;
-		/* FIXME: support status of userspace mirror implementation */
-	}
+	/* core, cluster-core; or disk, cluster-disk */
+	if ((argc > 2) && _word_is(log_type, log_type_len, "disk")) {
+		st.log_count = argc - 2;
 
-	if (sscanf(pos, "%u %n", &argc, &used) != 1)
-		goto_out;
-	pos += used;
+		if (st.log_count > DM_MIRROR_MAX_IMAGES)
+			goto_out;
 
-	if (argc == 1) {
-		/* core, cluster-core */
-		if (!(s->log_type = dm_pool_strdup(mem, pos))) {
-			log_error("Allocation of log type string failed.");
-			goto out;
-		}
-	} else {
-		if (!(p = _skip_fields(pos, 1)))
+		for (i = 0; i < st.log_count; ++i)
+			if (!_read_dev(&p, &log_major[i], &log_minor[i]))
+				goto_out;
+
+		if (!_read_word(&p, &log_health, &len) || (len < st.log_count))
 			goto_out;
+	}
 
-		/* disk, cluster-disk */
-		if (!(s->log_type = dm_pool_strndup(mem, pos, p - pos - 1))) {
-			log_error("Allocation of log type string failed.");
-			goto out;
-		}
-		pos = p;
+	/* Allocate the status, its arrays and the log type together. */
+	len = sizeof(st) + num_devs * sizeof(*st.devs) +
+		st.log_count * sizeof(*st.logs) + log_type_len + 1;
 
-		if ((argc > 2) && !strcmp(s->log_type, "disk")) {
-			s->log_count = argc - 2;
+	if (!(s = dm_pool_alloc(mem, len))) {
+		log_error("Failed to alloc mem pool to parse mirror status.");
+		return 0;
+	}
 
-			if (!(s->logs = dm_pool_alloc(mem, s->log_count * sizeof(*(s->logs))))) {
-				log_error("Allocation of logs failed.");
-				goto out;
-			}
+	*s = st;
+	s->dev_count = num_devs;
 
-			for (i = 0; i < s->log_count; ++i, pos += used)
-				if (sscanf(pos, "%u:%u %n",
-					   &s->logs[i].major, &s->logs[i].minor, &used) != 2)
-					goto_out;
+	s->devs = (void *) (s + 1);
+	for (i = 0; i < num_devs; ++i) {
+		s->devs[i].major = dev_major[i];
+		s->devs[i].minor = dev_minor[i];
+		s->devs[i].health = dev_health ? dev_health[i] : 0;
+	}
 
-			for (i = 0; i < s->log_count; ++i)
-				s->logs[i].health = pos[i];
-		}
+	s->logs = st.log_count ? (void *) (s->devs + num_devs) : NULL;
+	for (i = 0; i < st.log_count; ++i) {
+		s->logs[i].major = log_major[i];
+		s->logs[i].minor = log_minor[i];
+		s->logs[i].health = log_health[i];
 	}
 
-	s->dev_count = num_devs;
+	str = (char *) (s->devs + num_devs) + st.log_count * sizeof(*st.logs);
+	memcpy(str, log_type, log_type_len);
+	str[log_type_len] = '\0';
+	s->log_type = str;
+
 	*status = s;
 
 	return 1;
 out:
 	log_error("Failed to parse mirror status %s.", params);
-	dm_pool_free(mem, s);
 	*status = NULL;
 
 	return 0;
@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise backup/deferred
+
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 1
+
+aux lvmconf "backup/archive = 1" "backup/backup = 1" "backup/deferred = 1"
+
+backup_seqno() {
+	sed -n 's/^[[:space:]]*seqno = \([0-9]*\)$/\1/p' "etc/backup/$vg"
+}
+
+vgchange --addtag tag1 -vvvv $vg 2>err
+# Archive is written before the VG is unlocked, the backup after it
+grep "Archiving volume group \"$vg\"" err
+grep "Deferred backup of volume group $vg" err
+test "$(backup_seqno)" = "$(get vg_field $vg seqno)"
+test ! -e "etc/backup/$vg#pending"
+ls etc/archive/${vg}_*.vg
+
+lvcreate -an -Zn -l1 -n $lv1 $vg
+test "$(backup_seqno)" = "$(get vg_field $vg seqno)"
+
+# An out of date backup left by an interrupted command is replaced
+SEQNO=$(get vg_field $vg seqno)
+cp "etc/backup/$vg" bak
+vgchange --addtag tag2 $vg
+cp bak "etc/backup/$vg"
+echo $(( SEQNO + 1 )) > "etc/backup/$vg#pending"
+vgs $vg
+test "$(backup_seqno)" = "$(( SEQNO + 1 ))"
+test ! -e "etc/backup/$vg#pending"
+
+# Concurrent commands leave the newest backup
+for i in 1 2 3 4 5 6 ; do
+	vgchange --addtag "c$i" $vg &
+done
+wait
+test "$(backup_seqno)" = "$(get vg_field $vg seqno)"
+
+vgcfgrestore -l $vg | tee out
+grep "lvcreate" out
+
+vgremove -ff $vg
+test ! -e "etc/backup/$vg"
@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise lvchange --extentheat and lv_hot_extents/lv_cold_extents
+
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux driver_at_least 4 33 || skip
+
+aux prepare_vg 2
+
+lvcreate -an -l16 -n $lv1 $vg "$dev1"
+
+# Nothing is counted unless asked for
+lvchange -ay $vg/$lv1
+dmsetup message $vg-$lv1 0 @stats_list lvm2_heat | tee out
+not grep . out
+check lv_field $vg/$lv1 lv_hot_extents ""
+
+# Not on an inactive LV
+lvchange -an $vg/$lv1
+not lvchange --extentheat y $vg/$lv1 2>err
+grep "must be active" err
+lvchange -ay $vg/$lv1
+
+lvchange --extentheat y $vg/$lv1
+# Starting again keeps the region
+lvchange --extentheat y $vg/$lv1
+test "$(dmsetup message $vg-$lv1 0 @stats_list lvm2_heat | wc -l)" -eq 1
+
+# I/O to the 4th extent makes it the hottest one
+EXTENT=$(get vg_field $vg vg_extent_size --units b --nosuffix)
+dd if="$DM_DEV_DIR/$vg/$lv1" of=/dev/null bs="$EXTENT" skip=3 count=1 iflag=direct
+HOT=$(get lv_field $vg/$lv1 lv_hot_extents)
+test "${HOT%%,*}" = "$dev1:3"
+not grep "$dev1:3" <<< "$(get lv_field $vg/$lv1 lv_cold_extents)"
+
+lvchange --extentheat n $vg/$lv1
+dmsetup message $vg-$lv1 0 @stats_list lvm2_heat | tee out
+not grep . out
+check lv_field $vg/$lv1 lv_hot_extents ""
+
+# Areas cover several extents when the LV has more than the maximum
+lvchange --extentheat y --config 'activation/extent_heat_max_areas=4' $vg/$lv1
+REGION=$(dmsetup message $vg-$lv1 0 @stats_list lvm2_heat | cut -d: -f1)
+test "$(dmsetup message $vg-$lv1 0 @stats_print $REGION | wc -l)" -eq 4
+# Extents of the area share its count
+dd if="$DM_DEV_DIR/$vg/$lv1" of=/dev/null bs="$EXTENT" skip=5 count=1 iflag=direct
+HOT=$(get lv_field $vg/$lv1 lv_hot_extents)
+test "$(cut -d, -f1-4 <<< "$HOT")" = "$dev1:4,$dev1:5,$dev1:6,$dev1:7"
+
+# Deactivation ends counting
+lvchange -an $vg/$lv1
+lvchange -ay $vg/$lv1
+check lv_field $vg/$lv1 lv_hot_extents ""
+
+vgremove -ff $vg
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise lvm serving commands on LVM_SHELL_SOCKET
+
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+which socat || skip "test requires socat utility"
+
+aux prepare_vg 1
+
+SOCK="$PWD/lvm.sock"
+
+send() {
+	echo "$@" | socat - UNIX-CONNECT:"$SOCK"
+}
+
+# A file which is not a socket is never replaced
+touch "$SOCK"
+LVM_SHELL_SOCKET="$SOCK" not lvm 2>err
+grep "Refusing to replace" err
+test -f "$SOCK"
+rm -f "$SOCK"
+
+LVM_SHELL_SOCKET="$SOCK" LVM_TEST_TAG="kill_me_$PREFIX" lvm 2>server.log &
+SERVER=$!
+for i in {1..50} ; do
+	test -S "$SOCK" && break
+	sleep .1
+done
+test -S "$SOCK"
+
+send vgs $vg | tee out
+grep "\"vg_name\":\"$vg\"" out
+grep "\"log_message\":\"success\"" out
+
+send lvcreate -l1 -n $lv1 $vg | tee out
+grep "\"log_message\":\"success\"" out
+check lv_exists $vg $lv1
+
+# Removing an active LV prompts, which reads no input and gets answered no
+send lvremove $vg/$lv1 | tee out
+grep "\"log_message\":\"failure\"" out
+check lv_exists $vg $lv1
+send lvremove --yes $vg/$lv1 | tee out
+grep "\"log_message\":\"success\"" out
+check lv_not_exists $vg $lv1
+
+send nosuchcommand | tee out
+grep "No such command" out
+
+# Only root may connect
+if test "$(id -u)" = 0 && which setpriv ; then
+	chmod 777 "$SOCK"
+	setpriv --reuid=nobody --regid=nogroup --clear-groups \
+		socat - UNIX-CONNECT:"$SOCK" <<< "vgs" > out || true
+	not grep "vg_name" out
+	grep "Rejecting connection" server.log
+fi
+
+kill -INT $SERVER
+wait $SERVER || true
+test ! -e "$SOCK"
+
+vgremove -ff $vg
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise thin_exclusive_size and thin_shared_size
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_vg 2 64
+
+held_root() {
+	dmsetup status $vg-pool-tpool | cut -d ' ' -f 7
+}
+
+lvcreate -T -L8M -c64k -V8M -n $lv1 $vg/pool
+dd if=/dev/urandom of="$DM_DEV_DIR/$vg/$lv1" bs=64k count=16 oflag=direct
+lvcreate -s -n snap $vg/$lv1
+lvchange -ay -Ky $vg/snap
+dd if=/dev/urandom of="$DM_DEV_DIR/$vg/$lv1" bs=64k count=2 oflag=direct
+
+check lv_field $vg/$lv1 thin_exclusive_size "128.00k"
+check lv_field $vg/$lv1 thin_shared_size "896.00k"
+check lv_field $vg/snap thin_exclusive_size "128.00k"
+check lv_field $vg/snap thin_shared_size "896.00k"
+
+# The metadata snapshot is not left held
+test "$(held_root)" = "-"
+
+# A metadata snapshot held by another tool is never used nor released
+dmsetup message $vg-pool-tpool 0 reserve_metadata_snap
+ROOT=$(held_root)
+lvs -o+thin_exclusive_size,thin_shared_size $vg 2>err
+grep "held by another tool" err
+check lv_field $vg/$lv1 thin_exclusive_size ""
+test "$(held_root)" = "$ROOT"
+dmsetup message $vg-pool-tpool 0 release_metadata_snap
+
+# A metadata snapshot left by an interrupted lvs is released
+LOCK_DIR=$(lvmconfig --valuesonly global/locking_dir | tr -d '"')
+POOL_UUID=$(get lv_field $vg/pool uuid)
+dmsetup message $vg-pool-tpool 0 reserve_metadata_snap
+echo 1 > "$LOCK_DIR/T_$POOL_UUID"
+check lv_field $vg/$lv1 thin_exclusive_size "128.00k"
+test "$(held_root)" = "-"
+test ! -s "$LOCK_DIR/T_$POOL_UUID"
+
+# Only a report naming the fields scans the pool
+rm -f "$LOCK_DIR/T_$POOL_UUID"
+lvs -o all $vg
+test ! -e "$LOCK_DIR/T_$POOL_UUID"
+
+# and never without file locking
+lvs --readonly -o name,thin_exclusive_size $vg 2>err
+grep "not reported without file locking" err
+test ! -e "$LOCK_DIR/T_$POOL_UUID"
+test "$(held_root)" = "-"
+
+vgremove -ff $vg
@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise activation/mlock_targeted and activation/mlock_select
+
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 1
+
+lvcreate -l1 -n $lv1 $vg
+
+# Refresh suspends the LV, so memory gets locked
+lvchange --refresh -vvvv --config 'activation/mlock_targeted=1' $vg/$lv1 2>err
+grep "Locking memory" err
+# Loaded libraries are pinned, including libc and libaio
+grep "  mlock .*/libc[.-]" err
+if grep -q "/libaio.so" err ; then
+	grep "  mlock .*/libaio.so" err
+	not grep "filter '/libaio.so.' matches" err
+fi
+not grep "area not selected .*/libc[.-]" err
+
+# With mlock_select only the listed libraries are pinned
+lvchange --refresh -vvvv --config 'activation{mlock_targeted=1 mlock_select=["/libdevmapper"]}' $vg/$lv1 2>err
+grep "area not selected .*/libc[.-]" err
+
+# Without mlock_targeted every area is considered
+lvchange --refresh -vvvv $vg/$lv1 2>err
+not grep "area not selected" err
+
+check lv_field $vg/$lv1 lv_active "active"
+
+vgremove -ff $vg
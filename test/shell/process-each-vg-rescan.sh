@@ -0,0 +1,62 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Read-only commands rescanning each VG rescan the devices of all VGs together
+
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+aux prepare_devs 3
+
+vg1=${PREFIX}vg1
+vg2=${PREFIX}vg2
+vg3=${PREFIX}vg3
+
+vgcreate $vg3 "$dev3"
+vgcreate $vg1 "$dev1"
+vgcreate $vg2 "$dev2"
+
+for i in $vg1 $vg2 $vg3 ; do
+	lvcreate -an -Zn -l1 -n $lv1 $i
+done
+
+for cmd in vgscan lvscan fullreport ; do
+	$cmd -vvvv 2>err | tee out
+	grep "Rescanning devices for 3 VGs" err
+	for i in $vg1 $vg2 $vg3 ; do
+		grep "Devices for $i already rescanned" err
+		grep "$i" out
+	done
+	not grep "Rescanning devices for ${PREFIX}vg" err
+done
+
+# A single VG is rescanned by itself
+fullreport -vvvv $vg1 2>err
+not grep "Rescanning devices for 1 VGs" err
+grep "Rescanning devices for $vg1" err
+
+# Commands using the initial scan do not rescan
+vgs -vvvv 2>err
+not grep "Rescanning devices for" err
+
+# Backups of all VGs are written under the window locks
+aux lvmconf "backup/backup = 1"
+vgcfgbackup -vvvv 2>err
+grep "Rescanning devices for 3 VGs" err
+for i in $vg1 $vg2 $vg3 ; do
+	test -s "etc/backup/$i"
+done
+
+vgremove -ff $vg1 $vg2 $vg3
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise activation/pvmove_parallel_segments
+
+
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+aux target_at_least dm-mirror 1 10 0 || skip
+# Throttle mirroring
+aux throttle_dm_mirror || skip
+
+aux prepare_pvs 3 60
+
+vgcreate -s 512k $vg "$dev1" "$dev2"
+pvcreate --metadatacopies 0 "$dev3"
+vgextend $vg "$dev3"
+
+# Count the segments of the pvmove LV copied right now
+running_mirrors() {
+	dmsetup table "$vg-pvmove0" | grep -c " mirror "
+}
+
+for parallel in 1 3 ;
+do
+
+aux lvmconf "activation/pvmove_parallel_segments = $parallel"
+
+# Multisegment LV with 3 segments on $dev1
+lvcreate -an -Zn -l10 -n $lv1 $vg "$dev1"
+lvextend -l+10 $vg/$lv1 "$dev2"
+lvextend -l+10 $vg/$lv1 "$dev1"
+lvextend -l+10 $vg/$lv1 "$dev2"
+lvextend -l+10 $vg/$lv1 "$dev1"
+lvchange -ay $vg/$lv1
+
+LVM_TEST_TAG="kill_me_$PREFIX" pvmove -i1 -b "$dev1" "$dev3"
+aux wait_pvmove_lv_ready "$vg-pvmove0"
+
+test "$(running_mirrors)" -eq "$parallel"
+
+pvmove --abort
+lvremove -ff $vg
+
+aux kill_tagged_processes
+done
+
+# Invalid values fall back to one segment at a time
+lvcreate -an -Zn -l10 -n $lv1 $vg "$dev1"
+lvextend -l+10 $vg/$lv1 "$dev2"
+lvextend -l+10 $vg/$lv1 "$dev1"
+lvchange -ay $vg/$lv1
+aux lvmconf "activation/pvmove_parallel_segments = 0"
+LVM_TEST_TAG="kill_me_$PREFIX" pvmove -i1 -b "$dev1" "$dev3" 2>err
+grep "Ignoring invalid pvmove_parallel_segments" err
+aux wait_pvmove_lv_ready "$vg-pvmove0"
+test "$(running_mirrors)" -eq 1
+
+pvmove --abort
+aux kill_tagged_processes
+
+vgremove -ff $vg
@@ -0,0 +1,93 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise the per-VG index of metadata archives
+
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 1
+
+aux lvmconf "backup/archive = 1" "backup/backup = 1" \
+	    "backup/retain_min = 3" "backup/retain_days = 0"
+
+INDEX="etc/archive/$vg.index"
+
+archives() {
+	ls etc/archive/${vg}_*.vg | wc -l
+}
+
+# Every archive in the directory has one line in the index
+check_index() {
+	test "$(wc -l < "$INDEX")" -eq "$(archives)"
+	for i in $(cut -d' ' -f3 "$INDEX") ; do
+		test -e "etc/archive/$i"
+	done
+}
+
+for i in 1 2 3 4 5 ; do
+	vgchange --addtag "t$i" $vg
+done
+
+# Old archives expire, retain_min are kept
+test "$(archives)" -eq 3
+check_index
+grep "vgchange --addtag t5" "$INDEX"
+
+vgcfgrestore -l $vg | tee out
+test "$(grep -c "File:.*/archive/" out)" -eq 3
+grep "vgchange --addtag t5" out
+
+# A missing index is rebuilt from the directory
+rm -f "$INDEX"
+vgchange --deltag t1 $vg
+check_index
+vgcfgrestore -l $vg | tee out
+test "$(grep -c "File:.*/archive/" out)" -eq 3
+
+# Entries of archives removed by hand are dropped from the index
+for i in 1 3 ; do
+	rm -f "etc/archive/$(sed -n "${i}p" "$INDEX" | cut -d' ' -f3)"
+	vgchange --deltag "t$((i + 1))" -vvvv $vg 2>err
+	grep "Archive index .* names missing archive" err
+	check_index
+	grep "vgchange --deltag t$((i + 1))" "$INDEX"
+done
+vgcfgrestore -l $vg | tee out
+test "$(grep -c "File:.*/archive/" out)" -eq 3
+
+# Commands failing after archiving leave unchanged metadata behind,
+# it is kept once and named by an index line of each command
+lvcreate -l1 -n $lv1 $vg
+not lvextend -L+1T $vg/$lv1
+not lvextend -L+2T $vg/$lv1
+test "$(archives)" -eq 3
+test "$(wc -l < "$INDEX")" -eq 4
+test "$(tail -2 "$INDEX" | cut -d' ' -f3 | uniq | wc -l)" -eq 1
+vgcfgrestore -l $vg | tee out
+grep "lvextend -L+1T" out
+grep "lvextend -L+2T" out
+
+# The shared file expires with the last line naming it,
+# the first new archive shares it too
+for i in 6 7 8 ; do
+	vgchange --addtag "t$i" $vg
+	grep "lvextend" "$INDEX"
+done
+vgchange --addtag t9 $vg
+test "$(archives)" -eq 3
+check_index
+not grep "lvextend" "$INDEX"
+
+vgremove -ff $vg
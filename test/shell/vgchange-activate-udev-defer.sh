@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# vgchange -ay keeps each VG locked until udev has processed its devices,
+# while the next VG is activated
+
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+aux prepare_devs 3
+
+vg1=${PREFIX}vg1
+vg2=${PREFIX}vg2
+vg3=${PREFIX}vg3
+
+# Created out of name order
+vgcreate $vg3 "$dev3"
+vgcreate $vg1 "$dev1"
+vgcreate $vg2 "$dev2"
+
+for i in $vg1 $vg2 $vg3 ; do
+	lvcreate -an -Zn -l1 -n $lv1 $i
+done
+
+# Other commands unlock the VG after udev is done, as before
+lvcreate -an -Zn -l1 -n $lv2 -vvvv $vg1 2>err
+not grep "Deferring unlock" err
+
+vgchange -ay -vvvv $vg3 $vg1 $vg2 2>err
+grep "Deferring unlock of VG $vg1" err
+grep "Deferring unlock of VG $vg2" err
+grep "Deferring unlock of VG $vg3" err
+# VGs are processed in name order, so the lock order is kept
+test "$(grep -o "Deferring unlock of VG [^ ]*" err | cut -d' ' -f5 | tr '\n' ' ')" = "$vg1 $vg2 $vg3 "
+
+# All devices are there when the command returns
+for i in $vg1 $vg2 $vg3 ; do
+	test -e "$DM_DEV_DIR/$i/$lv1"
+	check active $i $lv1
+done
+
+# Refresh and deactivation are not deferred
+vgchange --refresh -vvvv $vg1 $vg2 2>err
+not grep "Deferring unlock" err
+vgchange -an -vvvv $vg1 $vg2 $vg3 2>err
+not grep "Deferring unlock" err
+
+vgremove -ff $vg1 $vg2 $vg3
@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Exercise activation/fast_activation
+
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 1
+
+lvcreate -an -Zn -l1 -n $lv1 $vg
+lvcreate -an -Zn -l1 -n $lv2 $vg
+
+aux lvmconf "activation/fast_activation = 1"
+
+# Commands not activating LVs use udev as configured
+lvs -vvvv $vg 2>err
+not grep "FAST ACTIVATION" err
+not grep "fast_activation overrides" err
+
+# The test config sets udev_rules and udev_sync, so activation warns
+vgchange -ay -vvvv $vg 2>err
+grep "FAST ACTIVATION" err
+grep "fast_activation overrides" err
+test -e "$DM_DEV_DIR/mapper/$vg-$lv1"
+test -e "$DM_DEV_DIR/$vg/$lv1"
+test -e "$DM_DEV_DIR/$vg/$lv2"
+check lv_field $vg/$lv1 lv_active "active"
+
+# Nodes made by fast activation follow renames and go away on deactivation
+lvrename $vg/$lv2 $vg/$lv3
+test -e "$DM_DEV_DIR/mapper/$vg-$lv3"
+test -e "$DM_DEV_DIR/$vg/$lv3"
+test ! -e "$DM_DEV_DIR/$vg/$lv2"
+lvrename $vg/$lv3 $vg/$lv2
+
+vgchange -an -vvvv $vg 2>err
+not grep "FAST ACTIVATION" err
+test ! -e "$DM_DEV_DIR/$vg/$lv1"
+test ! -e "$DM_DEV_DIR/mapper/$vg-$lv1"
+test ! -e "$DM_DEV_DIR/$vg/$lv2"
+
+# Nothing is overridden when udev_rules and udev_sync are already off
+lvchange -ay -vvvv --config 'activation{udev_rules=0 udev_sync=0}' $vg/$lv1 2>err
+grep "FAST ACTIVATION" err
+not grep "fast_activation overrides" err
+test -e "$DM_DEV_DIR/$vg/$lv1"
+
+lvchange -an $vg/$lv1
+
+# Disabled for a single command
+lvchange -ay -vvvv --config 'activation/fast_activation=0' $vg/$lv2 2>err
+not grep "FAST ACTIVATION" err
+
+vgchange -an $vg
+vgremove -ff $vg
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/mm/arena.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------
+
+#define ARENA_SIZE (16 * 1024)
+
+struct fixture {
+	struct arena a;
+	char mem[ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+static void *_fix_init(void)
+{
+	struct fixture *f = malloc(sizeof(*f));
+
+	if (!f) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	arena_init(&f->a, f->mem, sizeof(f->mem));
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	free(fixture);
+}
+
+/* Size taken from the arena by an allocation, header included */
+static size_t _block_size(void *p, void *next)
+{
+	return (char *) next - (char *) p;
+}
+
+//----------------------------------------------------------------
+
+static void test_split(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p0, *p1;
+	size_t block;
+
+	T_ASSERT((p0 = arena_alloc(&f->a, 100)));
+	T_ASSERT(p0 > f->mem);
+	T_ASSERT(!((p0 - f->mem) % ARENA_ALIGN));
+
+	/* The rest of the area stays free and is split again */
+	T_ASSERT((p1 = arena_alloc(&f->a, 100)));
+	block = _block_size(p0, p1);
+	T_ASSERT(block >= 100 + (size_t) (p0 - f->mem));
+	T_ASSERT(!(block % ARENA_ALIGN));
+	T_ASSERT_EQUAL(f->a.used, 2 * block);
+	T_ASSERT_EQUAL(f->a.high_water, 2 * block);
+	T_ASSERT_EQUAL(f->a.misses, 0);
+}
+
+static void test_reuse_middle(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p0, *p1, *p2, *p;
+
+	T_ASSERT((p0 = arena_alloc(&f->a, 256)));
+	T_ASSERT((p1 = arena_alloc(&f->a, 256)));
+	T_ASSERT((p2 = arena_alloc(&f->a, 256)));
+
+	T_ASSERT(arena_free(&f->a, p1));
+
+	/* A smaller request fits in the hole left by the middle block */
+	T_ASSERT((p = arena_alloc(&f->a, 64)));
+	T_ASSERT(p == p1);
+
+	/* and the remainder of the hole is used before the tail */
+	T_ASSERT((p = arena_alloc(&f->a, 64)));
+	T_ASSERT(p > p1);
+	T_ASSERT(p < p2);
+
+	/* A request larger than the hole comes from the tail */
+	T_ASSERT((p = arena_alloc(&f->a, 256)));
+	T_ASSERT(p > p2);
+}
+
+static void test_merge(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p[3], *big;
+	size_t block;
+
+	T_ASSERT((p[0] = arena_alloc(&f->a, 512)));
+	T_ASSERT((p[1] = arena_alloc(&f->a, 512)));
+	T_ASSERT((p[2] = arena_alloc(&f->a, 512)));
+	block = _block_size(p[0], p[1]);
+
+	/* Release the outer blocks first, then the middle merges both sides */
+	T_ASSERT(arena_free(&f->a, p[0]));
+	T_ASSERT(arena_free(&f->a, p[2]));
+	T_ASSERT_EQUAL(f->a.used, block);
+	T_ASSERT(arena_free(&f->a, p[1]));
+
+	/* A single free block covers the whole area again */
+	T_ASSERT((big = arena_alloc(&f->a, ARENA_SIZE - (p[0] - f->mem))));
+	T_ASSERT(big == p[0]);
+	T_ASSERT_EQUAL(f->a.used, ARENA_SIZE);
+	T_ASSERT(arena_free(&f->a, big));
+}
+
+static void test_used_returns_to_zero(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p[16];
+	size_t high_water;
+	unsigned i;
+
+	for (i = 0; i < DM_ARRAY_SIZE(p); i++)
+		T_ASSERT((p[i] = arena_alloc(&f->a, 100 + i * 10)));
+
+	high_water = f->a.high_water;
+	T_ASSERT_EQUAL(high_water, f->a.used);
+
+	/* Release in an interleaved order */
+	for (i = 0; i < DM_ARRAY_SIZE(p); i += 2)
+		T_ASSERT(arena_free(&f->a, p[i]));
+	for (i = 1; i < DM_ARRAY_SIZE(p); i += 2)
+		T_ASSERT(arena_free(&f->a, p[i]));
+
+	T_ASSERT_EQUAL(f->a.used, 0);
+	T_ASSERT_EQUAL(f->a.high_water, high_water);
+
+	/* Everything merged back into one block at the start */
+	T_ASSERT(arena_alloc(&f->a, 100) == p[0]);
+}
+
+static void test_miss(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p;
+
+	T_ASSERT(!arena_alloc(&f->a, ARENA_SIZE));
+	T_ASSERT_EQUAL(f->a.misses, 1);
+	T_ASSERT_EQUAL(f->a.used, 0);
+
+	T_ASSERT((p = arena_alloc(&f->a, ARENA_SIZE / 2)));
+	T_ASSERT(!arena_alloc(&f->a, ARENA_SIZE / 2));
+	T_ASSERT_EQUAL(f->a.misses, 2);
+	T_ASSERT(arena_free(&f->a, p));
+	T_ASSERT_EQUAL(f->a.used, 0);
+}
+
+static void test_foreign_free(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *p = malloc(16);
+
+	T_ASSERT(p);
+	T_ASSERT(!arena_free(&f->a, p));
+	T_ASSERT(!arena_free(&f->a, f->mem + ARENA_SIZE));
+	T_ASSERT_EQUAL(f->a.used, 0);
+	free(p);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/base/memory/arena/" path, desc, fn)
+
+void arena_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("split", "a free block is split on allocation", test_split);
+	T("reuse-middle", "a freed middle block is reused", test_reuse_middle);
+	T("merge", "a freed block merges with both neighbours", test_merge);
+	T("used", "used returns to zero and high water is kept", test_used_returns_to_zero);
+	T("miss", "allocations that do not fit are counted", test_miss);
+	T("foreign-free", "pointers outside the arena are not taken", test_foreign_free);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+static void test_crc32c_check_value(void *fixture)
+{
+	const uint8_t *buf = (const uint8_t *) "123456789";
+
+	T_ASSERT_EQUAL(~calc_crc32c(0xffffffff, buf, 9), 0xe3069283);
+}
+
+static void test_crc32c_empty(void *fixture)
+{
+	T_ASSERT_EQUAL(calc_crc32c(0xffffffff, NULL, 0), 0xffffffff);
+}
+
+static void test_crc32c_incremental(void *fixture)
+{
+	const uint8_t *buf = (const uint8_t *) "123456789";
+	uint32_t crc = calc_crc32c(0xffffffff, buf, 4);
+
+	T_ASSERT_EQUAL(calc_crc32c(crc, buf + 4, 5), calc_crc32c(0xffffffff, buf, 9));
+}
+
+static void test_crc32c_zeroes(void *fixture)
+{
+	uint8_t buf[32];
+
+	memset(buf, 0, sizeof(buf));
+	/* iSCSI test vector, RFC 3720 B.4 */
+	T_ASSERT_EQUAL(~calc_crc32c(0xffffffff, buf, sizeof(buf)), 0x8a9136aa);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/misc/crc/" path, desc, fn)
+
+void crc_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("crc32c-check-value", "crc32c of the standard check string", test_crc32c_check_value);
+	T("crc32c-empty", "crc32c of no data is the initial value", test_crc32c_empty);
+	T("crc32c-incremental", "crc32c can be computed in pieces", test_crc32c_incremental);
+	T("crc32c-zeroes", "crc32c of 32 zero bytes", test_crc32c_zeroes);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The @stats_list and @stats_print parsers are static, so the stats
+ * source is built into the test.  It must come first: it provides the
+ * libdevmapper.h definitions the framework header relies on.
+ */
+#include "libdm/libdm-stats.c"
+
+#include "units.h"
+
+/*
+ * The internal device-mapper library allocates with the C library
+ * directly, so supply the libdm entry points the stats source uses.
+ */
+void *dm_malloc_wrapper(size_t s, const char *file __attribute__((unused)),
+			int line __attribute__((unused)))
+{
+	return malloc(s);
+}
+
+void *dm_zalloc_wrapper(size_t s, const char *file __attribute__((unused)),
+			int line __attribute__((unused)))
+{
+	return calloc(1, s);
+}
+
+char *dm_strdup_wrapper(const char *str, const char *file __attribute__((unused)),
+			int line __attribute__((unused)))
+{
+	return strdup(str);
+}
+
+void dm_free_wrapper(void *ptr)
+{
+	free(ptr);
+}
+
+int dm_message_supports_precise_timestamps(void)
+{
+	return 1;
+}
+
+//----------------------------------------------------------------
+
+static void *_stats_init(void)
+{
+	struct dm_stats *dms = dm_stats_create("test");
+
+	if (!dms) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	return dms;
+}
+
+static void _stats_exit(void *fixture)
+{
+	dm_stats_destroy(fixture);
+}
+
+/* Region 0 has two areas, region 1 a single area with a histogram. */
+#define LIST "0: 0+2048 1024 dmstats -\n" \
+	     "1: 2048+1024 1024 dmstats - histogram:10,20\n"
+
+#define ROW0 "0+1024 1 2 3 4 5 6 7 8 9 10 11 12 13\n"
+#define ROW1 "1024+1024 14 15 16 17 18 19 20 21 22 23 24 25 26\n"
+#define HIST "2048+1024 1 0 8 1 1 0 8 1 0 2 2 2 2 5:6:7\n"
+
+/* The same areas as ROW0 and ROW1 with new counter values. */
+#define NEXT "0+1024 2 2 3 4 5 6 7 8 9 10 11 12 13\n" \
+	     "1024+1024 15 15 16 17 18 19 20 21 22 23 24 25 26\n"
+
+static void _test_parse_rows(void *fixture)
+{
+	struct dm_stats *dms = fixture;
+	struct dm_stats_region *region;
+	struct dm_stats_counters *counters;
+
+	T_ASSERT(_stats_parse_list(dms, LIST));
+	T_ASSERT_EQUAL(dms->nr_regions, 2);
+
+	region = &dms->regions[0];
+	T_ASSERT(_stats_parse_region(dms, ROW0 ROW1, region, 1));
+	T_ASSERT_EQUAL(region->start, 0);
+	T_ASSERT_EQUAL(region->len, 2048);
+	T_ASSERT_EQUAL(region->step, 1024);
+	T_ASSERT_EQUAL(_nr_areas_region(region), 2);
+
+	T_ASSERT_EQUAL(region->counters[0].reads, 1);
+	T_ASSERT_EQUAL(region->counters[0].write_sectors, 7);
+	T_ASSERT_EQUAL(region->counters[0].total_write_nsecs, 13);
+	T_ASSERT_EQUAL(region->counters[1].reads, 14);
+	T_ASSERT_EQUAL(region->counters[1].io_in_progress, 22);
+	T_ASSERT_EQUAL(region->counters[1].total_write_nsecs, 26);
+	T_ASSERT(!region->counters[1].histogram);
+
+	/* Time values are scaled up for msec precision regions. */
+	counters = region->counters;
+	T_ASSERT(_stats_parse_region(dms, ROW0 ROW1, region, NSEC_PER_MSEC));
+	T_ASSERT(region->counters == counters);
+	T_ASSERT_EQUAL(region->counters[0].reads, 1);
+	T_ASSERT_EQUAL(region->counters[0].read_nsecs, 4 * NSEC_PER_MSEC);
+	T_ASSERT_EQUAL(region->counters[1].weighted_io_nsecs, 24 * NSEC_PER_MSEC);
+}
+
+static void _test_parse_histogram(void *fixture)
+{
+	struct dm_stats *dms = fixture;
+	struct dm_stats_region *region;
+	struct dm_histogram *hist;
+
+	T_ASSERT(_stats_parse_list(dms, LIST));
+
+	region = &dms->regions[1];
+	T_ASSERT(region->bounds);
+	T_ASSERT_EQUAL(region->bounds->nr_bins, 3);
+
+	T_ASSERT(_stats_parse_region(dms, HIST, region, 1));
+	T_ASSERT_EQUAL(region->start, 2048);
+	T_ASSERT_EQUAL(region->counters[0].reads, 1);
+
+	T_ASSERT((hist = region->counters[0].histogram));
+	T_ASSERT_EQUAL(hist->nr_bins, 3);
+	T_ASSERT_EQUAL(hist->sum, 18);
+	T_ASSERT_EQUAL(hist->bins[0].count, 5);
+	T_ASSERT_EQUAL(hist->bins[1].count, 6);
+	T_ASSERT_EQUAL(hist->bins[2].count, 7);
+	T_ASSERT_EQUAL(hist->bins[0].upper, 10 * NSEC_PER_MSEC);
+	T_ASSERT_EQUAL(hist->bins[2].upper, UINT64_MAX);
+	T_ASSERT(hist->region == region);
+}
+
+static void _test_parse_malformed(void *fixture)
+{
+	struct dm_stats *dms = fixture;
+	struct dm_stats_region *region;
+	static const char *_bad_rows[] = {
+		"",
+		"0+1024 1 2 3\n",
+		"0-1024 1 2 3 4 5 6 7 8 9 10 11 12 13\n",
+		"0+1024 1 2 3 4 5 6 7 8 x 10 11 12 13\n",
+		"0+1024 1 2 3 4 5 6 7 8 9 10 11 12 99999999999999999999\n",
+		ROW0 "1024+1024 14 15\n",
+	};
+	static const char *_bad_hists[] = {
+		"2048+1024 1 0 8 1 1 0 8 1 0 2 2 2 2\n",
+		"2048+1024 1 0 8 1 1 0 8 1 0 2 2 2 2 5:6\n",
+		"2048+1024 1 0 8 1 1 0 8 1 0 2 2 2 2 5;6;7\n",
+		"2048+1024 1 0 8 1 1 0 8 1 0 2 2 2 2 5:6:7x\n",
+	};
+	unsigned i;
+
+	T_ASSERT(_stats_parse_list(dms, LIST));
+
+	region = &dms->regions[0];
+	T_ASSERT(!_stats_parse_region(dms, NULL, region, 1));
+	for (i = 0; i < DM_ARRAY_SIZE(_bad_rows); i++)
+		T_ASSERT(!_stats_parse_region(dms, _bad_rows[i], region, 1));
+
+	/* A failed parse leaves an unpopulated region unpopulated. */
+	T_ASSERT(!region->counters);
+
+	region = &dms->regions[1];
+	for (i = 0; i < DM_ARRAY_SIZE(_bad_hists); i++)
+		T_ASSERT(!_stats_parse_region(dms, _bad_hists[i], region, 1));
+	T_ASSERT(!region->counters);
+
+	T_ASSERT(!_stats_parse_list_region(dms, &dms->regions[0], (char *) "0: x+1 1 -"));
+}
+
+/*
+ * Repeated samples of a region of unchanged shape are parsed into the
+ * same counters and histograms, without allocating from the pools.
+ */
+static void _test_sample_reuse(void *fixture)
+{
+	struct dm_stats *dms = fixture;
+	struct dm_stats_region *r0, *r1;
+	struct dm_stats_counters *counters0, *counters1;
+	struct dm_histogram *hist;
+	char *mark[3], *hist_mark[3];
+	unsigned i;
+
+	T_ASSERT(_stats_parse_list(dms, LIST));
+	r0 = &dms->regions[0];
+	r1 = &dms->regions[1];
+
+	T_ASSERT(_stats_parse_region(dms, ROW0 ROW1, r0, 1));
+	T_ASSERT(_stats_parse_region(dms, HIST, r1, 1));
+	counters0 = r0->counters;
+	counters1 = r1->counters;
+	hist = counters1[0].histogram;
+
+	/* Two marks with nothing in between give the step of the pools. */
+	for (i = 0; i < 2; i++) {
+		T_ASSERT((mark[i] = dm_pool_alloc(dms->mem, 1)));
+		T_ASSERT((hist_mark[i] = dm_pool_alloc(dms->hist_mem, 1)));
+	}
+
+	for (i = 0; i < 1000; i++) {
+		T_ASSERT(_stats_parse_region(dms, (i & 1) ? NEXT : ROW0 ROW1, r0, 1));
+		T_ASSERT(_stats_parse_region(dms, HIST, r1, 1));
+	}
+
+	T_ASSERT(r0->counters == counters0);
+	T_ASSERT_EQUAL(r0->counters[1].reads, 15);
+	T_ASSERT(r1->counters == counters1);
+	T_ASSERT(r1->counters[0].histogram == hist);
+	T_ASSERT_EQUAL(hist->sum, 18);
+
+	/* Nothing was allocated from either pool while sampling. */
+	T_ASSERT((mark[2] = dm_pool_alloc(dms->mem, 1)));
+	T_ASSERT((hist_mark[2] = dm_pool_alloc(dms->hist_mem, 1)));
+	T_ASSERT_EQUAL(mark[2] - mark[1], mark[1] - mark[0]);
+	T_ASSERT_EQUAL(hist_mark[2] - hist_mark[1], hist_mark[1] - hist_mark[0]);
+
+	/* A changed number of areas gets a new table. */
+	T_ASSERT(_stats_parse_region(dms, ROW0, r0, 1));
+	T_ASSERT(r0->counters != counters0);
+	T_ASSERT_EQUAL(_nr_areas_region(r0), 1);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/device-mapper/stats/" path, desc, fn)
+
+void dm_stats_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_stats_init, _stats_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("parse-rows", "parse @stats_print area rows", _test_parse_rows);
+	T("parse-histogram", "parse @stats_print histogram data", _test_parse_histogram);
+	T("parse-malformed", "reject malformed @stats_print responses", _test_parse_malformed);
+	T("sample-reuse", "repeated samples reuse the counters table", _test_sample_reuse);
+
+	dm_list_add(all_tests, &ts->list);
+}
@@ -70,6 +70,304 @@ static void _test_mirror_status(void *fixture)
 	}
 }
 
+static void _test_mirror_status_invalid(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_mirror *s = NULL;
+
+	/* Health string shorter than the number of legs */
+	T_ASSERT(!dm_get_status_mirror(mem, "2 253:1 253:2 80/81 1 A 1 core", &s));
+	/* More legs than the kernel supports */
+	T_ASSERT(!dm_get_status_mirror(mem, "9 253:1 253:2 253:3 253:4 253:5 253:6 "
+				       "253:7 253:8 253:9 1/1 1 AAAAAAAAA 1 core", &s));
+	T_ASSERT(!dm_get_status_mirror(mem, "2 253:1 80/81 1 AA 1 core", &s));
+}
+
+static void _test_raid_status(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_raid *s = NULL;
+
+	/* pre-1.5.0 */
+	T_ASSERT(dm_get_status_raid(mem, "raid1 2 AA 100/100", &s));
+	T_ASSERT(!strcmp(s->raid_type, "raid1"));
+	T_ASSERT(!strcmp(s->dev_health, "AA"));
+	T_ASSERT_EQUAL(s->dev_count, 2);
+	T_ASSERT_EQUAL(s->insync_regions, 100);
+	T_ASSERT_EQUAL(s->total_regions, 100);
+	T_ASSERT(!s->sync_action);
+	T_ASSERT_EQUAL(s->mismatch_count, 0);
+
+	/* 1.5.0+ */
+	T_ASSERT(dm_get_status_raid(mem, "raid5_ls 3 AAa 20/40 recover 7", &s));
+	T_ASSERT(!strcmp(s->raid_type, "raid5_ls"));
+	T_ASSERT(!strcmp(s->dev_health, "AAa"));
+	T_ASSERT(!strcmp(s->sync_action, "recover"));
+	T_ASSERT_EQUAL(s->insync_regions, 20);
+	T_ASSERT_EQUAL(s->mismatch_count, 7);
+	T_ASSERT_EQUAL(s->data_offset, 0);
+
+	/* 1.9.0+, in sync with a device still recovering */
+	T_ASSERT(dm_get_status_raid(mem, "raid1 2 Aa 64/64 idle 0 8192", &s));
+	T_ASSERT(!strcmp(s->sync_action, "idle"));
+	T_ASSERT_EQUAL(s->insync_regions, 63);
+	T_ASSERT_EQUAL(s->data_offset, 8192);
+
+	T_ASSERT(!dm_get_status_raid(mem, "raid1 2 AA", &s));
+	T_ASSERT(!dm_get_status_raid(mem, "raid1 2 AA 100/100 idle x", &s));
+	T_ASSERT(!dm_get_status_raid(mem, "raid1 2 AA 100/100 idle 0 x", &s));
+}
+
+static void _test_cache_status(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_cache *s = NULL;
+
+	T_ASSERT(dm_get_status_cache(mem,
+				     "8 31/4096 128 39/16384 2 1 3 4 5 6 7 "
+				     "2 writeback metadata2 2 migration_threshold 2048 "
+				     "smq 0 rw -", &s));
+	T_ASSERT_EQUAL(s->metadata_block_size, 8);
+	T_ASSERT_EQUAL(s->metadata_used_blocks, 31);
+	T_ASSERT_EQUAL(s->metadata_total_blocks, 4096);
+	T_ASSERT_EQUAL(s->block_size, 128);
+	T_ASSERT_EQUAL(s->used_blocks, 39);
+	T_ASSERT_EQUAL(s->total_blocks, 16384);
+	T_ASSERT_EQUAL(s->read_hits, 2);
+	T_ASSERT_EQUAL(s->read_misses, 1);
+	T_ASSERT_EQUAL(s->write_hits, 3);
+	T_ASSERT_EQUAL(s->write_misses, 4);
+	T_ASSERT_EQUAL(s->demotions, 5);
+	T_ASSERT_EQUAL(s->promotions, 6);
+	T_ASSERT_EQUAL(s->dirty_blocks, 7);
+	T_ASSERT_EQUAL(s->feature_flags, DM_CACHE_FEATURE_WRITEBACK | DM_CACHE_FEATURE_METADATA2);
+	T_ASSERT_EQUAL(s->core_argc, 2);
+	T_ASSERT(!strcmp(s->core_argv[0], "migration_threshold"));
+	T_ASSERT(!strcmp(s->core_argv[1], "2048"));
+	T_ASSERT(!strcmp(s->policy_name, "smq"));
+	T_ASSERT_EQUAL(s->policy_argc, 0);
+	T_ASSERT(!s->read_only);
+	T_ASSERT(!s->needs_check);
+
+	T_ASSERT(dm_get_status_cache(mem,
+				     "8 31/4096 128 39/16384 0 0 0 0 0 0 0 "
+				     "1 writethrough 0 mq 2 sequential_threshold 512 "
+				     "ro needs_check", &s));
+	T_ASSERT_EQUAL(s->feature_flags, DM_CACHE_FEATURE_WRITETHROUGH);
+	T_ASSERT_EQUAL(s->core_argc, 0);
+	T_ASSERT(!strcmp(s->policy_name, "mq"));
+	T_ASSERT_EQUAL(s->policy_argc, 2);
+	T_ASSERT(!strcmp(s->policy_argv[0], "sequential_threshold"));
+	T_ASSERT(!strcmp(s->policy_argv[1], "512"));
+	T_ASSERT(s->read_only);
+	T_ASSERT(s->needs_check);
+
+	T_ASSERT(dm_get_status_cache(mem, "Fail", &s));
+	T_ASSERT(s->fail);
+	T_ASSERT(!s->error);
+
+	T_ASSERT(!dm_get_status_cache(mem, "8 31/4096 128 39/16384 0 0 0 0 0 0 0 "
+				      "0 2 migration_threshold", &s));
+}
+
+static void _test_thin_pool_status(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_thin_pool *s = NULL;
+
+	T_ASSERT(dm_get_status_thin_pool(mem, "1 10/1024 20/2048 - rw discard_passdown "
+					 "queue_if_no_space -", &s));
+	T_ASSERT_EQUAL(s->transaction_id, 1);
+	T_ASSERT_EQUAL(s->used_metadata_blocks, 10);
+	T_ASSERT_EQUAL(s->total_metadata_blocks, 1024);
+	T_ASSERT_EQUAL(s->used_data_blocks, 20);
+	T_ASSERT_EQUAL(s->total_data_blocks, 2048);
+	T_ASSERT_EQUAL(s->held_metadata_root, 0);
+	T_ASSERT_EQUAL(s->discards, DM_THIN_DISCARDS_PASSDOWN);
+	T_ASSERT(!s->read_only);
+	T_ASSERT(!s->error_if_no_space);
+
+	T_ASSERT(dm_get_status_thin_pool(mem, "5 10/1024 20/2048 7 ro ignore_discard "
+					 "error_if_no_space needs_check", &s));
+	T_ASSERT_EQUAL(s->held_metadata_root, 7);
+	T_ASSERT_EQUAL(s->discards, DM_THIN_DISCARDS_IGNORE);
+	T_ASSERT(s->read_only);
+	T_ASSERT(s->error_if_no_space);
+	T_ASSERT(s->needs_check);
+
+	T_ASSERT(dm_get_status_thin_pool(mem, "5 10/1024 2048/2048 - out_of_data_space "
+					 "no_discard_passdown queue_if_no_space -", &s));
+	T_ASSERT(s->out_of_data_space);
+	T_ASSERT(!s->read_only);
+	T_ASSERT_EQUAL(s->discards, DM_THIN_DISCARDS_NO_PASSDOWN);
+
+	T_ASSERT(dm_get_status_thin_pool(mem, "Error", &s));
+	T_ASSERT(s->error && s->fail);
+
+	T_ASSERT(!dm_get_status_thin_pool(mem, "1 10/1024 20", &s));
+	T_ASSERT(!dm_get_status_thin_pool(mem, "18446744073709551616 10/1024 20/2048", &s));
+}
+
+static void _test_thin_status(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_thin *s = NULL;
+
+	T_ASSERT(dm_get_status_thin(mem, "4096 8191", &s));
+	T_ASSERT_EQUAL(s->mapped_sectors, 4096);
+	T_ASSERT_EQUAL(s->highest_mapped_sector, 8191);
+	T_ASSERT(!s->fail);
+
+	T_ASSERT(dm_get_status_thin(mem, "0 -", &s));
+	T_ASSERT_EQUAL(s->mapped_sectors, 0);
+
+	T_ASSERT(dm_get_status_thin(mem, "Fail", &s));
+	T_ASSERT(s->fail);
+
+	T_ASSERT(!dm_get_status_thin(mem, "4096", &s));
+}
+
+static void _test_snapshot_status(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_snapshot *s = NULL;
+
+	T_ASSERT(dm_get_status_snapshot(mem, "16/4096 16", &s));
+	T_ASSERT_EQUAL(s->used_sectors, 16);
+	T_ASSERT_EQUAL(s->total_sectors, 4096);
+	T_ASSERT_EQUAL(s->metadata_sectors, 16);
+	T_ASSERT(s->has_metadata_sectors);
+
+	T_ASSERT(dm_get_status_snapshot(mem, "16/4096", &s));
+	T_ASSERT(!s->has_metadata_sectors);
+
+	T_ASSERT(dm_get_status_snapshot(mem, "Invalid", &s));
+	T_ASSERT(s->invalid);
+	T_ASSERT(dm_get_status_snapshot(mem, "Merge failed", &s));
+	T_ASSERT(s->merge_failed);
+	T_ASSERT(dm_get_status_snapshot(mem, "Overflow", &s));
+	T_ASSERT(s->overflow);
+
+	T_ASSERT(!dm_get_status_snapshot(mem, "16", &s));
+}
+
+/* The _into forms fill in the caller's structure, nothing is allocated. */
+static void _test_status_into(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_status_thin_pool tp;
+	struct dm_status_thin t;
+	struct dm_status_snapshot ss;
+	char *mark[3];
+
+	/* Two marks with nothing in between give the step of the pool */
+	T_ASSERT((mark[0] = dm_pool_alloc(mem, 1)));
+	T_ASSERT((mark[1] = dm_pool_alloc(mem, 1)));
+
+	T_ASSERT(dm_get_status_thin_pool_into("5 10/1024 20/2048 7 ro ignore_discard", &tp));
+	T_ASSERT_EQUAL(tp.transaction_id, 5);
+	T_ASSERT_EQUAL(tp.used_data_blocks, 20);
+	T_ASSERT_EQUAL(tp.held_metadata_root, 7);
+	T_ASSERT(tp.read_only);
+	T_ASSERT_EQUAL(tp.discards, DM_THIN_DISCARDS_IGNORE);
+	T_ASSERT(!dm_get_status_thin_pool_into("1 10/1024 20", &tp));
+
+	T_ASSERT(dm_get_status_thin_into("4096 8191", &t));
+	T_ASSERT_EQUAL(t.mapped_sectors, 4096);
+	T_ASSERT_EQUAL(t.highest_mapped_sector, 8191);
+	T_ASSERT(dm_get_status_thin_into("Fail", &t));
+	T_ASSERT(t.fail);
+	T_ASSERT(!dm_get_status_thin_into("4096", &t));
+
+	T_ASSERT(dm_get_status_snapshot_into("16/4096 16", &ss));
+	T_ASSERT_EQUAL(ss.used_sectors, 16);
+	T_ASSERT_EQUAL(ss.total_sectors, 4096);
+	T_ASSERT(ss.has_metadata_sectors);
+	T_ASSERT(dm_get_status_snapshot_into("Overflow", &ss));
+	T_ASSERT(ss.overflow);
+	T_ASSERT(!ss.used_sectors);
+	T_ASSERT(!dm_get_status_snapshot_into("16", &ss));
+
+	T_ASSERT((mark[2] = dm_pool_alloc(mem, 1)));
+	T_ASSERT_EQUAL(mark[2] - mark[1], mark[1] - mark[0]);
+}
+
+__attribute__ ((format(printf, 5, 6)))
+static void _no_log(int level, const char *file, int line,
+		    int dm_errno_or_class, const char *f, ...)
+{
+}
+
+/*
+ * Feed every prefix of each sample status, and copies with single bytes
+ * replaced, through the parsers.  Only termination without crashing is
+ * checked; run under valgrind to catch reads past the status string.
+ */
+static void _test_status_mutations(void *fixture)
+{
+	static const struct {
+		const char *target;
+		const char *params;
+	} _samples[] = {
+		{ "mirror", "2 253:1 253:2 80/81 1 AD 3 disk 253:0 A" },
+		{ "mirror", "2 253:1 253:2 80/81 1 AD userspace 1 core" },
+		{ "raid", "raid1 2 Aa 64/64 idle 0 8192" },
+		{ "cache", "8 31/4096 128 39/16384 2 1 3 4 5 6 7 1 writeback "
+			   "2 migration_threshold 2048 smq 2 a b rw -" },
+		{ "thin-pool", "5 10/1024 20/2048 7 ro ignore_discard needs_check" },
+		{ "thin", "4096 8191" },
+		{ "snapshot", "16/4096 16" },
+	};
+	static const char _bytes[] = { ' ', '/', ':', '0', '9', 'A', '-', '\0' };
+	struct dm_pool *mem = fixture;
+	char buf[128];
+	void *status;
+	unsigned i, j, k;
+	size_t len;
+
+	dm_log_with_errno_init(_no_log);
+
+	for (i = 0; i < DM_ARRAY_SIZE(_samples); i++) {
+		len = strlen(_samples[i].params);
+		T_ASSERT(len < sizeof(buf));
+
+		for (j = 0; j <= len; j++)
+			for (k = 0; k <= DM_ARRAY_SIZE(_bytes); k++) {
+				memcpy(buf, _samples[i].params, len + 1);
+				if (k < DM_ARRAY_SIZE(_bytes))
+					buf[j] = _bytes[k];	/* mutate */
+				else
+					buf[j] = '\0';		/* truncate */
+
+				status = NULL;
+				switch (_samples[i].target[0]) {
+				case 'm':
+					(void) dm_get_status_mirror(mem, buf, (struct dm_status_mirror **) &status);
+					break;
+				case 'r':
+					(void) dm_get_status_raid(mem, buf, (struct dm_status_raid **) &status);
+					break;
+				case 'c':
+					(void) dm_get_status_cache(mem, buf, (struct dm_status_cache **) &status);
+					break;
+				case 's':
+					(void) dm_get_status_snapshot(mem, buf, (struct dm_status_snapshot **) &status);
+					break;
+				default:
+					if (!strcmp(_samples[i].target, "thin"))
+						(void) dm_get_status_thin(mem, buf, (struct dm_status_thin **) &status);
+					else
+						(void) dm_get_status_thin_pool(mem, buf, (struct dm_status_thin_pool **) &status);
+				}
+
+				if (status)
+					dm_pool_free(mem, status);
+			}
+	}
+
+	dm_log_with_errno_init(NULL);
+}
+
 void dm_status_tests(struct dm_list *all_tests)
 {
 	struct test_suite *ts = test_suite_create(_mem_init, _mem_exit);
@@ -79,6 +377,14 @@ void dm_status_tests(struct dm_list *all_tests)
 	}
 
 	register_test(ts, "/device-mapper/mirror/status", "parsing mirror status", _test_mirror_status);
+	register_test(ts, "/device-mapper/mirror/status-invalid", "rejecting malformed mirror status", _test_mirror_status_invalid);
+	register_test(ts, "/device-mapper/raid/status", "parsing raid status", _test_raid_status);
+	register_test(ts, "/device-mapper/cache/status", "parsing cache status", _test_cache_status);
+	register_test(ts, "/device-mapper/thin-pool/status", "parsing thin-pool status", _test_thin_pool_status);
+	register_test(ts, "/device-mapper/thin/status", "parsing thin status", _test_thin_status);
+	register_test(ts, "/device-mapper/snapshot/status", "parsing snapshot status", _test_snapshot_status);
+	register_test(ts, "/device-mapper/status/into", "parsing status without allocating", _test_status_into);
+	register_test(ts, "/device-mapper/status/mutations", "parsing truncated and mutated status", _test_status_mutations);
 	dm_list_add(all_tests, &ts->list);
 }
 
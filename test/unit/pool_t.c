@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "device_mapper/all.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------
+
+/* Hands out at most one chunk from a static area */
+static struct {
+	char mem[64 * 1024] __attribute__((aligned(16)));
+	unsigned allocs;
+	unsigned frees;
+	unsigned foreign_frees;
+	int taken;
+} _area;
+
+static void *_area_alloc(size_t s)
+{
+	if (_area.taken || (s > sizeof(_area.mem)))
+		return NULL;
+
+	_area.taken = 1;
+	_area.allocs++;
+
+	return _area.mem;
+}
+
+static int _area_free(void *ptr)
+{
+	if ((char *) ptr != _area.mem) {
+		_area.foreign_frees++;
+		return 0;
+	}
+
+	_area.taken = 0;
+	_area.frees++;
+
+	return 1;
+}
+
+static int _in_area(const void *ptr)
+{
+	return ((const char *) ptr >= _area.mem) &&
+	       ((const char *) ptr < _area.mem + sizeof(_area.mem));
+}
+
+static void *_fix_init(void)
+{
+	memset(&_area, 0, sizeof(_area));
+
+	return NULL;
+}
+
+static void _fix_exit(void *fixture)
+{
+	dm_pool_set_chunk_allocator(NULL, NULL);
+}
+
+static void test_chunk_from_allocator(void *fixture)
+{
+	struct dm_pool *mem;
+	void *p;
+
+	dm_pool_set_chunk_allocator(_area_alloc, _area_free);
+
+	T_ASSERT(mem = dm_pool_create("test", 1024));
+	T_ASSERT(p = dm_pool_alloc(mem, 128));
+	T_ASSERT(_in_area(p));
+	T_ASSERT_EQUAL(_area.allocs, 1);
+
+	dm_pool_destroy(mem);
+	T_ASSERT_EQUAL(_area.frees, 1);
+	T_ASSERT_EQUAL(_area.foreign_frees, 0);
+}
+
+static void test_fallback_to_malloc(void *fixture)
+{
+	struct dm_pool *mem1, *mem2;
+	void *p1, *p2;
+
+	dm_pool_set_chunk_allocator(_area_alloc, _area_free);
+
+	T_ASSERT(mem1 = dm_pool_create("test1", 1024));
+	T_ASSERT(p1 = dm_pool_alloc(mem1, 128));
+	T_ASSERT(_in_area(p1));
+
+	/* The area is taken, so the second pool gets its chunk from malloc */
+	T_ASSERT(mem2 = dm_pool_create("test2", 1024));
+	T_ASSERT(p2 = dm_pool_alloc(mem2, 128));
+	T_ASSERT(!_in_area(p2));
+	T_ASSERT_EQUAL(_area.allocs, 1);
+
+	dm_pool_destroy(mem2);
+	T_ASSERT_EQUAL(_area.foreign_frees, 1);
+	dm_pool_destroy(mem1);
+	T_ASSERT_EQUAL(_area.frees, 1);
+}
+
+static void test_free_after_switch_back(void *fixture)
+{
+	struct dm_pool *mem1, *mem2;
+	void *p1, *p2;
+
+	dm_pool_set_chunk_allocator(_area_alloc, _area_free);
+
+	T_ASSERT(mem1 = dm_pool_create("test1", 1024));
+	T_ASSERT(p1 = dm_pool_alloc(mem1, 128));
+	T_ASSERT(_in_area(p1));
+
+	/* Only allocation switches back, chunks are still returned to the area */
+	dm_pool_set_chunk_allocator(NULL, _area_free);
+
+	T_ASSERT(mem2 = dm_pool_create("test2", 1024));
+	T_ASSERT(p2 = dm_pool_alloc(mem2, 128));
+	T_ASSERT(!_in_area(p2));
+	dm_pool_destroy(mem2);
+
+	dm_pool_destroy(mem1);
+	T_ASSERT_EQUAL(_area.allocs, 1);
+	T_ASSERT_EQUAL(_area.frees, 1);
+	T_ASSERT(!_area.taken);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/base/memory/pool/" path, desc, fn)
+
+void pool_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("chunk-allocator", "pool chunks come from the chunk allocator", test_chunk_from_allocator);
+	T("chunk-allocator-fallback", "malloc is used when the chunk allocator fails", test_fallback_to_malloc);
+	T("chunk-allocator-switch", "chunks are released to the allocator after switching back", test_free_after_switch_back);
+
+	dm_list_add(all_tests, &ts->list);
+}
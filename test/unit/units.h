@@ -21,14 +21,18 @@
 
 // Declare the function that adds tests suites here ...
 void activation_generator_tests(struct dm_list *suites);
+void arena_tests(struct dm_list *suites);
 void bcache_tests(struct dm_list *suites);
 void bcache_utils_tests(struct dm_list *suites);
 void bitset_tests(struct dm_list *suites);
 void config_tests(struct dm_list *suites);
+void crc_tests(struct dm_list *suites);
 void dm_list_tests(struct dm_list *suites);
+void dm_stats_tests(struct dm_list *suites);
 void dm_status_tests(struct dm_list *suites);
 void io_engine_tests(struct dm_list *suites);
 void percent_tests(struct dm_list *suites);
+void pool_tests(struct dm_list *suites);
 void radix_tree_tests(struct dm_list *suites);
 void regex_tests(struct dm_list *suites);
 void string_tests(struct dm_list *suites);
@@ -38,14 +42,18 @@ void vdo_tests(struct dm_list *suites);
 static inline void register_all_tests(struct dm_list *suites)
 {
         activation_generator_tests(suites);
+	arena_tests(suites);
 	bcache_tests(suites);
 	bcache_utils_tests(suites);
 	bitset_tests(suites);
 	config_tests(suites);
+	crc_tests(suites);
 	dm_list_tests(suites);
+	dm_stats_tests(suites);
 	dm_status_tests(suites);
 	io_engine_tests(suites);
 	percent_tests(suites);
+	pool_tests(suites);
 	radix_tree_tests(suites);
 	regex_tests(suites);
 	string_tests(suites);
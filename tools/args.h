@@ -218,6 +218,13 @@ arg(errorwhenfull_ARG, '\0', "errorwhenfull", bool_VAL, 0, 0,
     "(Also see dm-thin-pool kernel module option no_space_timeout.)\n"
     "See \\fBlvmthin\\fP(7) for more information.\n")
 
+arg(extentheat_ARG, '\0', "extentheat", bool_VAL, 0, 0,
+    "Start (yes) or stop (no) counting I/O to the extents of an active LV.\n"
+    "Counting uses a device-mapper statistics region, see\n"
+    "\\fBlvm.conf\\fP(5) \\fBextent_heat_max_areas\\fP, and ends when\n"
+    "the LV is deactivated. The lv_hot_extents and lv_cold_extents\n"
+    "report fields list the PV extents with the most and least I/O.\n")
+
 arg(force_long_ARG, '\0', "force", 0, ARG_COUNTABLE, 0,
     "Force metadata restore even with thin pool LVs.\n"
     "Use with extreme caution. Most changes to thin metadata\n"
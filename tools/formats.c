@@ -18,6 +18,9 @@
 int formats(struct cmd_context *cmd, int argc __attribute__((unused)),
 	    char **argv __attribute__((unused)))
 {
+	if (!cmd->initialized.formats && !init_formats(cmd))
+		return_ECMD_FAILED;
+
 	display_formats(cmd);
 
 	return ECMD_PROCESSED;
@@ -1663,6 +1663,37 @@ int lvchange_monitor_poll_cmd(struct cmd_context *cmd, int argc, char **argv)
 			       NULL, &_lvchange_monitor_poll_check, &_lvchange_monitor_poll_single);
 }
 
+static int _lvchange_extentheat_single(struct cmd_context *cmd,
+				       struct logical_volume *lv,
+				       struct processing_handle *handle)
+{
+	if (!arg_int_value(cmd, extentheat_ARG, 0)) {
+		if (!lv_extent_heat_stop(lv))
+			return_ECMD_FAILED;
+		return ECMD_PROCESSED;
+	}
+
+	if (!lv_is_active(lv)) {
+		log_error("Logical volume %s must be active to count I/O to its extents.",
+			  display_lvname(lv));
+		return ECMD_FAILED;
+	}
+
+	if (!lv_extent_heat_start(lv)) {
+		log_error("Failed to start counting I/O to extents of %s.",
+			  display_lvname(lv));
+		return ECMD_FAILED;
+	}
+
+	return ECMD_PROCESSED;
+}
+
+int lvchange_extentheat_cmd(struct cmd_context *cmd, int argc, char **argv)
+{
+	return process_each_lv(cmd, argc, argv, NULL, NULL, 0,
+			       NULL, &_lvchange_monitor_poll_check, &_lvchange_extentheat_single);
+}
+
 static int _lvchange_persistent_single(struct cmd_context *cmd,
 				       struct logical_volume *lv,
 				       struct processing_handle *handle)
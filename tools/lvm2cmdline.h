@@ -37,5 +37,6 @@ int lvm_split(char *str, int *argc, char **argv, int max);
 int lvm_run_command(struct cmd_context *cmd, int argc, char **argv);
 int lvm_return_code(int ret);
 int lvm_shell(struct cmd_context *cmd, struct cmdline_context *cmdline);
+int lvm_server(struct cmd_context *cmd, const char *path);
 
 #endif
@@ -99,6 +99,7 @@ static const struct command_function _command_functions[CMD_COUNT] = {
 	{ lvchange_refresh_CMD, lvchange_refresh_cmd },
 	{ lvchange_monitor_CMD, lvchange_monitor_poll_cmd },
 	{ lvchange_poll_CMD, lvchange_monitor_poll_cmd },
+	{ lvchange_extentheat_CMD, lvchange_extentheat_cmd },
 	{ lvchange_persistent_CMD, lvchange_persistent_cmd },
 
 	{ vgchange_locktype_CMD, vgchange_locktype_cmd },
@@ -2396,6 +2397,23 @@ static int _get_current_settings(struct cmd_context *cmd)
 	    !_merge_synonym(cmd, raidwritebehind_ARG, writebehind_ARG))
 		return EINVALID_CMD_LINE;
 
+	/*
+	 * Fast activation creates nodes and symlinks without udev rules
+	 * and leaves the rest of udev processing in the background.
+	 * Only commands activating LVs use it.
+	 */
+	cmd->fast_activation = 0;
+	if (arg_is_set(cmd, activate_ARG) &&
+	    is_change_activating((activation_change_t) arg_uint_value(cmd, activate_ARG, CHANGE_AY)) &&
+	    find_config_tree_bool(cmd, activation_fast_activation_CFG, NULL)) {
+		if ((cmd->current_settings.udev_rules && find_config_tree_node(cmd, activation_udev_rules_CFG, NULL)) ||
+		    (cmd->current_settings.udev_sync && find_config_tree_node(cmd, activation_udev_sync_CFG, NULL)))
+			log_warn("WARNING: activation/fast_activation overrides activation/udev_rules and activation/udev_sync.");
+		cmd->fast_activation = 1;
+		cmd->current_settings.udev_rules = 0;
+		cmd->current_settings.udev_sync = 0;
+	}
+
 	if ((!strncmp(cmd->name, "pv", 2) &&
 	    !_merge_synonym(cmd, metadatacopies_ARG, pvmetadatacopies_ARG)) ||
 	    (!strncmp(cmd->name, "vg", 2) &&
@@ -2467,15 +2485,19 @@ static void _apply_current_settings(struct cmd_context *cmd)
 	init_msg_prefix(cmd->default_settings.msg_prefix);
 	init_cmd_name(cmd->default_settings.cmd_name);
 
-	archive_enable(cmd, cmd->current_settings.archive);
-	backup_enable(cmd, cmd->current_settings.backup);
-
 	set_activation(cmd->current_settings.activation, cmd->metadata_read_only);
 
-	cmd->fmt = get_format_by_name(cmd, arg_str_value(cmd, metadatatype_ARG,
-				      cmd->current_settings.fmt_name));
+	if (cmd->initialized.formats) {
+		archive_enable(cmd, cmd->current_settings.archive);
+		backup_enable(cmd, cmd->current_settings.backup);
+		cmd->fmt = get_format_by_name(cmd, arg_str_value(cmd, metadatatype_ARG,
+					      cmd->current_settings.fmt_name));
+	}
 
 	cmd->handles_missing_pvs = 0;
+	cmd->defer_thin_pool_updates = 0;
+	cmd->report_thin_usage = 0;
+	cmd->defer_dev_sync = 0;
 }
 
 static const char *_copy_command_line(struct cmd_context *cmd, int argc, char **argv)
@@ -2798,11 +2820,17 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	if (!(cmd->cname = _find_command_name(cmd->name)))
 		return ENO_SUCH_CMD;
 
+	/* Option values such as --type are checked against the segment types */
+	if (!cmd->initialized.formats && !_cmd_no_meta_proc(cmd) && !init_formats(cmd))
+		return_ECMD_FAILED;
+
 	if (!_process_command_line(cmd, &argc, &argv)) {
 		log_error("Error during parsing of command line.");
 		return EINVALID_CMD_LINE;
 	}
 
+	startup_step_done(cmd, "command line");
+
 	/*
 	 * Now we have the command line args, set up any known output logging
 	 * options immediately.
@@ -2847,17 +2875,23 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 			return ECMD_FAILED;
 		}
 		refresh_done = 1;
+		startup_step_done(cmd, "config refresh");
 	}
 
 	if (!_prepare_profiles(cmd))
 		return_ECMD_FAILED;
 
-	if (!cmd->initialized.connections && !_cmd_no_meta_proc(cmd) && !init_connections(cmd))
-		return_ECMD_FAILED;
+	if (!cmd->initialized.connections && !_cmd_no_meta_proc(cmd)) {
+		if (!init_connections(cmd))
+			return_ECMD_FAILED;
+		startup_step_done(cmd, "connections");
+	}
 
-	if (!cmd->initialized.filters && !_cmd_no_meta_proc(cmd) &&
-	    !init_filters(cmd, !refresh_done))
-		return_ECMD_FAILED;
+	if (!cmd->initialized.filters && !_cmd_no_meta_proc(cmd)) {
+		if (!init_filters(cmd, !refresh_done))
+			return_ECMD_FAILED;
+		startup_step_done(cmd, "filters");
+	}
 
 	if (arg_is_set(cmd, readonly_ARG))
 		cmd->metadata_read_only = 1;
@@ -2880,6 +2914,9 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	if (cmd->degraded_activation)
 		log_debug("DEGRADED MODE. Incomplete RAID LVs will be processed.");
 
+	if (cmd->fast_activation)
+		log_debug("FAST ACTIVATION. Device nodes are managed without waiting for udev.");
+
 	if (!get_activation_monitoring_mode(cmd, &monitoring))
 		goto_out;
 	init_dmeventd_monitor(monitoring);
@@ -2888,6 +2925,9 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	log_debug("Command pid: %d", getpid());
 	log_debug("System ID: %s", cmd->system_id ? : "");
 
+	/* Only the first command run by the process reports its startup */
+	startup_log(cmd);
+
 #ifdef O_DIRECT_SUPPORT
 	log_debug("O_DIRECT will be used");
 #endif
@@ -2955,8 +2995,13 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 		/* The old style command-name function is used */
 		ret = cmd->command->fn(cmd, argc, argv);
 
+	/* Wait for devices of all VGs the command changed */
+	if (!sync_local_dev_names(cmd))
+		stack;
+
 	lvmlockd_disconnect();
 	fin_locking();
+	backup_flush(cmd, NULL);
 
 	if (!_cmd_no_meta_proc(cmd) && find_config_tree_bool(cmd, global_notify_dbus_CFG, NULL))
 		lvmnotify_send(cmd);
@@ -2999,6 +3044,7 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	 * free off any memory the command used.
 	 */
 	dm_list_init(&cmd->arg_value_groups);
+	dm_list_init(&cmd->thin_usage_cache);
 	dm_pool_empty(cmd->mem);
 
 	reset_lvm_errno(1);
@@ -3364,6 +3410,7 @@ int lvm2_main(int argc, char **argv)
 	int run_script = 0;
 	const char *run_name;
 	const char *run_command_name = NULL;
+	const char *shell_socket;
 
 	if (!argv)
 		return EINIT_FAILED;
@@ -3460,6 +3507,18 @@ int lvm2_main(int argc, char **argv)
 		goto out;
 	}
 
+	startup_step_done(cmd, "command defs");
+
+	if (run_shell && (shell_socket = getenv("LVM_SHELL_SOCKET"))) {
+		_nonroot_warning();
+		if (!_prepare_profiles(cmd)) {
+			ret = ECMD_FAILED;
+			goto out;
+		}
+		ret = lvm_server(cmd, shell_socket);
+		goto out;
+	}
+
 	if (run_shell) {
 #ifdef READLINE_SUPPORT
 		_nonroot_warning();
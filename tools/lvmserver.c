@@ -0,0 +1,602 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "tools.h"
+
+#include "lvm2cmdline.h"
+#include "lib/misc/lvm-wrappers.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#ifdef UDEV_SYNC_SUPPORT
+#include <libudev.h>
+#endif
+
+/*
+ * LVM shell served on a unix socket (LVM_SHELL_SOCKET).
+ *
+ * The server keeps the tool context that would otherwise be set up by
+ * every lvm process: configuration, command definitions, segment types,
+ * device filters and the list of system devices.  Each connection is
+ * handled by a forked child which reads one command line, runs it with
+ * the JSON report format and the command log report, writes the report
+ * group to the connection and exits.  Commands from different
+ * connections run concurrently, serialised by the usual VG locks.
+ * Only root may connect.  Commands cannot be answered interactively:
+ * stdin is /dev/null, so prompts are answered 'no' unless the command
+ * line includes --yes.
+ *
+ * When udev is available, the list of system devices is refreshed only
+ * after udev reports a change to a block device, so commands skip the
+ * search of /dev.  Before forking, the server waits briefly for udev to
+ * finish uevents of earlier commands, or the child searches /dev.
+ * Labels and metadata are still read by each command.
+ */
+
+#define SERVER_CMD_LEN 4096
+#define SERVER_MAX_CHILDREN 32
+#define SERVER_READ_TIMEOUT 10	/* seconds for a client to send its command */
+#define SERVER_UDEV_WAIT_MS 1000	/* for udev to finish earlier uevents */
+#define SERVER_UDEV_POLL_MS 50
+#define SERVER_SEQNUM_PATH "/sys/kernel/uevent_seqnum"
+#define SERVER_REPORT_CONFIG "report/output_format=json log/report_command_log=1"
+
+struct server {
+	struct cmd_context *cmd;
+	const char *path;
+	int listen_fd;
+	int children;
+#ifdef UDEV_SYNC_SUPPORT
+	struct udev_monitor *monitor;
+	struct udev_queue *queue;
+	unsigned long long seqnum;	/* latest uevent udev finished */
+#endif
+};
+
+static int _listen(struct server *s)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct stat info;
+	mode_t old_umask;
+	int fd, r;
+
+	if (!dm_strncpy(addr.sun_path, s->path, sizeof(addr.sun_path))) {
+		log_error("Socket path %s is too long.", s->path);
+		return 0;
+	}
+
+	/* Replace only a socket left behind by a previous server */
+	if (!lstat(s->path, &info)) {
+		if (!S_ISSOCK(info.st_mode)) {
+			log_error("Refusing to replace %s which is not a socket.", s->path);
+			return 0;
+		}
+		if (unlink(s->path)) {
+			log_sys_error("unlink", s->path);
+			return 0;
+		}
+	} else if (errno != ENOENT) {
+		log_sys_error("lstat", s->path);
+		return 0;
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		log_sys_error("socket", s->path);
+		return 0;
+	}
+
+	old_umask = umask(0077);
+	r = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+	umask(old_umask);
+
+	if (r) {
+		log_sys_error("bind", s->path);
+		if (close(fd))
+			log_sys_debug("close", s->path);
+		return 0;
+	}
+
+	/* Bound, the socket is removed when the server exits */
+	s->listen_fd = fd;
+
+	if (listen(s->listen_fd, SOMAXCONN)) {
+		log_sys_error("listen", s->path);
+		return 0;
+	}
+
+	return 1;
+}
+
+#ifdef UDEV_SYNC_SUPPORT
+static int _kernel_seqnum(unsigned long long *seqnum)
+{
+	FILE *fp;
+	int r;
+
+	if (!(fp = fopen(SERVER_SEQNUM_PATH, "r")))
+		return 0;
+
+	r = (fscanf(fp, "%llu", seqnum) == 1);
+
+	if (fclose(fp))
+		log_sys_debug("fclose", SERVER_SEQNUM_PATH);
+
+	return r;
+}
+
+static void _monitor_init(struct server *s)
+{
+	struct udev *udev = udev_get_library_context();
+
+	/*
+	 * Events of all subsystems are received to follow the uevent
+	 * sequence numbers, only block devices refresh the device list.
+	 */
+	if (!udev || !_kernel_seqnum(&s->seqnum) ||
+	    !(s->queue = udev_queue_new(udev)) ||
+	    !udev_queue_get_udev_is_active(s->queue) ||
+	    !(s->monitor = udev_monitor_new_from_netlink(udev, "udev")) ||
+	    udev_monitor_enable_receiving(s->monitor)) {
+		log_verbose("Not monitoring block devices, /dev will be searched by each command.");
+		if (s->monitor) {
+			udev_monitor_unref(s->monitor);
+			s->monitor = NULL;
+		}
+		if (s->queue) {
+			udev_queue_unref(s->queue);
+			s->queue = NULL;
+		}
+		return;
+	}
+
+	dev_cache_scan();
+	dev_cache_set_current(1);
+}
+
+static int _monitor_fd(struct server *s)
+{
+	return s->monitor ? udev_monitor_get_fd(s->monitor) : -1;
+}
+
+/* Refresh the list of system devices if udev reported any change. */
+static void _monitor_update(struct server *s)
+{
+	struct udev_device *dev;
+	const char *subsystem;
+	unsigned long long seqnum;
+	int changed = 0;
+
+	while ((dev = udev_monitor_receive_device(s->monitor))) {
+		if ((seqnum = udev_device_get_seqnum(dev)) > s->seqnum)
+			s->seqnum = seqnum;
+		if ((subsystem = udev_device_get_subsystem(dev)) &&
+		    !strcmp(subsystem, "block")) {
+			log_debug_devs("Device %s %s.", udev_device_get_devnode(dev) ? : "",
+				       udev_device_get_action(dev) ? : "changed");
+			changed = 1;
+		}
+		udev_device_unref(dev);
+	}
+
+	if (changed) {
+		dev_cache_scan();
+		dev_cache_set_current(1);
+	}
+}
+
+/*
+ * A command run by an earlier child may have created or removed devices
+ * whose uevents udev has not finished yet.  Wait a bounded time until
+ * udev has finished every uevent the kernel sent so far and its queue is
+ * empty.  Returns 0 if it did not, and the child searches /dev itself.
+ */
+static int _monitor_sync(struct server *s)
+{
+	struct pollfd pfd = { .fd = _monitor_fd(s), .events = POLLIN };
+	unsigned long long seqnum;
+	int waited = 0;
+
+	for (;;) {
+		_monitor_update(s);
+
+		if (!_kernel_seqnum(&seqnum))
+			return 0;
+
+		if ((s->seqnum >= seqnum) && udev_queue_get_queue_is_empty(s->queue))
+			return 1;
+
+		if (waited >= SERVER_UDEV_WAIT_MS) {
+			log_debug_devs("Udev has not finished uevent %llu, searching /dev.", seqnum);
+			return 0;
+		}
+
+		if ((poll(&pfd, 1, SERVER_UDEV_POLL_MS) < 0) && (errno != EINTR)) {
+			log_sys_debug("poll", "udev monitor");
+			return 0;
+		}
+
+		waited += SERVER_UDEV_POLL_MS;
+	}
+}
+
+static void _monitor_exit(struct server *s)
+{
+	if (s->monitor)
+		udev_monitor_unref(s->monitor);
+	s->monitor = NULL;
+	if (s->queue)
+		udev_queue_unref(s->queue);
+	s->queue = NULL;
+}
+#else
+static void _monitor_init(struct server *s __attribute__((unused)))
+{
+	log_verbose("Not monitoring block devices, /dev will be searched by each command.");
+}
+
+static int _monitor_fd(struct server *s __attribute__((unused)))
+{
+	return -1;
+}
+
+static void _monitor_update(struct server *s __attribute__((unused)))
+{
+}
+
+static int _monitor_sync(struct server *s __attribute__((unused)))
+{
+	return 1;
+}
+
+static void _monitor_exit(struct server *s __attribute__((unused)))
+{
+}
+#endif
+
+static int _read_command(int fd, char *buffer, size_t size)
+{
+	size_t len = 0;
+	ssize_t n;
+	char *nl;
+
+	while (len < size - 1) {
+		if ((n = read(fd, buffer + len, size - 1 - len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (EWOULDBLOCK != EAGAIN && errno == EWOULDBLOCK)) {
+				log_error("No command received within %d seconds.",
+					  SERVER_READ_TIMEOUT);
+				return 0;
+			}
+			log_sys_error("read", "command");
+			return 0;
+		}
+		if (!n)
+			break;
+		len += n;
+		buffer[len] = '\0';
+		if ((nl = strchr(buffer, '\n'))) {
+			*nl = '\0';
+			return 1;
+		}
+	}
+
+	buffer[len] = '\0';
+
+	if (len == size - 1) {
+		log_error("Command line too long.");
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _log_command_status(struct cmd_context *cmd, int ret_code)
+{
+	log_report_t log_state;
+
+	if (!cmd->cmd_report.log_rh)
+		return;
+
+	log_state = log_get_report_state();
+
+	if (!report_cmdlog(cmd->cmd_report.log_rh, REPORT_OBJECT_CMDLOG_NAME,
+			   log_get_report_context_name(log_state.context),
+			   log_get_report_object_type_name(log_state.object_type),
+			   log_state.object_name, log_state.object_id,
+			   log_state.object_group, log_state.object_group_id,
+			   ret_code == ECMD_PROCESSED ? REPORT_OBJECT_CMDLOG_SUCCESS
+						      : REPORT_OBJECT_CMDLOG_FAILURE,
+			   stored_errno(), ret_code))
+		stack;
+}
+
+/* Prompts read EOF and get the 'no' answer instead of waiting. */
+static int _null_stdin(void)
+{
+	int fd;
+
+	if ((fd = open("/dev/null", O_RDONLY)) < 0) {
+		log_sys_error("open", "/dev/null");
+		return 0;
+	}
+
+	if (dup2(fd, STDIN_FILENO) < 0) {
+		log_sys_error("dup2", "stdin");
+		(void) close(fd);
+		return 0;
+	}
+
+	if ((fd != STDIN_FILENO) && close(fd))
+		log_sys_debug("close", "/dev/null");
+
+	return 1;
+}
+
+/* Runs in the child: one command from the connection, reply written to it. */
+static int _serve_connection(struct cmd_context *cmd, int fd)
+{
+	char buffer[SERVER_CMD_LEN], *args[MAX_ARGS], **argv = args;
+	struct timeval timeout = { .tv_sec = SERVER_READ_TIMEOUT };
+	int argc = 0, ret = EINVALID_CMD_LINE;
+
+	log_set_report(cmd->cmd_report.log_rh);
+
+	if (!_null_stdin())
+		return ECMD_FAILED;
+
+	if (dup2(fd, STDOUT_FILENO) < 0) {
+		log_sys_error("dup2", "stdout");
+		return ECMD_FAILED;
+	}
+
+	/* An idle client must not keep a child slot forever */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)))
+		log_sys_debug("setsockopt", "connection");
+
+	if (!_read_command(fd, buffer, sizeof(buffer))) {
+		buffer[0] = '\0';
+		goto out;
+	}
+
+	if (close(fd))
+		log_sys_debug("close", "connection");
+
+	if (lvm_split(buffer, &argc, argv, MAX_ARGS) == MAX_ARGS) {
+		log_error("Too many arguments, sorry.");
+		goto out;
+	}
+
+	if (argc && !strcmp(argv[0], "lvm")) {
+		argv++;
+		argc--;
+	}
+
+	if (!argc) {
+		log_error("No command supplied.");
+		goto out;
+	}
+
+	log_set_report_object_name_and_id(argv[0], NULL);
+
+	ret = lvm_run_command(cmd, argc, argv);
+	if (ret == ENO_SUCH_CMD)
+		log_error("No such command '%s'.  Try 'help'.", argv[0]);
+
+	if ((ret != ECMD_PROCESSED) && !error_message_produced()) {
+		log_debug(INTERNAL_ERROR "Failed command did not use log_error");
+		log_error("Command failed with status code %d.", ret);
+	}
+out:
+	_log_command_status(cmd, ret);
+
+	log_set_report(NULL);
+	dm_report_group_output_and_pop_all(cmd->cmd_report.report_group);
+
+	if (fflush(stdout))
+		log_sys_debug("fflush", "stdout");
+
+	return ret;
+}
+
+static void _reap_children(struct server *s)
+{
+	while (s->children && (waitpid(-1, NULL, WNOHANG) > 0))
+		s->children--;
+}
+
+/* Commands run with the server's privileges, so only root may send them. */
+static int _peer_allowed(struct server *s, int fd)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+		log_sys_error("getsockopt", s->path);
+		return 0;
+	}
+
+	if (cred.uid) {
+		log_error("Rejecting connection from pid %d with uid %u on %s.",
+			  (int) cred.pid, (unsigned) cred.uid, s->path);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _accept_connection(struct server *s)
+{
+	pid_t pid;
+	int fd, current = 1;
+
+	if ((fd = accept4(s->listen_fd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+		if (errno != EINTR && errno != EAGAIN)
+			log_sys_error("accept", s->path);
+		return;
+	}
+
+	if (!_peer_allowed(s, fd)) {
+		if (close(fd))
+			log_sys_debug("close", s->path);
+		return;
+	}
+
+	/* Refresh devices before the child inherits them */
+	if (_monitor_fd(s) >= 0)
+		current = _monitor_sync(s);
+
+	if ((pid = fork()) < 0) {
+		log_sys_error("fork", s->path);
+		if (close(fd))
+			log_sys_debug("close", s->path);
+		return;
+	}
+
+	if (!pid) {
+		if (close(s->listen_fd))
+			log_sys_debug("close", s->path);
+		_monitor_exit(s);
+		if (!current)
+			dev_cache_set_current(0);
+		(void) signal(SIGPIPE, SIG_DFL);
+		_exit(lvm_return_code(_serve_connection(s->cmd, fd)));
+	}
+
+	s->children++;
+
+	if (close(fd))
+		log_sys_debug("close", s->path);
+}
+
+/*
+ * Prepare the context every command would otherwise set up for itself
+ * and the report group all replies are written to.
+ */
+static int _server_init(struct server *s)
+{
+	struct cmd_context *cmd = s->cmd;
+	struct dm_config_tree *cft;
+	int r;
+
+	if (!override_config_tree_from_string(cmd, SERVER_REPORT_CONFIG))
+		return_0;
+
+	r = report_format_init(cmd);
+
+	if ((cft = remove_config_tree_by_source(cmd, CONFIG_STRING)))
+		dm_config_destroy(cft);
+
+	if (!r)
+		return_0;
+
+	/* Only the children log to the report, the server logs to stderr */
+	log_set_report(NULL);
+	log_set_report_context(LOG_REPORT_CONTEXT_SHELL);
+	log_set_report_object_type(LOG_REPORT_OBJECT_TYPE_CMD);
+
+	if (!cmd->initialized.formats && !init_formats(cmd))
+		return_0;
+
+	if (!cmd->initialized.connections && !init_connections(cmd))
+		return_0;
+
+	if (!cmd->initialized.filters && !init_filters(cmd, 1))
+		return_0;
+
+	if (!_listen(s))
+		return_0;
+
+	_monitor_init(s);
+
+	return 1;
+}
+
+int lvm_server(struct cmd_context *cmd, const char *path)
+{
+	struct server s = { .cmd = cmd, .path = path, .listen_fd = -1 };
+	struct pollfd fds[2];
+	int ret = ECMD_FAILED;
+
+	if (!_server_init(&s))
+		goto_out;
+
+	cmd->is_interactive = 1;
+
+	/* A client closing its connection early must not stop the server */
+	(void) signal(SIGPIPE, SIG_IGN);
+
+	log_verbose("Serving lvm commands on %s.", path);
+
+	fds[0].events = POLLIN;
+	fds[1].fd = _monitor_fd(&s);
+	fds[1].events = POLLIN;
+
+	while (!sigint_caught()) {
+		/*
+		 * With all child slots busy, new connections wait in the
+		 * listen backlog until a child exits.
+		 */
+		fds[0].fd = (s.children < SERVER_MAX_CHILDREN) ? s.listen_fd : -1;
+		fds[0].revents = fds[1].revents = 0;
+
+		sigint_allow();
+		if (poll(fds, 2, s.children ? 1000 : -1) < 0 && (errno != EINTR)) {
+			sigint_restore();
+			log_sys_error("poll", path);
+			goto out;
+		}
+		sigint_restore();
+
+		_reap_children(&s);
+
+		if (fds[1].revents & POLLIN)
+			_monitor_update(&s);
+
+		if (fds[0].revents & POLLIN)
+			_accept_connection(&s);
+	}
+
+	ret = ECMD_PROCESSED;
+out:
+	_monitor_exit(&s);
+
+	if (s.listen_fd >= 0) {
+		if (close(s.listen_fd))
+			log_sys_debug("close", path);
+		if (unlink(path))
+			log_sys_debug("unlink", path);
+	}
+
+	if (cmd->cmd_report.report_group) {
+		if (!dm_report_group_destroy(cmd->cmd_report.report_group))
+			stack;
+		cmd->cmd_report.report_group = NULL;
+	}
+
+	if (cmd->cmd_report.log_rh) {
+		dm_report_free(cmd->cmd_report.log_rh);
+		cmd->cmd_report.log_rh = NULL;
+	}
+
+	cmd->is_interactive = 0;
+
+	return ret;
+}
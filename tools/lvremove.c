@@ -25,6 +25,7 @@ int lvremove(struct cmd_context *cmd, int argc, char **argv)
 
 	cmd->handles_missing_pvs = 1;
 	cmd->include_historical_lvs = 1;
+	cmd->defer_thin_pool_updates = 1;
 
 	return process_each_lv(cmd, argc, argv, NULL, NULL, READ_FOR_UPDATE, NULL,
 			       NULL, &lvremove_single);
@@ -29,6 +29,7 @@ progress_t poll_mirror_progress(struct cmd_context *cmd,
 {
 	dm_percent_t segment_percent = DM_PERCENT_0, overall_percent = DM_PERCENT_0;
 	uint32_t event_nr = 0;
+	struct lv_segment *seg;
 
 	if (!lv_is_mirrored(lv) ||
 	    !lv_mirror_percent(cmd, lv, !parms->interval, &segment_percent,
@@ -39,6 +40,16 @@ progress_t poll_mirror_progress(struct cmd_context *cmd,
 	}
 
 	overall_percent = copy_percent(lv);
+
+	/* pvmove may be copying several segments at once */
+	if (lv_is_pvmove(lv))
+		dm_list_iterate_items(seg, &lv->segments)
+			if ((seg->status & PVMOVE) && seg->extents_copied &&
+			    (seg->extents_copied < seg->area_len))
+				log_verbose("%s: segment at extent %" PRIu32 ": %s%%", name, seg->le,
+					    display_percent(cmd, dm_make_percent(seg->extents_copied,
+										 seg->area_len)));
+
 	if (parms->progress_display)
 		log_print_unless_silent("%s: %s: %s%%", name, parms->progress_title,
 					display_percent(cmd, overall_percent));
@@ -87,16 +87,101 @@ static int _vgs_single(struct cmd_context *cmd __attribute__((unused)),
 	return ECMD_PROCESSED;
 }
 
+/*
+ * Full report shares LV info and status between the sub-reports of a VG,
+ * so the kernel is queried once for each LV segment and not again by
+ * the lvs, segs and pvsegs sub-reports showing the same segment.
+ */
+struct lv_status_key {
+	const struct lv_segment *seg;
+	int do_info;
+	int do_status;
+};
+
+struct lv_status_entry {
+	struct lv_status_key key;
+	struct lv_with_info_and_seg_status status;
+};
+
+static struct dm_hash_table *_lv_status_cache;
+
+static void _destroy_lv_status_entry(void *data)
+{
+	struct lv_status_entry *entry = data;
+
+	if (entry->status.seg_status.mem)
+		dm_pool_destroy(entry->status.seg_status.mem);
+	free(entry);
+}
+
+static void _lv_status_cache_destroy(void)
+{
+	if (!_lv_status_cache)
+		return;
+
+	dm_hash_iter(_lv_status_cache, _destroy_lv_status_entry);
+	dm_hash_destroy(_lv_status_cache);
+	_lv_status_cache = NULL;
+}
+
+static void _lv_status_cache_init(void)
+{
+	_lv_status_cache_destroy();
+
+	if (!(_lv_status_cache = dm_hash_create(128)))
+		log_debug("Failed to create LV status cache, not sharing status between subreports.");
+}
+
+static struct lv_status_entry *_lv_status_cache_lookup(const struct lv_status_key *key)
+{
+	return dm_hash_lookup_binary(_lv_status_cache, key, sizeof(*key));
+}
+
+/* The cache takes over the status and its memory pool. */
+static void _lv_status_cache_insert(const struct lv_status_key *key,
+				    struct lv_with_info_and_seg_status *status)
+{
+	struct lv_status_entry *entry;
+
+	if (!(entry = malloc(sizeof(*entry))))
+		return;
+
+	entry->key = *key;
+	entry->status = *status;
+
+	if (!dm_hash_insert_binary(_lv_status_cache, &entry->key, sizeof(entry->key), entry)) {
+		free(entry);
+		return;
+	}
+
+	status->seg_status.mem = NULL;
+}
+
 static int _do_info_and_status(struct cmd_context *cmd,
 				const struct lv_segment *lv_seg,
 				struct lv_with_info_and_seg_status *status,
 				int do_info, int do_status)
 {
+	struct lv_status_key key = {
+		.seg = lv_seg,
+		.do_info = do_info,
+		.do_status = do_status
+	};
+	struct lv_status_entry *entry;
+
 	status->lv = lv_seg->lv;
 
 	if (lv_is_historical(lv_seg->lv))
 		return 1;
 
+	if (_lv_status_cache && (do_info || do_status) &&
+	    (entry = _lv_status_cache_lookup(&key))) {
+		*status = entry->status;
+		/* Pool stays owned by the cache */
+		status->seg_status.mem = NULL;
+		return 1;
+	}
+
 	if (do_status) {
 		if (!(status->seg_status.mem = dm_pool_create("reporter_pool", 1024)))
 			return_0;
@@ -110,6 +195,9 @@ static int _do_info_and_status(struct cmd_context *cmd,
 		/* info only */
 		status->info_ok = lv_info(cmd, status->lv, 0, &status->info, 1, 1);
 
+	if (_lv_status_cache && (do_info || do_status))
+		_lv_status_cache_insert(&key, status);
+
 	return 1;
 }
 
@@ -1235,6 +1323,7 @@ static int _full_report_single(struct cmd_context *cmd,
 		return ECMD_PROCESSED;
 
 	args->full_report_vg = vg;
+	_lv_status_cache_init();
 
 	if (!args->log_only && !dm_report_group_push(cmd->cmd_report.report_group, NULL, NULL))
 		goto out;
@@ -1255,10 +1344,63 @@ static int _full_report_single(struct cmd_context *cmd,
 	if (!args->log_only && !dm_report_group_pop(cmd->cmd_report.report_group))
 		goto_out;
 out:
+	_lv_status_cache_destroy();
 	args->full_report_vg = NULL;
 	return r;
 }
 
+/* Is the field named in a list of report fields or a selection? */
+static int _names_field(const char *str, const char *field)
+{
+	size_t len = strlen(field);
+	const char *p, *name;
+
+	for (p = str; p && (p = strstr(p, field)); p += len) {
+		name = p;
+		/* Fields of LVs may be prefixed */
+		if ((name - str >= 3) && !strncmp(name - 3, "lv_", 3))
+			name -= 3;
+		if (((name > str) && (isalnum(name[-1]) || (name[-1] == '_'))) ||
+		    isalnum(p[len]) || (p[len] == '_'))
+			continue;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * The thin usage fields reserve a metadata snapshot in the kernel and
+ * take a lock file, so they are only reported when named explicitly,
+ * not for -o all, and never by a command that must not take locks.
+ */
+static void _check_thin_usage_fields(struct cmd_context *cmd, struct report_args *args)
+{
+	struct single_report_args *sa;
+	int i;
+
+	for (i = 0; i < REPORT_IDX_COUNT; i++) {
+		sa = &args->single_args[i];
+		if (sa->report_type == CMDLOG)
+			continue;
+		if (_names_field(sa->options, "thin_exclusive_size") ||
+		    _names_field(sa->options, "thin_shared_size") ||
+		    _names_field(sa->selection, "thin_exclusive_size") ||
+		    _names_field(sa->selection, "thin_shared_size"))
+			break;
+	}
+
+	if (i == REPORT_IDX_COUNT)
+		return;
+
+	if (!file_locking_writable()) {
+		log_warn("WARNING: Thin usage fields are not reported without file locking.");
+		return;
+	}
+
+	cmd->report_thin_usage = 1;
+}
+
 #define _set_full_report_single(cmd,args,type,name) \
 	do { \
 		(args)->single_args[REPORT_IDX_FULL_ ## type].report_type = type; \
@@ -1359,6 +1501,9 @@ static int _config_report(struct cmd_context *cmd, struct report_args *args, str
 	if ((_get_report_selection(cmd, args, single_args) != ECMD_PROCESSED))
 		return_0;
 
+	if (single_args->report_type != CMDLOG)
+		_check_thin_usage_fields(cmd, args);
+
 	args->separator = arg_str_value(cmd, separator_ARG, args->separator);
 	if (arg_is_set(cmd, separator_ARG))
 		args->aligned = 0;
@@ -1471,6 +1616,9 @@ int fullreport(struct cmd_context *cmd, int argc, char **argv)
 
 int devtypes(struct cmd_context *cmd, int argc, char **argv)
 {
+	if (!cmd->initialized.devices && !init_devices(cmd))
+		return_ECMD_FAILED;
+
 	return _report(cmd, argc, argv, DEVTYPES);
 }
 
@@ -18,6 +18,9 @@
 int segtypes(struct cmd_context *cmd, int argc __attribute__((unused)),
 	     char **argv __attribute__((unused)))
 {
+	if (!cmd->initialized.formats && !init_formats(cmd))
+		return_ECMD_FAILED;
+
 	display_segtypes(cmd);
 
 	return ECMD_PROCESSED;
@@ -1912,6 +1912,164 @@ static int _select_matches(struct processing_handle *handle)
 	return handle->selection_handle->selected;
 }
 
+/*
+ * Read-only commands that rescan the devices of each VG under its lock
+ * can lock a window of VGs and rescan the devices of the whole window
+ * at once, so the reads for all of them are in flight together.  The
+ * VGs are still read and processed one at a time in list order, and
+ * each window lock is released once its VG has been processed.
+ */
+#define RESCAN_WINDOW_SIZE 32
+
+struct rescan_window {
+	struct dm_list vgnameids;	/* locked copies passed to the rescan */
+	struct vgnameid_list vgnl[RESCAN_WINDOW_SIZE];
+	struct vgnameid_list *orig[RESCAN_WINDOW_SIZE];
+	unsigned count;
+	unsigned pos;			/* VG being processed */
+	unsigned enabled:1;
+	unsigned handed_over:1;		/* lock of the VG at pos passed to vg_read */
+};
+
+static void _rescan_window_init(struct cmd_context *cmd, struct rescan_window *w,
+				uint32_t read_flags)
+{
+	memset(w, 0, sizeof(*w));
+	dm_list_init(&w->vgnameids);
+
+	w->enabled = (cmd->cname->flags & RESCAN_VGS_TOGETHER) &&
+		     !(read_flags & READ_FOR_UPDATE) &&
+		     !cmd->can_use_one_scan && !lvmlockd_use();
+}
+
+static int _vgnl_name_cmp(const void *a, const void *b)
+{
+	return strcmp((*(struct vgnameid_list * const *) a)->vg_name,
+		      (*(struct vgnameid_list * const *) b)->vg_name);
+}
+
+/*
+ * VGs whose unlock is deferred stay locked while the next VGs are
+ * locked, which keeps lock order only when VGs are processed by name.
+ */
+static void _sort_vgnameids(struct cmd_context *cmd, struct dm_list *vgnameids)
+{
+	struct vgnameid_list **sorted, *vgnl;
+	unsigned count = dm_list_size(vgnameids), i = 0;
+
+	if (count < 2 ||
+	    !(sorted = dm_pool_alloc(cmd->mem, count * sizeof(*sorted))))
+		return;
+
+	dm_list_iterate_items(vgnl, vgnameids)
+		sorted[i++] = vgnl;
+
+	qsort(sorted, count, sizeof(*sorted), _vgnl_name_cmp);
+
+	dm_list_init(vgnameids);
+	for (i = 0; i < count; i++)
+		dm_list_add(vgnameids, &sorted[i]->list);
+
+	dm_pool_free(cmd->mem, sorted);
+}
+
+static void _rescan_window_release(struct cmd_context *cmd, struct rescan_window *w)
+{
+	if ((w->pos < w->count) && w->handed_over)
+		w->pos++;
+
+	while (w->pos < w->count)
+		unlock_vg(cmd, NULL, w->orig[w->pos++]->vg_name);
+
+	dm_list_init(&w->vgnameids);
+	w->count = w->pos = 0;
+	w->handed_over = 0;
+}
+
+/*
+ * Lock the VGs from vgnl onwards in name order, as commands writing
+ * several VGs do, and rescan their devices together.
+ */
+static void _rescan_window_fill(struct cmd_context *cmd, struct rescan_window *w,
+				struct dm_list *vgnameids, struct vgnameid_list *vgnl)
+{
+	struct vgnameid_list *sorted[RESCAN_WINDOW_SIZE];
+	unsigned i;
+
+	for (; (&vgnl->list != vgnameids) && (w->count < RESCAN_WINDOW_SIZE);
+	     vgnl = dm_list_item(vgnl->list.n, struct vgnameid_list)) {
+		if (is_orphan_vg(vgnl->vg_name))
+			break;
+		w->orig[w->count++] = vgnl;
+	}
+
+	/* A single VG is rescanned by vg_read */
+	if (w->count < 2) {
+		w->count = 0;
+		return;
+	}
+
+	memcpy(sorted, w->orig, w->count * sizeof(*sorted));
+	qsort(sorted, w->count, sizeof(*sorted), _vgnl_name_cmp);
+
+	for (i = 0; i < w->count; i++)
+		if (!lock_vol(cmd, sorted[i]->vg_name, LCK_VG_READ, NULL)) {
+			/* Leave the VGs to vg_read, which reports the failure */
+			while (i--)
+				unlock_vg(cmd, NULL, sorted[i]->vg_name);
+			w->count = 0;
+			return;
+		}
+
+	for (i = 0; i < w->count; i++) {
+		w->vgnl[i].vg_name = w->orig[i]->vg_name;
+		w->vgnl[i].vgid = w->orig[i]->vgid;
+		dm_list_add(&w->vgnameids, &w->vgnl[i].list);
+	}
+
+	if (!lvmcache_label_rescan_vgs(cmd, &w->vgnameids))
+		stack;
+}
+
+/*
+ * Called before each VG in the list is processed: releases the window
+ * lock of the previous VG and starts a new window when the current one
+ * is used up.
+ */
+static void _rescan_window_next(struct cmd_context *cmd, struct rescan_window *w,
+				struct dm_list *vgnameids, struct vgnameid_list *vgnl)
+{
+	if (!w->enabled)
+		return;
+
+	if (w->pos < w->count) {
+		if (!w->handed_over)
+			unlock_vg(cmd, NULL, w->orig[w->pos]->vg_name);
+		w->pos++;
+		w->handed_over = 0;
+	}
+
+	if ((w->pos < w->count) && (w->orig[w->pos] == vgnl))
+		return;
+
+	_rescan_window_release(cmd, w);
+	_rescan_window_fill(cmd, w, vgnameids, vgnl);
+}
+
+/*
+ * The read lock of the VG is passed to vg_read, which then releases it
+ * on failure like a lock it took itself.
+ */
+static uint32_t _rescan_window_read_flags(struct rescan_window *w, struct vgnameid_list *vgnl)
+{
+	if ((w->pos >= w->count) || (w->orig[w->pos] != vgnl))
+		return 0;
+
+	w->handed_over = 1;
+
+	return READ_LOCK_HELD;
+}
+
 static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 				  struct dm_list *vgnameids_to_process,
 				  struct dm_list *arg_vgnames,
@@ -1923,6 +2081,7 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 	char uuid[64] __attribute__((aligned(8)));
 	struct volume_group *vg;
 	struct vgnameid_list *vgnl;
+	struct rescan_window window;
 	const char *vg_name;
 	const char *vg_uuid;
 	uint32_t lockd_state = 0;
@@ -1942,6 +2101,8 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 	if (dm_list_empty(arg_vgnames) && dm_list_empty(arg_tags))
 		process_all = 1;
 
+	_rescan_window_init(cmd, &window, read_flags);
+
 	/*
 	 * FIXME If one_vgname, only proceed if exactly one VG matches tags or selection.
 	 */
@@ -1968,6 +2129,8 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 
 		log_very_verbose("Processing VG %s %s", vg_name, uuid);
 
+		_rescan_window_next(cmd, &window, vgnameids_to_process, vgnl);
+
 		if (!lockd_vg(cmd, vg_name, NULL, 0, &lockd_state)) {
 			stack;
 			ret_max = ECMD_FAILED;
@@ -1975,7 +2138,8 @@ static int _process_vgnameid_list(struct cmd_context *cmd, uint32_t read_flags,
 			continue;
 		}
 
-		vg = vg_read(cmd, vg_name, vg_uuid, read_flags, lockd_state);
+		vg = vg_read(cmd, vg_name, vg_uuid,
+			     read_flags | _rescan_window_read_flags(&window, vgnl), lockd_state);
 		if (_ignore_vg(vg, vg_name, arg_vgnames, read_flags, &skip, &notfound)) {
 			stack;
 			ret_max = ECMD_FAILED;
@@ -2015,6 +2179,7 @@ endvg:
 	_set_final_selection_result(handle, whole_selected);
 	do_report_ret_code = 0;
 out:
+	_rescan_window_release(cmd, &window);
 	if (do_report_ret_code)
 		report_log_ret_code(ret_max);
 	log_restore_report_state(saved_log_report_state);
@@ -2289,6 +2454,9 @@ int process_each_vg(struct cmd_context *cmd,
 	else
 		_choose_vgs_to_process(cmd, &arg_vgnames, &vgnameids_on_system, &vgnameids_to_process);
 
+	if (cmd->defer_dev_sync)
+		_sort_vgnameids(cmd, &vgnameids_to_process);
+
 	if (!handle && !(handle = init_processing_handle(cmd, NULL))) {
 		ret_max = ECMD_FAILED;
 		goto_out;
@@ -3284,6 +3452,15 @@ int process_each_lv_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 	}
 	do_report_ret_code = 0;
 out:
+	/*
+	 * Send the thin pool messages queued while processing the LVs at once,
+	 * also when interrupted or stopped on error, so the LVs already
+	 * removed do not stay allocated in the pool.
+	 */
+	if (cmd->defer_thin_pool_updates && !update_pool_lvs(vg) &&
+	    (ret_max < ECMD_FAILED))
+		ret_max = ECMD_FAILED;
+
 	if (do_report_ret_code)
 		report_log_ret_code(ret_max);
 	log_set_report_object_name_and_id(NULL, NULL);
@@ -3582,6 +3759,7 @@ static int _process_lv_vgnameid_list(struct cmd_context *cmd, uint32_t read_flag
 	struct dm_str_list *sl;
 	struct dm_list *tags_arg;
 	struct dm_list lvnames;
+	struct rescan_window window;
 	uint32_t lockd_state = 0;
 	const char *vg_name;
 	const char *vg_uuid;
@@ -3595,6 +3773,8 @@ static int _process_lv_vgnameid_list(struct cmd_context *cmd, uint32_t read_flag
 
 	log_set_report_object_type(LOG_REPORT_OBJECT_TYPE_VG);
 
+	_rescan_window_init(cmd, &window, read_flags);
+
 	dm_list_iterate_items(vgnl, vgnameids_to_process) {
 		vg_name = vgnl->vg_name;
 		vg_uuid = vgnl->vgid;
@@ -3645,13 +3825,16 @@ static int _process_lv_vgnameid_list(struct cmd_context *cmd, uint32_t read_flag
 
 		log_very_verbose("Processing VG %s %s", vg_name, vg_uuid ? uuid : "");
 
+		_rescan_window_next(cmd, &window, vgnameids_to_process, vgnl);
+
 		if (!lockd_vg(cmd, vg_name, NULL, 0, &lockd_state)) {
 			ret_max = ECMD_FAILED;
 			report_log_ret_code(ret_max);
 			continue;
 		}
 
-		vg = vg_read(cmd, vg_name, vg_uuid, read_flags, lockd_state);
+		vg = vg_read(cmd, vg_name, vg_uuid,
+			     read_flags | _rescan_window_read_flags(&window, vgnl), lockd_state);
 		if (_ignore_vg(vg, vg_name, arg_vgnames, read_flags, &skip, &notfound)) {
 			stack;
 			ret_max = ECMD_FAILED;
@@ -3678,6 +3861,7 @@ endvg:
 	}
 	do_report_ret_code = 0;
 out:
+	_rescan_window_release(cmd, &window);
 	if (do_report_ret_code)
 		report_log_ret_code(ret_max);
 	log_restore_report_state(saved_log_report_state);
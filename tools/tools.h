@@ -133,6 +133,8 @@ struct arg_value_group_list {
 #define GET_VGNAME_FROM_OPTIONS  0x00001000
 /* The data read from disk by label scan can be used for vg_read. */
 #define CAN_USE_ONE_SCAN	 0x00002000
+/* Read-only command may rescan the devices of several locked VGs together. */
+#define RESCAN_VGS_TOGETHER	 0x00004000
 
 
 void usage(const char *name);
@@ -235,6 +237,7 @@ int lvchange_resync_cmd(struct cmd_context *cmd, int argc, char **argv);
 int lvchange_syncaction_cmd(struct cmd_context *cmd, int argc, char **argv);
 int lvchange_rebuild_cmd(struct cmd_context *cmd, int argc, char **argv);
 int lvchange_monitor_poll_cmd(struct cmd_context *cmd, int argc, char **argv);
+int lvchange_extentheat_cmd(struct cmd_context *cmd, int argc, char **argv);
 int lvchange_persistent_cmd(struct cmd_context *cmd, int argc, char **argv);
 
 int lvconvert_repair_cmd(struct cmd_context *cmd, int argc, char **argv);
@@ -78,43 +78,98 @@ static int _poll_lvs_in_vg(struct cmd_context *cmd,
 	return count;
 }
 
-static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
-			       activation_change_t activate)
+/*
+ * Returns the LV that activation of lv would act on, or NULL
+ * if lv is skipped when activating the whole VG.
+ */
+static struct logical_volume *_lv_to_activate(struct cmd_context *cmd,
+					      struct logical_volume *lv,
+					      activation_change_t activate)
 {
-	struct lv_list *lvl;
+	if (!lv_is_visible(lv) && (!cmd->process_component_lvs || !lv_is_component(lv)))
+		return NULL;
+
+	/* If LV is sparse, activate origin instead */
+	if (lv_is_cow(lv) && lv_is_virtual_origin(origin_from_cow(lv)))
+		lv = origin_from_cow(lv);
+
+	/* Only request activation of snapshot origin devices */
+	if (lv_is_snapshot(lv) || lv_is_cow(lv))
+		return NULL;
+
+	/* Only request activation of mirror LV */
+	if (lv_is_mirror_image(lv) || lv_is_mirror_log(lv))
+		return NULL;
+
+	if (lv_is_vdo_pool(lv))
+		return NULL;
+
+	if (lv_activation_skip(lv, activate, arg_is_set(cmd, ignoreactivationskip_ARG)))
+		return NULL;
+
+	if ((activate == CHANGE_AAY) &&
+	    !lv_passes_auto_activation_filter(cmd, lv))
+		return NULL;
+
+	return lv;
+}
+
+/*
+ * In a shared VG, acquire the LV locks for all LVs being activated
+ * with one request to lvmlockd instead of one request per LV.
+ * Activation of each LV then finds its lock already held.
+ */
+static void _lock_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
+			    activation_change_t activate)
+{
+	struct dm_list lvs;
+	struct lv_list *lvl, *lvl_lock;
 	struct logical_volume *lv;
-	int count = 0, expected_count = 0, r = 1;
+	const char *mode = NULL;
 
-	sigint_allow();
-	dm_list_iterate_items(lvl, &vg->lvs) {
-		if (sigint_caught())
-			return_0;
+	if (activate == CHANGE_ASY)
+		mode = "sh";
+	else if (activate == CHANGE_AEY)
+		mode = "ex";
 
-		lv = lvl->lv;
+	dm_list_init(&lvs);
 
-		if (!lv_is_visible(lv) && (!cmd->process_component_lvs || !lv_is_component(lv)))
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!(lv = _lv_to_activate(cmd, lvl->lv, activate)))
 			continue;
 
-		/* If LV is sparse, activate origin instead */
-		if (lv_is_cow(lv) && lv_is_virtual_origin(origin_from_cow(lv)))
-			lv = origin_from_cow(lv);
+		if (!(lvl_lock = dm_pool_alloc(cmd->mem, sizeof(*lvl_lock)))) {
+			log_error("Failed to allocate LV list item.");
+			return;
+		}
 
-		/* Only request activation of snapshot origin devices */
-		if (lv_is_snapshot(lv) || lv_is_cow(lv))
-			continue;
+		lvl_lock->lv = lv;
+		dm_list_add(&lvs, &lvl_lock->list);
+	}
 
-		/* Only request activation of mirror LV */
-		if (lv_is_mirror_image(lv) || lv_is_mirror_log(lv))
-			continue;
+	if (!dm_list_empty(&lvs) &&
+	    !lockd_lv_batch(cmd, vg, &lvs, mode, LDLV_PERSISTENT))
+		log_debug("Falling back to locking each LV in VG %s.", vg->name);
+}
 
-		if (lv_is_vdo_pool(lv))
-			continue;
+static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
+			       activation_change_t activate)
+{
+	struct lv_list *lvl;
+	struct logical_volume *lv;
+	int count = 0, expected_count = 0, r = 1;
 
-		if (lv_activation_skip(lv, activate, arg_is_set(cmd, ignoreactivationskip_ARG)))
-			continue;
+	if (is_change_activating(activate) && vg_is_shared(vg))
+		_lock_lvs_in_vg(cmd, vg, activate);
 
-		if ((activate == CHANGE_AAY) &&
-		    !lv_passes_auto_activation_filter(cmd, lv))
+	sigint_allow();
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (sigint_caught()) {
+			lockd_lv_batch_release(cmd);
+			return_0;
+		}
+
+		if (!(lv = _lv_to_activate(cmd, lvl->lv, activate)))
 			continue;
 
 		expected_count++;
@@ -130,6 +185,9 @@ static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 
 	sigint_restore();
 
+	/* Release batch locks of LVs that were not activated after all. */
+	lockd_lv_batch_release(cmd);
+
 	if (expected_count)
 		log_verbose("%sctivated %d logical volumes in volume group %s.",
 			    is_change_activating(activate) ? "A" : "Dea",
@@ -147,8 +205,8 @@ static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 		r = 0;
 	}
 
-	/* Wait until devices are available */
-	if (!sync_local_dev_names(vg->cmd)) {
+	/* Wait until devices are available, unless unlocking the VG waits */
+	if (!vg->cmd->defer_dev_sync && !sync_local_dev_names(vg->cmd)) {
 		log_error("Failed to sync local devices for VG %s.", vg->name);
 		r = 0;
 	}
@@ -798,6 +856,15 @@ int vgchange(struct cmd_context *cmd, int argc, char **argv)
 	if (update || arg_is_set(cmd, activate_ARG))
 		flags |= READ_FOR_UPDATE;
 
+	/*
+	 * Only activation: udev works on the devices of one VG while the
+	 * next VG is activated.  Each VG stays locked until udev is done.
+	 */
+	if (!update && !lvmlockd_use() &&
+	    (cmd->command->command_enum == vgchange_activate_CMD) &&
+	    is_change_activating((activation_change_t)arg_uint_value(cmd, activate_ARG, CHANGE_AY)))
+		cmd->defer_dev_sync = 1;
+
 	if (!(handle = init_processing_handle(cmd, NULL))) {
 		log_error("Failed to initialize processing handle.");
 		return ECMD_FAILED;